@@ -0,0 +1,706 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// PGN Annotation
+//
+//   annotate <games.pgn> [output file] [nodes n | movetime ms]
+//            [threads n] [hash mb] [blunder cp]
+//
+// The PGN file is read a game at a time into a ring of
+// ANNOTATE_QUEUE_SIZE slots, so a file of any size is done in
+// a fixed amount of memory.  Each thread takes the next game,
+// plays its moves on its own board, and has its own Maverick
+// process (the search keeps its state in globals) search every
+// position, starting at the end of the game so the hash table
+// already knows how the game went when the earlier positions
+// are searched.  The games are written out in the order they
+// were read, with an [%eval] comment (from White's side) after
+// each move and "?" or "??" when a move loses a lot against the
+// engine's own choice.  Games which can't be played through are
+// copied as they are.
+//===========================================================//
+
+#if defined(_WIN32)
+
+BOOL annotate_pgn(char *command)
+{
+    send_info("PGN annotation is not supported on this platform");
+    return FALSE;
+}
+
+#else
+
+//-- Settings
+static t_nodes annotate_nodes;
+static t_chess_time annotate_movetime;
+static int annotate_hash;
+static int annotate_blunder;
+
+//-- Games in the order they were read: written < tail <= head
+static struct t_annotate_game *annotate_queue;
+static t_nodes annotate_head;
+static t_nodes annotate_tail;
+static t_nodes annotate_written;
+static BOOL annotate_reading_done;
+static t_mutex annotate_mutex;
+static t_condition annotate_condition;
+static FILE *annotate_output;
+
+//-- Statistics
+static t_nodes annotate_games;
+static t_nodes annotate_positions;
+static t_nodes annotate_copied;
+static t_nodes annotate_skipped;
+static t_nodes annotate_blunders;
+static t_chess_time annotate_start;
+static t_chess_time annotate_last_report;
+
+//===========================================================//
+// The engine processes
+//===========================================================//
+static BOOL start_annotate_engine(struct t_engine_process *e)
+{
+    static THREAD_LOCAL char line[4 * UCI_BUFFER_SIZE];
+    char s[256];
+
+    if (!engine_start(e, NULL, TRUE))
+        return FALSE;
+
+    sprintf(s, "uci\nsetoption name Hash value %d\nsetoption name OwnBook value false\nisready\n", annotate_hash);
+    if (!engine_send(e, s)) {
+        engine_stop(e, TRUE);
+        return FALSE;
+    }
+
+    //-- Each thread only talks to its own engine, so it can wait for it
+    while (engine_wait_line(e, line)) {
+        if (!strcmp(line, "readyok"))
+            return TRUE;
+    }
+    engine_stop(e, TRUE);
+    return FALSE;
+}
+
+//-- Search one position: "position fen <fen> moves ..." and read up to the "bestmove"
+static BOOL annotate_search(struct t_engine_process *e, struct t_annotate_position *position, int ply, char *bestmove)
+{
+    static THREAD_LOCAL char line[4 * UCI_BUFFER_SIZE];
+    static THREAD_LOCAL char s[UCI_BUFFER_SIZE];
+    char *word[64];
+    int first = max(0, ply - ANNOTATE_HISTORY_PLIES);
+    int i, n, length;
+
+    length = sprintf(s, "position fen %s", position[first].fen);
+    if (first < ply)
+        length += sprintf(s + length, " moves");
+    for (i = first; i < ply; i++)
+        length += sprintf(s + length, " %s", position[i].move);
+    if (annotate_nodes)
+        sprintf(s + length, "\ngo nodes " NODE_FORMAT "\n", annotate_nodes);
+    else
+        sprintf(s + length, "\ngo movetime %d\n", (int)annotate_movetime);
+    if (!engine_send(e, s))
+        return FALSE;
+
+    position[ply].score = 0;
+    position[ply].mate = 0;
+    while (engine_wait_line(e, line)) {
+        n = split_words(line, word, 64);
+        if (n < 1)
+            continue;
+
+        //-- The last score is the one which goes with the move
+        if (!strcmp(word[0], "info")) {
+            for (i = 1; i < n - 2; i++) {
+                if (strcmp(word[i], "score"))
+                    continue;
+                if (!strcmp(word[i + 1], "cp")) {
+                    position[ply].score = atoi(word[i + 2]);
+                    position[ply].mate = 0;
+                }
+                else if (!strcmp(word[i + 1], "mate"))
+                    position[ply].mate = atoi(word[i + 2]);
+                break;
+            }
+        }
+        else if (!strcmp(word[0], "bestmove") && n >= 2) {
+            strncpy(bestmove, word[1], 7);
+            bestmove[7] = '\0';
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//===========================================================//
+// Playing through the games
+//===========================================================//
+
+//-- The score for the side to move, with mates and big scores capped
+static int annotate_value(struct t_annotate_position *position)
+{
+    if (position->checkmate || position->mate < 0)
+        return -ANNOTATE_SCORE_CAP;
+    if (position->mate > 0)
+        return ANNOTATE_SCORE_CAP;
+    return max(-ANNOTATE_SCORE_CAP, min(ANNOTATE_SCORE_CAP, position->score));
+}
+
+//-- Add a word (or a whole comment) to the movetext, keeping the lines under 80 characters
+static void annotate_word(struct t_annotate_game *game, int *length, int *column, char *word)
+{
+    int n = (int)strlen(word);
+
+    if (*length + n + 2 >= ANNOTATE_OUTPUT_SIZE)
+        return;
+    if (*column > 0 && *column + 1 + n >= 80) {
+        game->output[(*length)++] = '\n';
+        *column = 0;
+    }
+    else if (*column > 0) {
+        game->output[(*length)++] = ' ';
+        (*column)++;
+    }
+    memcpy(game->output + *length, word, n + 1);
+    *length += n;
+    *column += n;
+}
+
+//-- Write the annotated movetext, returning the number of blunders
+static int annotate_movetext(struct t_annotate_game *game, struct t_annotate_position *position, int plies, int move_number, t_chess_color color)
+{
+    char s[64], eval[16];
+    int length = 0, column = 0, blunders = 0;
+    int ply, loss, score;
+    BOOL comment = TRUE;
+
+    for (ply = 0; ply < plies; ply++) {
+
+        //-- The move number, which is repeated for Black after a comment
+        if (color == WHITE) {
+            sprintf(s, "%d.", move_number);
+            annotate_word(game, &length, &column, s);
+        }
+        else if (comment) {
+            sprintf(s, "%d...", move_number);
+            annotate_word(game, &length, &column, s);
+        }
+
+        //-- How much the move lost against the best one (for the side which played it)
+        loss = annotate_value(&position[ply]) + annotate_value(&position[ply + 1]);
+        strcpy(s, position[ply].san);
+        if (!position[ply].best_played && loss >= annotate_blunder) {
+            strcat(s, "??");
+            blunders++;
+        }
+        else if (!position[ply].best_played && loss >= annotate_blunder / 2)
+            strcat(s, "?");
+        annotate_word(game, &length, &column, s);
+
+        //-- The score after the move, from White's side (none after mate)
+        comment = FALSE;
+        if (!position[ply + 1].checkmate) {
+            if (position[ply + 1].mate)
+                sprintf(eval, "#%d", (color == WHITE) ? -position[ply + 1].mate : position[ply + 1].mate);
+            else {
+                score = (color == WHITE) ? -position[ply + 1].score : position[ply + 1].score;
+                sprintf(eval, "%s%d.%02d", (score < 0) ? "-" : "", abs(score) / 100, abs(score) % 100);
+            }
+            if (!position[ply].best_played && loss >= annotate_blunder / 2 && position[ply].best[0])
+                sprintf(s, "{[%%eval %s] %s was best}", eval, position[ply].best);
+            else
+                sprintf(s, "{[%%eval %s]}", eval);
+            annotate_word(game, &length, &column, s);
+            comment = TRUE;
+        }
+
+        if (color == BLACK)
+            move_number++;
+        color = OPPONENT(color);
+    }
+
+    annotate_word(game, &length, &column, game->result);
+    game->output[length] = '\0';
+    return blunders;
+}
+
+//-- Play through the game and search every position, returning the number of positions (-1 for a bad game, -2 if the engine fails)
+static int annotate_game(struct t_board *board, struct t_engine_process *e, struct t_annotate_game *game, struct t_annotate_position *position, struct t_undo *undo, int *blunders)
+{
+    struct t_move_list moves[1];
+    struct t_move_record *move;
+    char token[64], bestmove[8];
+    char *p = game->moves;
+    char *word[8];
+    char fen[256];
+    int i, n, plies = 0, level = 0, move_number = 1;
+    t_chess_color color;
+
+    //-- set_fen() and get_fen() share a few tables, so only one thread at a time
+    mutex_lock(&annotate_mutex);
+    set_fen(board, game->fen);
+    strcpy(position[0].fen, get_fen(board));
+    mutex_unlock(&annotate_mutex);
+
+    strcpy(fen, game->fen);
+    if (split_words(fen, word, 8) >= 6)
+        move_number = max(1, atoi(word[5]));
+    color = board->to_move;
+
+    while (*p) {
+
+        //-- Comments, variations and annotations
+        if (isspace((unsigned char)*p) || *p == '.') {
+            p++;
+            continue;
+        }
+        if (*p == '{') {
+            while (*p && *p != '}')
+                p++;
+            if (*p)
+                p++;
+            continue;
+        }
+        if (*p == ';') {
+            while (*p && *p != '\n')
+                p++;
+            continue;
+        }
+        if (*p == '(' || *p == ')') {
+            level = max(0, level + ((*p == '(') ? 1 : -1));
+            p++;
+            continue;
+        }
+
+        //-- The next word
+        n = 0;
+        while (*p && !isspace((unsigned char)*p) && !strchr("{};()", *p)) {
+            if (n < (int)sizeof(token) - 1)
+                token[n++] = *p;
+            p++;
+        }
+        token[n] = '\0';
+
+        if (n == 0) {
+            p++;
+            continue;
+        }
+        if (level > 0 || token[0] == '$')
+            continue;
+
+        //-- The end of the game
+        if (!strcmp(token, "1-0") || !strcmp(token, "0-1") || !strcmp(token, "1/2-1/2") || !strcmp(token, "*")) {
+            if (!game->result[0])
+                strcpy(game->result, token);
+            break;
+        }
+
+        //-- Skip the move number (which may be stuck to the move, e.g. "12.e4")
+        char *san = token;
+        if (isdigit((unsigned char)*san) && strcmp(san, "0-0") && strcmp(san, "0-0-0")) {
+            while (isdigit((unsigned char)*san))
+                san++;
+            while (*san == '.')
+                san++;
+            if (*san == '\0')
+                continue;
+        }
+
+        if (plies >= ANNOTATE_MAX_PLIES)
+            return -1;
+        generate_legal_moves(board, moves);
+        move = parse_san(board, moves, san);
+        if (move == NULL)
+            return -1;
+
+        strcpy(position[plies].move, move_as_str(move));
+        move_as_san(board, moves, move, position[plies].san);
+        make_move(board, moves->pinned_pieces, move, &undo[plies]);
+        plies++;
+
+        mutex_lock(&annotate_mutex);
+        strcpy(position[plies].fen, get_fen(board));
+        mutex_unlock(&annotate_mutex);
+    }
+    if (!game->result[0])
+        strcpy(game->result, "*");
+
+    //-- Search the positions from the last to the first, in a new game
+    if (!engine_send(e, "ucinewgame\n"))
+        return -2;
+
+    for (i = plies; i >= 0; i--) {
+        generate_legal_moves(board, moves);
+        position[i].checkmate = (moves->count == 0 && board->in_check);
+        position[i].stalemate = (moves->count == 0 && !board->in_check);
+        position[i].best[0] = '\0';
+        position[i].best_played = FALSE;
+
+        if (moves->count == 0) {
+            position[i].score = 0;
+            position[i].mate = 0;
+        }
+        else {
+            if (!annotate_search(e, position, i, bestmove))
+                return -2;
+
+            //-- The engine's move, in SAN
+            for (n = 0; n < moves->count; n++) {
+                if (!strcmp(move_as_str(moves->move[n]), bestmove)) {
+                    move_as_san(board, moves, moves->move[n], position[i].best);
+                    break;
+                }
+            }
+            position[i].best_played = (i < plies && !strcmp(bestmove, position[i].move));
+        }
+
+        if (i > 0)
+            unmake_move(board, &undo[i - 1]);
+    }
+
+    *blunders = annotate_movetext(game, position, plies, move_number, color);
+    return plies + 1;
+}
+
+//-- Write out the games which are done, in order (called with annotate_mutex held)
+static void write_annotated_games()
+{
+    static char s[1024];
+    struct t_annotate_game *game;
+    t_chess_time elapsed;
+    size_t n;
+
+    while (annotate_written < annotate_tail) {
+        game = &annotate_queue[annotate_written % ANNOTATE_QUEUE_SIZE];
+        if (game->state != ANNOTATE_DONE)
+            break;
+
+        fputs(game->tags, annotate_output);
+        fputs("\n", annotate_output);
+        if (game->annotated) {
+            fputs(game->output, annotate_output);
+            fputs("\n\n", annotate_output);
+        }
+        else {
+            n = strlen(game->moves);
+            while (n > 0 && isspace((unsigned char)game->moves[n - 1]))
+                n--;
+            fwrite(game->moves, 1, n, annotate_output);
+            fputs("\n\n", annotate_output);
+        }
+
+        game->state = ANNOTATE_EMPTY;
+        annotate_written++;
+    }
+
+    if (time_now() - annotate_last_report >= ANNOTATE_REPORT_INTERVAL) {
+        annotate_last_report = time_now();
+        elapsed = max(1, annotate_last_report - annotate_start);
+        sprintf(s, "Annotate: " NODE_FORMAT " games, " NODE_FORMAT " positions, %.0f games/hour", annotate_games, annotate_positions, annotate_games * 3600000.0 / elapsed);
+        send_info(s);
+    }
+}
+
+static unsigned __stdcall annotate_worker(void* pArguments)
+{
+    struct t_board *board = (struct t_board *)malloc(sizeof(struct t_board));
+    struct t_annotate_position *position = (struct t_annotate_position *)malloc((ANNOTATE_MAX_PLIES + 1) * sizeof(struct t_annotate_position));
+    struct t_undo *undo = (struct t_undo *)malloc(ANNOTATE_MAX_PLIES * sizeof(struct t_undo));
+    struct t_engine_process *e = (struct t_engine_process *)malloc(sizeof(struct t_engine_process));
+    struct t_annotate_game *game;
+    int n, blunders = 0;
+
+    if (board == NULL || position == NULL || undo == NULL || e == NULL) {
+        send_info("Annotate: not enough memory");
+        exit(1);
+    }
+    init_board(board);
+    if (!start_annotate_engine(e))
+        send_info("Annotate: unable to start an engine");
+
+    mutex_lock(&annotate_mutex);
+    while (TRUE) {
+
+        //-- Wait for a game
+        while (annotate_head == annotate_tail && !annotate_reading_done)
+            condition_wait(&annotate_condition, &annotate_mutex);
+        if (annotate_head == annotate_tail)
+            break;
+
+        game = &annotate_queue[annotate_tail % ANNOTATE_QUEUE_SIZE];
+        game->state = ANNOTATE_WORKING;
+        annotate_tail++;
+        mutex_unlock(&annotate_mutex);
+
+        //-- An engine which has died is started again for the next game
+        n = -1;
+        if (e->pid > 0 || start_annotate_engine(e))
+            n = annotate_game(board, e, game, position, undo, &blunders);
+        if (n == -2)
+            engine_stop(e, TRUE);
+
+        mutex_lock(&annotate_mutex);
+        game->annotated = (n >= 0);
+        game->state = ANNOTATE_DONE;
+        annotate_games++;
+        if (n >= 0) {
+            annotate_positions += n;
+            annotate_blunders += blunders;
+        }
+        else
+            annotate_copied++;
+        write_annotated_games();
+        condition_broadcast(&annotate_condition);
+    }
+    mutex_unlock(&annotate_mutex);
+
+    engine_stop(e, TRUE);
+    free(e);
+    free(undo);
+    free(position);
+    free(board);
+    return(0);
+}
+
+//===========================================================//
+// Reading the PGN file
+//===========================================================//
+static void queue_annotate_game(struct t_annotate_game *game)
+{
+    struct t_annotate_game *slot;
+
+    mutex_lock(&annotate_mutex);
+    if (game->truncated) {
+        annotate_skipped++;
+        mutex_unlock(&annotate_mutex);
+        return;
+    }
+
+    //-- Wait for the game ANNOTATE_QUEUE_SIZE back to be written
+    while (annotate_head - annotate_written >= ANNOTATE_QUEUE_SIZE)
+        condition_wait(&annotate_condition, &annotate_mutex);
+
+    slot = &annotate_queue[annotate_head % ANNOTATE_QUEUE_SIZE];
+    strcpy(slot->fen, game->fen);
+    strcpy(slot->result, game->result);
+    strcpy(slot->tags, game->tags);
+    strcpy(slot->moves, game->moves);
+    slot->annotated = FALSE;
+    slot->state = ANNOTATE_WAITING;
+    annotate_head++;
+
+    condition_broadcast(&annotate_condition);
+    mutex_unlock(&annotate_mutex);
+}
+
+static void new_annotate_game(struct t_annotate_game *game)
+{
+    strcpy(game->fen, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    game->result[0] = '\0';
+    game->tags[0] = '\0';
+    game->moves[0] = '\0';
+    game->truncated = FALSE;
+}
+
+static BOOL read_annotate_pgn(char *filename, struct t_annotate_game *game)
+{
+    static char line[ANNOTATE_GAME_SIZE];
+    static char value[256];
+    size_t tag_length = 0, length = 0, n;
+    BOOL in_moves = FALSE;
+    FILE *f;
+
+    if ((f = fopen(filename, "r")) == NULL)
+        return FALSE;
+
+    new_annotate_game(game);
+    while (TRUE) {
+        BOOL eof = (fgets(line, sizeof(line), f) == NULL);
+
+        //-- A tag after the moves (or the end of the file) finishes the game
+        if (eof || (line[0] == '[' && in_moves)) {
+            if (in_moves || tag_length > 0)
+                queue_annotate_game(game);
+
+            new_annotate_game(game);
+            tag_length = 0;
+            length = 0;
+            in_moves = FALSE;
+
+            if (eof)
+                break;
+        }
+
+        n = strlen(line);
+        if (line[0] == '[') {
+            if (!read_pgn_tag(line, "Result", game->result, sizeof(game->result)) && read_pgn_tag(line, "FEN", value, sizeof(value)))
+                strcpy(game->fen, value);
+            if (tag_length + n < ANNOTATE_TAG_SIZE) {
+                memcpy(game->tags + tag_length, line, n + 1);
+                tag_length += n;
+            }
+            else
+                game->truncated = TRUE;
+            continue;
+        }
+
+        //-- The moves
+        if (n > 0 && !(n == 1 && line[0] == '\n'))
+            in_moves = TRUE;
+        if (!in_moves)
+            continue;
+        if (length + n < ANNOTATE_GAME_SIZE) {
+            memcpy(game->moves + length, line, n + 1);
+            length += n;
+        }
+        else
+            game->truncated = TRUE;
+    }
+
+    fclose(f);
+    return TRUE;
+}
+
+BOOL annotate_pgn(char *command)
+{
+    static char options[1024];
+    static char output_name[FILENAME_MAX];
+    static char s[1024];
+    static struct t_annotate_game game[1];
+    t_thread thread[ANNOTATE_MAX_THREADS];
+    char *word[64];
+    char *filename = NULL;
+    int threads = numa.cpu_count;
+    t_chess_time elapsed;
+    int i, n;
+    BOOL ok;
+
+    annotate_nodes = 0;
+    annotate_movetime = 0;
+    annotate_hash = ANNOTATE_DEFAULT_HASH;
+    annotate_blunder = ANNOTATE_DEFAULT_BLUNDER;
+    output_name[0] = '\0';
+
+    //-- Options
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "output") && i < n - 1)
+            strncpy(output_name, word[++i], sizeof(output_name) - 1);
+        else if (!strcmp(word[i], "nodes") && i < n - 1)
+            annotate_nodes = (t_nodes)strtoull(word[++i], NULL, 10);
+        else if (!strcmp(word[i], "movetime") && i < n - 1)
+            annotate_movetime = atol(word[++i]);
+        else if (!strcmp(word[i], "threads") && i < n - 1)
+            threads = atoi(word[++i]);
+        else if (!strcmp(word[i], "hash") && i < n - 1)
+            annotate_hash = atoi(word[++i]);
+        else if (!strcmp(word[i], "blunder") && i < n - 1)
+            annotate_blunder = atoi(word[++i]);
+        else
+            filename = word[i];
+    }
+    if (filename == NULL) {
+        send_info("Usage: annotate <games.pgn> [output file] [nodes n | movetime ms] [threads n] [hash mb] [blunder cp]");
+        return FALSE;
+    }
+    if (annotate_nodes == 0 && annotate_movetime <= 0)
+        annotate_nodes = ANNOTATE_DEFAULT_NODES;
+    if (output_name[0] == '\0')
+        snprintf(output_name, sizeof(output_name), "%s.annotated.pgn", filename);
+    threads = max(1, min(threads, ANNOTATE_MAX_THREADS));
+    annotate_hash = max(2, annotate_hash / threads);
+    annotate_blunder = max(2, annotate_blunder);
+
+    if ((annotate_output = fopen(output_name, "w")) == NULL) {
+        snprintf(s, sizeof(s), "Annotate: unable to create %s", output_name);
+        send_info(s);
+        return FALSE;
+    }
+    annotate_queue = (struct t_annotate_game *)calloc(ANNOTATE_QUEUE_SIZE, sizeof(struct t_annotate_game));
+    if (annotate_queue == NULL) {
+        fclose(annotate_output);
+        return FALSE;
+    }
+
+    uci_wait_for_search();
+
+    //-- An engine which dies shouldn't take us with it
+    signal(SIGPIPE, SIG_IGN);
+
+    annotate_head = 0;
+    annotate_tail = 0;
+    annotate_written = 0;
+    annotate_reading_done = FALSE;
+    annotate_games = 0;
+    annotate_positions = 0;
+    annotate_copied = 0;
+    annotate_skipped = 0;
+    annotate_blunders = 0;
+    annotate_start = time_now();
+    annotate_last_report = annotate_start;
+
+    mutex_init(&annotate_mutex);
+    condition_init(&annotate_condition);
+
+    if (annotate_nodes)
+        snprintf(s, sizeof(s), "Annotate: %s to %s, " NODE_FORMAT " nodes a position, %d threads (%d MB hash each)", filename, output_name, annotate_nodes, threads, annotate_hash);
+    else
+        snprintf(s, sizeof(s), "Annotate: %s to %s, %d ms a position, %d threads (%d MB hash each)", filename, output_name, (int)annotate_movetime, threads, annotate_hash);
+    send_info(s);
+
+    for (i = 0; i < threads; i++)
+        thread_create(&thread[i], annotate_worker, NULL);
+
+    ok = read_annotate_pgn(filename, game);
+    if (!ok) {
+        snprintf(s, sizeof(s), "Annotate: unable to open %s", filename);
+        send_info(s);
+    }
+
+    mutex_lock(&annotate_mutex);
+    annotate_reading_done = TRUE;
+    condition_broadcast(&annotate_condition);
+    mutex_unlock(&annotate_mutex);
+
+    for (i = 0; i < threads; i++)
+        thread_join(thread[i]);
+
+    fclose(annotate_output);
+    free(annotate_queue);
+
+    elapsed = max(1, time_now() - annotate_start);
+    snprintf(s, sizeof(s), "Annotate: " NODE_FORMAT " games, " NODE_FORMAT " positions, " NODE_FORMAT " blunders in %.1f s (%.0f games/hour)",
+        annotate_games, annotate_positions, annotate_blunders, elapsed / 1000.0, annotate_games * 3600000.0 / elapsed);
+    send_info(s);
+    if (annotate_copied || annotate_skipped) {
+        snprintf(s, sizeof(s), "Annotate: " NODE_FORMAT " games copied without annotations, " NODE_FORMAT " too big to copy", annotate_copied, annotate_skipped);
+        send_info(s);
+    }
+
+    return ok && annotate_games > 0 && annotate_copied < annotate_games;
+}
+
+#endif
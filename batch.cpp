@@ -0,0 +1,444 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Batch Evaluation
+//
+//   batch [eval | qsearch | depth n] [file positions.epd]
+//         [output file] [threads n]
+//
+// Scores every FEN / EPD line of a file (memory-mapped) or,
+// from the command line ("maverick batch ..."), of stdin.
+// The input is cut into blocks of whole lines which a pool
+// of threads works through, and the blocks are written out
+// in input order as "<position> ce <score>;" (from the side
+// to move, plus "acd <n>;" for a search).  Each thread has
+// its own board and pawn hash, and the quiescent and fixed
+// depth searches (fixed_qsearch() and fixed_search()) don't
+// use the hash table, so a score never depends on the other
+// lines and the engine's hash table is left alone.
+//===========================================================//
+
+static struct t_batch_block *batch_block;
+static int batch_blocks;
+static long long batch_next_fill;
+static long long batch_next_work;
+static long long batch_next_write;
+static BOOL batch_finished;
+static t_mutex batch_mutex;
+static t_condition batch_condition;
+
+static t_batch_mode batch_mode;
+static int batch_depth;
+
+//-- The input (a mapped file or stdin)
+static char *batch_input;
+static size_t batch_input_size;
+static size_t batch_input_offset;
+static char batch_carry[BATCH_BLOCK_SIZE];
+static size_t batch_carry_length;
+
+static void batch_append(struct t_batch_block *b, char *s, int length)
+{
+    if (b->output_length + length + 1 > b->output_size) {
+        b->output_size = 2 * (b->output_size + length + 1);
+        b->output = (char *)realloc(b->output, b->output_size);
+    }
+    memcpy(b->output + b->output_length, s, length);
+    b->output_length += length;
+}
+
+static void batch_position(struct t_board *board, struct t_batch_block *b, char *text, size_t length)
+{
+    char line[1024];
+    char fen[1024];
+    char out[1024];
+    char *word[4];
+    t_chess_value score;
+    int n;
+
+    //-- Skip blank lines and comments quietly
+    while (length > 0 && (text[length - 1] == '\r' || text[length - 1] == ' ' || text[length - 1] == '\t'))
+        length--;
+    if (length == 0 || text[0] == '#')
+        return;
+    if (length >= sizeof(line)) {
+        b->skipped++;
+        return;
+    }
+    memcpy(line, text, length);
+    line[length] = '\0';
+
+    n = split_words(line, word, 4);
+    if (!is_valid_fen(word, n)) {
+        b->skipped++;
+        return;
+    }
+    snprintf(fen, sizeof(fen), "%s %s %s %s", word[0], word[1], word[2], word[3]);
+    set_fen(board, fen);
+    //-- The side which has just moved can't be in check
+    if (is_in_check(board, OPPONENT(board->to_move))) {
+        b->skipped++;
+        return;
+    }
+
+    clear_killers(board);
+
+    //-- The root is ply 1 so the move ordering can look back a ply
+    evaluate(board, board->pv_data[1].eval);
+    if (batch_mode == BATCH_EVAL)
+        score = board->pv_data[1].eval->static_score;
+    else if (batch_mode == BATCH_QSEARCH)
+        score = fixed_qsearch(board, 1, 0, -CHECKMATE, CHECKMATE, TRUE);
+    else
+        score = fixed_search(board, 1, batch_depth, -CHECKMATE, CHECKMATE);
+
+    //-- Mate distances from ply 0
+    if (score >= MAX_CHECKMATE)
+        score++;
+    else if (score <= -MAX_CHECKMATE)
+        score--;
+
+    if (batch_mode == BATCH_SEARCH)
+        n = snprintf(out, sizeof(out), "%s ce %d; acd %d;\n", fen, score, batch_depth);
+    else
+        n = snprintf(out, sizeof(out), "%s ce %d;\n", fen, score);
+    batch_append(b, out, n);
+    b->positions++;
+}
+
+static void batch_run_block(struct t_board *board, struct t_batch_block *b)
+{
+    char *p = b->data;
+    char *end = b->data + b->length;
+    char *eol;
+
+    b->output_length = 0;
+    b->positions = 0;
+    b->skipped = 0;
+
+    while (p < end) {
+        eol = (char *)memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        batch_position(board, b, p, eol - p);
+        p = eol + 1;
+    }
+}
+
+static unsigned __stdcall batch_worker(void* pArguments)
+{
+    struct t_board *board = (struct t_board *)malloc(sizeof(struct t_board));
+    struct t_batch_block *b;
+
+    numa_init_thread((int)(size_t)pArguments);
+    init_board(board);
+
+    mutex_lock(&batch_mutex);
+    for (;;) {
+        while (!batch_finished && batch_next_work == batch_next_fill)
+            condition_wait(&batch_condition, &batch_mutex);
+        if (batch_next_work == batch_next_fill)
+            break;
+
+        b = &batch_block[batch_next_work++ % batch_blocks];
+        b->state = batch_block_working;
+        mutex_unlock(&batch_mutex);
+
+        batch_run_block(board, b);
+
+        mutex_lock(&batch_mutex);
+        b->state = batch_block_done;
+        condition_broadcast(&batch_condition);
+    }
+    mutex_unlock(&batch_mutex);
+
+    numa_exit_thread();
+    free(board);
+    return 0;
+}
+
+//===========================================================//
+// Input
+//===========================================================//
+#if defined(_WIN32)
+
+static HANDLE batch_file = INVALID_HANDLE_VALUE;
+static HANDLE batch_mapping = NULL;
+
+static BOOL map_batch_file(char *filename)
+{
+    LARGE_INTEGER size;
+
+    batch_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (batch_file == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    if (GetFileSizeEx(batch_file, &size) && size.QuadPart > 0)
+        batch_mapping = CreateFileMapping(batch_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (batch_mapping != NULL)
+        batch_input = (char *)MapViewOfFile(batch_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (batch_input == NULL) {
+        if (batch_mapping != NULL)
+            CloseHandle(batch_mapping);
+        CloseHandle(batch_file);
+        batch_mapping = NULL;
+        batch_file = INVALID_HANDLE_VALUE;
+        return FALSE;
+    }
+
+    batch_input_size = (size_t)size.QuadPart;
+    return TRUE;
+}
+
+static void unmap_batch_file()
+{
+    UnmapViewOfFile(batch_input);
+    CloseHandle(batch_mapping);
+    CloseHandle(batch_file);
+    batch_mapping = NULL;
+    batch_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+static BOOL map_batch_file(char *filename)
+{
+    struct stat info;
+    void *p;
+    int fd;
+
+    if ((fd = open(filename, O_RDONLY)) < 0)
+        return FALSE;
+
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return FALSE;
+    }
+
+    p = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return FALSE;
+
+    madvise(p, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+    batch_input = (char *)p;
+    batch_input_size = (size_t)info.st_size;
+    return TRUE;
+}
+
+static void unmap_batch_file()
+{
+    munmap(batch_input, batch_input_size);
+}
+
+#endif
+
+//-- The next whole lines of the input (FALSE at the end)
+static BOOL batch_fill(struct t_batch_block *b)
+{
+    size_t n, end;
+
+    //-- Mapped file: a range of the mapping, ending on a line break
+    if (batch_input != NULL) {
+        if (batch_input_offset >= batch_input_size)
+            return FALSE;
+        end = min(batch_input_offset + BATCH_BLOCK_SIZE, batch_input_size);
+        while (end < batch_input_size && batch_input[end - 1] != '\n')
+            end++;
+        b->data = batch_input + batch_input_offset;
+        b->length = end - batch_input_offset;
+        batch_input_offset = end;
+        return TRUE;
+    }
+
+    //-- stdin: whatever was left over from the last block, topped up and cut at the last line break
+    if (b->buffer == NULL)
+        b->buffer = (char *)malloc(BATCH_BLOCK_SIZE);
+    memcpy(b->buffer, batch_carry, batch_carry_length);
+    n = batch_carry_length + fread(b->buffer + batch_carry_length, 1, BATCH_BLOCK_SIZE - batch_carry_length, stdin);
+    batch_carry_length = 0;
+    if (n == 0)
+        return FALSE;
+
+    end = n;
+    if (n == BATCH_BLOCK_SIZE) {
+        while (end > 0 && b->buffer[end - 1] != '\n')
+            end--;
+        if (end == 0)
+            end = n;
+        batch_carry_length = n - end;
+        memcpy(batch_carry, b->buffer + end, batch_carry_length);
+    }
+    b->data = b->buffer;
+    b->length = end;
+    return TRUE;
+}
+
+BOOL batch_evaluate(char *command, BOOL allow_stdin)
+{
+    static char options[1024];
+    static char s[1024];
+    static t_thread thread[BATCH_MAX_THREADS];
+    static struct t_board start_board[1];
+    struct t_batch_block *b;
+    char *word[64];
+    char *filename = NULL;
+    char *output = NULL;
+    unsigned long long start;
+    t_nodes positions = 0, skipped = 0;
+    double seconds;
+    int threads = numa.cpu_count;
+    int i, n;
+    BOOL exhausted = FALSE;
+    FILE *f = stdout;
+
+    //-- Options
+    batch_mode = BATCH_EVAL;
+    batch_depth = 0;
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "eval"))
+            batch_mode = BATCH_EVAL;
+        else if (!strcmp(word[i], "qsearch"))
+            batch_mode = BATCH_QSEARCH;
+        else if (!strcmp(word[i], "depth") && i < n - 1) {
+            batch_mode = BATCH_SEARCH;
+            batch_depth = atoi(word[++i]);
+        }
+        else if (!strcmp(word[i], "file") && i < n - 1)
+            filename = word[++i];
+        else if (!strcmp(word[i], "output") && i < n - 1)
+            output = word[++i];
+        else if (!strcmp(word[i], "threads") && i < n - 1)
+            threads = atoi(word[++i]);
+    }
+    threads = max(1, min(threads, BATCH_MAX_THREADS));
+    batch_depth = max(1, min(batch_depth, BATCH_MAX_DEPTH));
+
+    if (filename == NULL && !allow_stdin) {
+        send_info("Batch: \"file\" is needed (stdin can only be used with \"maverick batch ...\")");
+        return FALSE;
+    }
+
+    uci_wait_for_search();
+
+    //-- The input
+    batch_input = NULL;
+    batch_input_size = 0;
+    batch_input_offset = 0;
+    batch_carry_length = 0;
+    if (filename != NULL && !map_batch_file(filename)) {
+        snprintf(s, sizeof(s), "Batch: unable to read %s", filename);
+        send_info(s);
+        return FALSE;
+    }
+    if (output != NULL && (f = fopen(output, "w")) == NULL) {
+        snprintf(s, sizeof(s), "Batch: unable to write %s", output);
+        send_info(s);
+        if (batch_input != NULL)
+            unmap_batch_file();
+        return FALSE;
+    }
+
+    //-- Standard castling tables (set_fen() only changes them for Chess960) and a search which isn't stopped
+    init_board(start_board);
+    new_game(start_board);
+    uci.stop = FALSE;
+
+    batch_blocks = BATCH_BLOCKS_PER_THREAD * threads;
+    batch_block = (struct t_batch_block *)calloc(batch_blocks, sizeof(struct t_batch_block));
+    batch_next_fill = batch_next_work = batch_next_write = 0;
+    batch_finished = FALSE;
+    mutex_init(&batch_mutex);
+    condition_init(&batch_condition);
+
+    start = time_now_ns();
+    for (i = 0; i < threads; i++)
+        thread_create(&thread[i], batch_worker, (void *)(size_t)i);
+
+    //-- Keep the queue full and write the blocks out in order as they finish
+    mutex_lock(&batch_mutex);
+    for (;;) {
+        b = &batch_block[batch_next_write % batch_blocks];
+        if (batch_next_write < batch_next_fill && b->state == batch_block_done) {
+            mutex_unlock(&batch_mutex);
+            fwrite(b->output, 1, b->output_length, f);
+            positions += b->positions;
+            skipped += b->skipped;
+            mutex_lock(&batch_mutex);
+            b->state = batch_block_free;
+            batch_next_write++;
+            continue;
+        }
+
+        if (!exhausted && batch_next_fill - batch_next_write < batch_blocks) {
+            b = &batch_block[batch_next_fill % batch_blocks];
+            mutex_unlock(&batch_mutex);
+            exhausted = !batch_fill(b);
+            mutex_lock(&batch_mutex);
+            if (!exhausted) {
+                b->state = batch_block_filled;
+                batch_next_fill++;
+                condition_broadcast(&batch_condition);
+            }
+            continue;
+        }
+
+        if (exhausted && batch_next_write == batch_next_fill)
+            break;
+        condition_wait(&batch_condition, &batch_mutex);
+    }
+    batch_finished = TRUE;
+    condition_broadcast(&batch_condition);
+    mutex_unlock(&batch_mutex);
+
+    for (i = 0; i < threads; i++)
+        thread_join(thread[i]);
+    fflush(f);
+    seconds = (time_now_ns() - start) / 1e9;
+
+    for (i = 0; i < batch_blocks; i++) {
+        free(batch_block[i].buffer);
+        free(batch_block[i].output);
+    }
+    free(batch_block);
+    if (f != stdout)
+        fclose(f);
+    if (batch_input != NULL)
+        unmap_batch_file();
+
+    sprintf(s, "Batch: " NODE_FORMAT " positions (" NODE_FORMAT " skipped) in %.2f seconds = %.0f positions/s on %d threads", positions, skipped, seconds,
+        (seconds > 0) ? positions / seconds : 0.0, threads);
+
+    //-- Results on stdout are kept apart from the report
+    if (f == stdout)
+        fprintf(stderr, "%s\n", s);
+    else
+        send_info(s);
+
+    return TRUE;
+}
@@ -0,0 +1,316 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+#include "profile.h"
+
+//===========================================================//
+// Bench
+//
+//   bench [depth n] [hash mb] [file positions.epd] [json | csv]
+//         [output file] [save file] [baseline file] [threshold pct]
+//
+// Each position is searched to a fixed depth from a cleared
+// hash table, so the total node count is a signature of the
+// search: any change to it means the search has changed.  An
+// EPD line can set its own depth with "acd n;".  A baseline
+// is a file written by "save" and the bench fails if the
+// signature differs or the speed drops by more than the
+// threshold.
+//===========================================================//
+
+static struct t_bench_position bench_default[] = {
+    { "8/8/8/4k2K/1R3p2/8/6r1/8 w - -", 20 },
+    { "1rq5/p3kp2/2Bp1p2/1P2p1r1/QP3n2/2P5/5PPP/R4RK1 b - -", 12 },
+    { "1NQ5/k1p1p3/7p/pP2P1P1/2P5/2pq4/1n6/6K1 w - -", 12 },
+    { "2kr3r/pp1q1ppp/5n2/1Nb5/2Pp1B2/7Q/P4PPP/1R3RK1 w - -", 16 },
+    { "8/5p2/pk2p3/4P2p/2b1pP1P/P3P2B/8/7K w - -", 24 },
+    { "5rk1/2p4p/2p4r/3P4/4p1b1/1Q2NqPp/PP3P1K/R4R2 b - -", 16 }
+};
+
+static struct t_bench_position bench_position[BENCH_MAX_POSITIONS];
+static int bench_count;
+
+//-- One position per line: the FEN (or EPD) fields and an optional "acd n;"
+static BOOL read_bench_file(char *filename, int depth)
+{
+    static char line[1024];
+    static char s[1024];
+    char *word[64];
+    char *fen;
+    FILE *f;
+    int n, i, fields, length;
+    int line_number = 0;
+
+    if ((f = fopen(filename, "r")) == NULL)
+        return FALSE;
+
+    bench_count = 0;
+    while (bench_count < BENCH_MAX_POSITIONS && fgets(line, sizeof(line), f) != NULL) {
+
+        line_number++;
+        for (i = 0; line[i]; i++)
+            if (line[i] == '\r' || line[i] == '\n' || line[i] == ';')
+                line[i] = ' ';
+        n = split_words(line, word, 64);
+        if (n < 4 || word[0][0] == '#')
+            continue;
+
+        //-- Board, side, castling, ep and (for a FEN) the move counters
+        fields = 4;
+        while (fields < n && fields < 6 && is_number(word[fields]))
+            fields++;
+
+        //-- Reject a position which doesn't fit rather than cut it short
+        fen = bench_position[bench_count].fen;
+        length = 0;
+        for (i = 0; i < fields && length < (int)sizeof(bench_position[bench_count].fen); i++)
+            length += snprintf(fen + length, sizeof(bench_position[bench_count].fen) - length, (i > 0) ? " %s" : "%s", word[i]);
+        if (length >= (int)sizeof(bench_position[bench_count].fen)) {
+            snprintf(s, sizeof(s), "Bench: skipping line %d of %.900s, the position is too long", line_number, filename);
+            send_command(s);
+            continue;
+        }
+
+        bench_position[bench_count].depth = depth ? depth : BENCH_DEFAULT_DEPTH;
+        for (i = fields; i < n - 1; i++) {
+            if (!strcmp(word[i], "acd") && !depth)
+                bench_position[bench_count].depth = atoi(word[i + 1]);
+        }
+        bench_count++;
+    }
+
+    fclose(f);
+    return bench_count > 0;
+}
+
+static void bench_line(FILE *f, char *s)
+{
+    if (f != NULL)
+        fprintf(f, "%s\n", s);
+    else
+        send_command(s);
+}
+
+static void write_bench_report(FILE *f, t_bench_format format, int hash, t_nodes total_nodes, t_chess_time total_time)
+{
+    static char s[1024];
+    struct t_bench_position *p;
+    t_nodes nps;
+    int i;
+
+    if (format == BENCH_JSON) {
+        sprintf(s, "{\"hash\": %d, \"positions\": [", hash);
+        bench_line(f, s);
+    }
+    else if (format == BENCH_CSV) {
+        strcpy(s, "position,fen,depth,nodes,time,nps,bestmove");
+        bench_line(f, s);
+    }
+
+    for (i = 0; i < bench_count; i++) {
+        p = &bench_position[i];
+        nps = (p->time > 0) ? 1000 * p->nodes / p->time : 0;
+
+        if (format == BENCH_JSON)
+            snprintf(s, sizeof(s), "  {\"fen\": \"%.255s\", \"depth\": %d, \"nodes\": " NODE_FORMAT ", \"time\": %ld, \"nps\": " NODE_FORMAT ", \"bestmove\": \"%s\"}%s",
+                p->fen, p->depth, p->nodes, p->time, nps, p->best_move, (i < bench_count - 1) ? "," : "");
+        else if (format == BENCH_CSV)
+            snprintf(s, sizeof(s), "%d,%.255s,%d," NODE_FORMAT ",%ld," NODE_FORMAT ",%s", i + 1, p->fen, p->depth, p->nodes, p->time, nps, p->best_move);
+        else
+            sprintf(s, "Position %d: depth %d nodes " NODE_FORMAT " time %ld nps " NODE_FORMAT " bestmove %s", i + 1, p->depth, p->nodes, p->time, nps, p->best_move);
+        bench_line(f, s);
+    }
+
+    nps = (total_time > 0) ? 1000 * total_nodes / total_time : 0;
+    if (format == BENCH_JSON) {
+        sprintf(s, "], \"nodes\": " NODE_FORMAT ", \"time\": %ld, \"nps\": " NODE_FORMAT ", \"signature\": " NODE_FORMAT "}", total_nodes, total_time, nps, total_nodes);
+        bench_line(f, s);
+    }
+    else if (format == BENCH_CSV) {
+        sprintf(s, "total,,," NODE_FORMAT ",%ld," NODE_FORMAT ",", total_nodes, total_time, nps);
+        bench_line(f, s);
+    }
+    else {
+        sprintf(s, INFO_STRING_PERFT_SPEED, total_nodes, (int)total_time, nps);
+        bench_line(f, s);
+        sprintf(s, "Signature: " NODE_FORMAT, total_nodes);
+        bench_line(f, s);
+    }
+}
+
+//-- Compare against a file written by "save"
+static BOOL compare_bench_baseline(char *filename, t_nodes signature, t_nodes nps, int threshold)
+{
+    static char s[1024];
+    t_nodes base_signature = 0;
+    t_nodes base_nps = 0;
+    BOOL ok = TRUE;
+    FILE *f;
+
+    if ((f = fopen(filename, "r")) == NULL) {
+        snprintf(s, sizeof(s), "Bench: unable to open baseline %.900s", filename);
+        send_command(s);
+        return FALSE;
+    }
+    if (fscanf(f, "signature " NODE_FORMAT " nps " NODE_FORMAT, &base_signature, &base_nps) != 2) {
+        snprintf(s, sizeof(s), "Bench: %.900s isn't a bench baseline", filename);
+        send_command(s);
+        fclose(f);
+        return FALSE;
+    }
+    fclose(f);
+
+    if (signature != base_signature) {
+        sprintf(s, "Bench: FAIL - signature " NODE_FORMAT " differs from the baseline " NODE_FORMAT, signature, base_signature);
+        send_command(s);
+        ok = FALSE;
+    }
+    if (nps * 100 < base_nps * (100 - threshold)) {
+        sprintf(s, "Bench: FAIL - nps " NODE_FORMAT " is more than %d%% below the baseline " NODE_FORMAT, nps, threshold, base_nps);
+        send_command(s);
+        ok = FALSE;
+    }
+    if (ok) {
+        sprintf(s, "Bench: OK - signature matches and nps " NODE_FORMAT " against a baseline of " NODE_FORMAT, nps, base_nps);
+        send_command(s);
+    }
+    return ok;
+}
+
+BOOL bench(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    char *word[64];
+    char *filename = NULL;
+    char *output = NULL;
+    char *save = NULL;
+    char *baseline = NULL;
+    int depth = 0;
+    int hash = BENCH_DEFAULT_HASH;
+    int threshold = BENCH_DEFAULT_THRESHOLD;
+    int previous_hash = uci.options.hash_table_size;
+    BOOL previous_own_book = uci.opening_book.use_own_book;
+    t_bench_format format = BENCH_TEXT;
+    t_nodes total_nodes = 0;
+    t_chess_time total_time = 0;
+    t_chess_time start_time;
+    BOOL ok = TRUE;
+    FILE *f = NULL;
+    int i, n;
+
+    //-- Options
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "json"))
+            format = BENCH_JSON;
+        else if (!strcmp(word[i], "csv"))
+            format = BENCH_CSV;
+        else if (i == n - 1)
+            break;
+        else if (!strcmp(word[i], "depth"))
+            depth = atoi(word[++i]);
+        else if (!strcmp(word[i], "hash"))
+            hash = atoi(word[++i]);
+        else if (!strcmp(word[i], "file"))
+            filename = word[++i];
+        else if (!strcmp(word[i], "output"))
+            output = word[++i];
+        else if (!strcmp(word[i], "save"))
+            save = word[++i];
+        else if (!strcmp(word[i], "baseline"))
+            baseline = word[++i];
+        else if (!strcmp(word[i], "threshold"))
+            threshold = atoi(word[++i]);
+    }
+
+    //-- Positions
+    if (filename != NULL) {
+        if (!read_bench_file(filename, depth)) {
+            snprintf(s, sizeof(s), "Bench: unable to read any positions from %s", filename);
+            send_command(s);
+            return FALSE;
+        }
+    }
+    else {
+        bench_count = sizeof(bench_default) / sizeof(struct t_bench_position);
+        for (i = 0; i < bench_count; i++) {
+            bench_position[i] = bench_default[i];
+            if (depth)
+                bench_position[i].depth = depth;
+        }
+    }
+
+    uci_set_mode();
+    uci_isready();
+
+    set_hash(max(1, hash));
+    set_own_book(FALSE);
+
+    //-- Each position starts from a clear hash table so the node counts don't depend on the order
+    PROFILER(profile_bench_start());
+    for (i = 0; i < bench_count; i++) {
+        uci_new_game(position);
+
+        snprintf(s, sizeof(s), "position fen %.255s", bench_position[i].fen);
+        uci_position(position, s);
+        sprintf(s, "go depth %d", bench_position[i].depth);
+
+        start_time = time_now();
+        uci_go(s);
+        uci_wait_for_search();
+
+        bench_position[i].time = time_now() - start_time;
+        bench_position[i].nodes = nodes + qnodes;
+        if (position->pv_data[0].best_line_length > 0)
+            strcpy(bench_position[i].best_move, move_as_str(position->pv_data[0].best_line[0]));
+        else
+            strcpy(bench_position[i].best_move, "none");
+
+        total_nodes += bench_position[i].nodes;
+        total_time += bench_position[i].time;
+    }
+    global_nodes = total_nodes;
+    PROFILER(profile_bench_end());
+
+    //-- Report
+    if (output != NULL && (f = fopen(output, "w")) == NULL) {
+        snprintf(s, sizeof(s), "Bench: unable to write %.900s", output);
+        send_command(s);
+    }
+    write_bench_report(f, format, hash, total_nodes, total_time);
+    if (f != NULL)
+        fclose(f);
+
+    if (save != NULL) {
+        if ((f = fopen(save, "w")) != NULL) {
+            fprintf(f, "signature " NODE_FORMAT "\nnps " NODE_FORMAT "\n", total_nodes, (total_time > 0) ? 1000 * total_nodes / total_time : 0);
+            fclose(f);
+        }
+        else {
+            snprintf(s, sizeof(s), "Bench: unable to write %.900s", save);
+            send_command(s);
+            ok = FALSE;
+        }
+    }
+
+    if (baseline != NULL)
+        ok &= compare_bench_baseline(baseline, total_nodes, (total_time > 0) ? 1000 * total_nodes / total_time : 0, threshold);
+
+    set_hash(previous_hash);
+    set_own_book(previous_own_book);
+
+    return ok;
+}
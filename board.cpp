@@ -273,6 +273,34 @@ void init_board(struct t_board *board)
         board->pv_data[i].in_check = FALSE;
         init_eval(board->pv_data[i].eval);
     }
+    board->nnue_version = 0;
+}
+
+//-- Copy the position (but not the search data) into a board which has been through init_board
+void copy_board(struct t_board *to, struct t_board *from)
+{
+    memcpy(to->piecelist, from->piecelist, sizeof(from->piecelist));
+    to->all_pieces = from->all_pieces;
+    to->occupied[WHITE] = from->occupied[WHITE];
+    to->occupied[BLACK] = from->occupied[BLACK];
+    to->to_move = from->to_move;
+    to->hash = from->hash;
+    to->pawn_hash = from->pawn_hash;
+    to->material_hash = from->material_hash;
+    to->chess960 = from->chess960;
+    to->castling = from->castling;
+    to->ep_square = from->ep_square;
+    to->king_square[WHITE] = from->king_square[WHITE];
+    to->king_square[BLACK] = from->king_square[BLACK];
+    to->in_check = from->in_check;
+    to->check_attacker = from->check_attacker;
+    memcpy(to->square, from->square, sizeof(from->square));
+    to->fifty_move_count = from->fifty_move_count;
+    to->castling_squares_changed = from->castling_squares_changed;
+    memcpy(to->draw_stack, from->draw_stack, (from->draw_stack_count + 1) * sizeof(t_hash));
+    to->draw_stack_count = from->draw_stack_count;
+    memcpy(to->nnue_accumulator, from->nnue_accumulator, sizeof(from->nnue_accumulator));
+    to->nnue_version = from->nnue_version;
 }
 
 // Add a piece to the board!
@@ -289,6 +317,7 @@ void add_piece(struct t_board *board, t_chess_piece piece, t_chess_square target
     board->all_pieces |= square64;
 
     board->square[target_square] = piece;
+    board->nnue_version = 0;
 
     board->hash ^= hash_value[piece][target_square];
 
@@ -318,6 +347,7 @@ void remove_piece(struct t_board *board, t_chess_square target_square)
     board->all_pieces ^= square64;
 
     board->square[target_square] = BLANK;
+    board->nnue_version = 0;
     board->hash ^= hash_value[piece][target_square];
 
     switch (PIECETYPE(piece)) {
@@ -358,6 +388,7 @@ void clear_board(struct t_board *board)
     board->hash = 0;
     board->pawn_hash = 0;
     board->to_move = WHITE;
+    board->nnue_version = 0;
 }
 
 void new_game(struct t_board *board)
@@ -376,7 +407,7 @@ t_chess_square name_to_index(char *name)
 
 char *move_as_str(struct t_move_record *move)
 {
-    static char s[10];
+    static THREAD_LOCAL char s[10];
 
     t_chess_square from_square, to_square;
     t_chess_piece promote;
@@ -0,0 +1,827 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Polyglot Book Builder
+//
+//   maverick makebook <book.bin> <games.pgn>... [-depth plies]
+//                     [-threads n] [-memory mb] [-min games]
+//
+// The PGN files are read a game at a time and handed to the
+// worker threads, which play the moves on their own boards and
+// count (key, move) pairs in a hash table.  When a table fills
+// up it's sorted and written to a temporary run, and at the end
+// the runs are merged into a sorted Polyglot book.
+//===========================================================//
+
+//-- Settings
+static int book_depth;
+static int book_min_games;
+static size_t book_table_size;
+
+//-- Games waiting to be played through
+static struct t_book_game *book_queue;
+static int book_queue_head;
+static int book_queue_tail;
+static BOOL book_reading_done;
+static const char *book_error;			// The first failure (NULL if none)
+static t_mutex book_mutex;
+static t_condition book_condition;
+
+//-- Sorted runs written by the workers
+static FILE *book_run[BOOK_MAX_RUNS];
+static int book_run_count;
+
+//-- Statistics
+static t_nodes book_games;
+static t_nodes book_positions;
+static t_nodes book_errors;
+
+static int compare_book_entries(const void *a, const void *b)
+{
+    const struct t_book_entry *x = (const struct t_book_entry *)a;
+    const struct t_book_entry *y = (const struct t_book_entry *)b;
+
+    if (x->key != y->key)
+        return (x->key < y->key) ? -1 : 1;
+    if (x->move != y->move)
+        return (x->move < y->move) ? -1 : 1;
+    return 0;
+}
+
+static void write_integer(FILE *f, unsigned long long n, int size)
+{
+    for (int i = size - 1; i >= 0; i--)
+        fputc((int)((n >> (8 * i)) & 0xff), f);
+}
+
+//-- Polyglot move encoding (the inverse of decode_move)
+static unsigned int polyglot_move(struct t_move_record *move)
+{
+    unsigned int to_square = move->to_square;
+    unsigned int promote = 0;
+
+    //-- Castling is "king takes rook"
+    if (move->move_type == MOVE_CASTLE)
+        to_square = castle[move->index].rook_from;
+
+    if (move->promote_to != BLANK)
+        promote = PIECETYPE(move->promote_to);
+
+    return (promote << 12) | ((unsigned int)move->from_square << 6) | to_square;
+}
+
+//===========================================================//
+// Standard Algebraic Notation
+//===========================================================//
+static int san_piece(char c)
+{
+    switch (c) {
+    case 'N': return KNIGHT;
+    case 'B': return BISHOP;
+    case 'R': return ROOK;
+    case 'Q': return QUEEN;
+    case 'K': return KING;
+    }
+    return BLANK;
+}
+
+struct t_move_record *parse_san(struct t_board *board, struct t_move_list *moves, char *token)
+{
+    char s[16];
+    int i, n, length;
+    int piece = PAWN;
+    int promote = BLANK;
+    int from_file = -1;
+    int from_rank = -1;
+    t_chess_square to_square;
+    struct t_move_record *move;
+    struct t_move_record *found = NULL;
+
+    strncpy(s, token, sizeof(s) - 1);
+    s[sizeof(s) - 1] = '\0';
+
+    //-- Remove check marks and annotations
+    length = (int)strlen(s);
+    while (length > 0 && strchr("+#!?", s[length - 1]) != NULL)
+        s[--length] = '\0';
+    if (length < 2)
+        return NULL;
+
+    //-- Castling
+    if (!strcmp(s, "O-O") || !strcmp(s, "0-0") || !strcmp(s, "O-O-O") || !strcmp(s, "0-0-0")) {
+        BOOL kingside = (length == 3);
+        for (i = 0; i < moves->count; i++) {
+            move = moves->move[i];
+            if (move->move_type == MOVE_CASTLE && ((move->to_square > move->from_square) == kingside))
+                return move;
+        }
+        return NULL;
+    }
+
+    //-- Promotion ("e8=Q" or "e8Q")
+    if (length >= 4 && s[length - 2] == '=') {
+        promote = san_piece(s[length - 1]);
+        length -= 2;
+    }
+    else if (length >= 3 && san_piece(s[length - 1]) != BLANK && isdigit(s[length - 2])) {
+        promote = san_piece(s[length - 1]);
+        length -= 1;
+    }
+    s[length] = '\0';
+
+    //-- Piece
+    n = 0;
+    if (san_piece(s[0]) != BLANK)
+        piece = san_piece(s[n++]);
+
+    //-- Destination
+    if (length - n < 2 || s[length - 2] < 'a' || s[length - 2] > 'h' || s[length - 1] < '1' || s[length - 1] > '8')
+        return NULL;
+    to_square = (t_chess_square)(8 * (s[length - 1] - '1') + (s[length - 2] - 'a'));
+
+    //-- Disambiguation
+    for (i = n; i < length - 2; i++) {
+        if (s[i] >= 'a' && s[i] <= 'h')
+            from_file = s[i] - 'a';
+        else if (s[i] >= '1' && s[i] <= '8')
+            from_rank = s[i] - '1';
+    }
+
+    //-- Find the one legal move which matches
+    for (i = 0; i < moves->count; i++) {
+        move = moves->move[i];
+        if (move->move_type == MOVE_CASTLE || PIECETYPE(move->piece) != piece || move->to_square != to_square)
+            continue;
+        if ((from_file >= 0 && COLUMN(move->from_square) != from_file) || (from_rank >= 0 && RANK(move->from_square) != from_rank))
+            continue;
+        if ((move->promote_to == BLANK ? BLANK : PIECETYPE(move->promote_to)) != promote)
+            continue;
+        if (found != NULL)
+            return NULL;
+        found = move;
+    }
+
+    return found;
+}
+
+//-- Write one of the legal "moves" in SAN (e.g. "Nbxd7+"), which needs the board to look for checks
+char *move_as_san(struct t_board *board, struct t_move_list *moves, struct t_move_record *move, char *s)
+{
+    static const char piece_letter[] = " NBRQPK";
+    struct t_move_list replies[1];
+    struct t_move_record *other;
+    struct t_undo undo[1];
+    BOOL same_file = FALSE, same_rank = FALSE, ambiguous = FALSE;
+    int i, n = 0;
+
+    if (move->move_type == MOVE_CASTLE) {
+        strcpy(s, (move->to_square > move->from_square) ? "O-O" : "O-O-O");
+        n = (int)strlen(s);
+    }
+    else {
+        if (PIECETYPE(move->piece) != PAWN) {
+            s[n++] = piece_letter[PIECETYPE(move->piece)];
+
+            //-- Another piece of the same kind which can go to the same square
+            for (i = 0; i < moves->count; i++) {
+                other = moves->move[i];
+                if (other == move || other->move_type == MOVE_CASTLE || other->piece != move->piece || other->to_square != move->to_square)
+                    continue;
+                ambiguous = TRUE;
+                same_file |= (COLUMN(other->from_square) == COLUMN(move->from_square));
+                same_rank |= (RANK(other->from_square) == RANK(move->from_square));
+            }
+            if (ambiguous && (!same_file || same_rank))
+                s[n++] = 'a' + COLUMN(move->from_square);
+            if (ambiguous && same_file)
+                s[n++] = '1' + RANK(move->from_square);
+        }
+        else if (move->captured != BLANK || move->move_type == MOVE_PxP_EP)
+            s[n++] = 'a' + COLUMN(move->from_square);
+
+        if (move->captured != BLANK || move->move_type == MOVE_PxP_EP)
+            s[n++] = 'x';
+        s[n++] = 'a' + COLUMN(move->to_square);
+        s[n++] = '1' + RANK(move->to_square);
+
+        if (move->promote_to != BLANK) {
+            s[n++] = '=';
+            s[n++] = piece_letter[PIECETYPE(move->promote_to)];
+        }
+    }
+
+    //-- Check or mate
+    make_move(board, moves->pinned_pieces, move, undo);
+    if (board->in_check) {
+        generate_legal_moves(board, replies);
+        s[n++] = (replies->count == 0) ? '#' : '+';
+    }
+    unmake_move(board, undo);
+
+    s[n] = '\0';
+    return s;
+}
+
+static t_nodes merge_runs(FILE **run, int count, FILE *out, BOOL book);
+
+//-- Everyone stops, and make_book() reports it once the workers have finished (called with book_mutex held)
+static void book_failure(const char *error)
+{
+    if (book_error == NULL)
+        book_error = error;
+    condition_broadcast(&book_condition);
+}
+
+//-- Merge the last quarter of the runs into one (called with book_mutex held)
+static void merge_last_runs()
+{
+    FILE *merged = tmpfile();
+    int n = BOOK_MAX_RUNS / 4;
+    int i;
+
+    if (merged == NULL) {
+        book_failure("Book builder: unable to write a temporary file");
+        return;
+    }
+
+    merge_runs(book_run + book_run_count - n, n, merged, FALSE);
+    for (i = book_run_count - n; i < book_run_count; i++)
+        fclose(book_run[i]);
+
+    rewind(merged);
+    book_run_count -= n;
+    book_run[book_run_count++] = merged;
+}
+
+//===========================================================//
+// Hash table of (key, move) counts for each worker
+//===========================================================//
+static void add_run(struct t_book_entry *table, size_t *count)
+{
+    size_t i, n = 0;
+    FILE *f;
+
+    if (*count == 0)
+        return;
+
+    //-- Pack and sort the entries
+    for (i = 0; i < book_table_size; i++) {
+        if (table[i].games)
+            table[n++] = table[i];
+    }
+    qsort(table, n, sizeof(struct t_book_entry), compare_book_entries);
+
+    //-- ...and write them out as a run
+    f = tmpfile();
+    if (f == NULL || fwrite(table, sizeof(struct t_book_entry), n, f) != n) {
+        if (f != NULL)
+            fclose(f);
+        mutex_lock(&book_mutex);
+        book_failure("Book builder: unable to write a temporary file");
+        mutex_unlock(&book_mutex);
+        return;
+    }
+    rewind(f);
+
+    mutex_lock(&book_mutex);
+    if (book_run_count == BOOK_MAX_RUNS)
+        merge_last_runs();
+    if (book_error == NULL)
+        book_run[book_run_count++] = f;
+    else
+        fclose(f);
+    mutex_unlock(&book_mutex);
+
+    memset(table, 0, book_table_size * sizeof(struct t_book_entry));
+    *count = 0;
+}
+
+static void add_entry(struct t_book_entry *table, size_t *count, t_hash key, unsigned int move, unsigned int weight)
+{
+    size_t i = (size_t)((key ^ (move * 0x9E3779B97F4A7C15ULL)) & (book_table_size - 1));
+
+    while (table[i].games && (table[i].key != key || table[i].move != move))
+        i = (i + 1) & (book_table_size - 1);
+
+    if (table[i].games == 0) {
+        table[i].key = key;
+        table[i].move = move;
+        (*count)++;
+    }
+    table[i].weight += weight;
+    table[i].games++;
+
+    //-- Keep the table three quarters full at most
+    if (*count * 4 >= book_table_size * 3)
+        add_run(table, count);
+}
+
+//===========================================================//
+// Worker threads
+//===========================================================//
+
+//-- Play through the game, returning the number of positions added
+static int add_game(struct t_board *board, struct t_book_entry *table, size_t *count, struct t_book_game *game)
+{
+    struct t_move_list moves[1];
+    struct t_undo undo[1];
+    struct t_move_record *move;
+    char token[64];
+    char *p = game->moves;
+    int n, ply = 0, level = 0;
+
+    //-- set_fen() shares a few tables (e.g. for castling) so only one thread at a time
+    mutex_lock(&book_mutex);
+    set_fen(board, game->fen);
+    mutex_unlock(&book_mutex);
+
+    while (*p && ply < book_depth) {
+
+        //-- Comments, variations and annotations
+        if (isspace((unsigned char)*p) || *p == '.') {
+            p++;
+            continue;
+        }
+        if (*p == '{') {
+            while (*p && *p != '}')
+                p++;
+            if (*p)
+                p++;
+            continue;
+        }
+        if (*p == ';') {
+            while (*p && *p != '\n')
+                p++;
+            continue;
+        }
+        if (*p == '(' || *p == ')') {
+            level = max(0, level + ((*p == '(') ? 1 : -1));
+            p++;
+            continue;
+        }
+
+        //-- The next word
+        n = 0;
+        while (*p && !isspace((unsigned char)*p) && !strchr("{};()", *p)) {
+            if (n < (int)sizeof(token) - 1)
+                token[n++] = *p;
+            p++;
+        }
+        token[n] = '\0';
+
+        if (n == 0) {
+            p++;
+            continue;
+        }
+        if (level > 0 || token[0] == '$')
+            continue;
+
+        //-- The end of the game
+        if (!strcmp(token, "1-0") || !strcmp(token, "0-1") || !strcmp(token, "1/2-1/2") || !strcmp(token, "*"))
+            break;
+
+        //-- Skip the move number (which may be stuck to the move, e.g. "12.e4")
+        char *san = token;
+        if (isdigit((unsigned char)*san) && strcmp(san, "0-0") && strcmp(san, "0-0-0")) {
+            while (isdigit((unsigned char)*san))
+                san++;
+            while (*san == '.')
+                san++;
+            if (*san == '\0')
+                continue;
+        }
+
+        generate_legal_moves(board, moves);
+        move = parse_san(board, moves, san);
+        if (move == NULL)
+            return -ply - 1;
+
+        //-- A win is worth two and a draw one to the side which played the move
+        unsigned int weight = (game->result == 0) ? 1 : ((game->result > 0) == (board->to_move == WHITE)) ? 2 : 0;
+        add_entry(table, count, board->hash, polyglot_move(move), weight);
+
+        make_move(board, moves->pinned_pieces, move, undo);
+        ply++;
+    }
+
+    return ply;
+}
+
+static unsigned __stdcall book_worker(void* pArguments)
+{
+    struct t_board *board = (struct t_board *)malloc(sizeof(struct t_board));
+    struct t_book_entry *table = (struct t_book_entry *)calloc(book_table_size, sizeof(struct t_book_entry));
+    struct t_book_game *game = (struct t_book_game *)malloc(sizeof(struct t_book_game));
+    size_t count = 0;
+    int n;
+
+    if (board == NULL || table == NULL || game == NULL) {
+        mutex_lock(&book_mutex);
+        book_failure("Book builder: not enough memory");
+        mutex_unlock(&book_mutex);
+        free(game);
+        free(table);
+        free(board);
+        return(0);
+    }
+    init_board(board);
+
+    mutex_lock(&book_mutex);
+    while (TRUE) {
+
+        //-- Wait for a game
+        while (book_queue_head == book_queue_tail && !book_reading_done && book_error == NULL)
+            condition_wait(&book_condition, &book_mutex);
+        if (book_queue_head == book_queue_tail || book_error != NULL)
+            break;
+
+        memcpy(game, &book_queue[book_queue_tail % BOOK_QUEUE_SIZE], sizeof(struct t_book_game));
+        book_queue_tail++;
+        condition_broadcast(&book_condition);
+        mutex_unlock(&book_mutex);
+
+        n = add_game(board, table, &count, game);
+
+        mutex_lock(&book_mutex);
+        book_games++;
+        if (n < 0) {
+            book_errors++;
+            n = -n - 1;
+        }
+        book_positions += n;
+    }
+    mutex_unlock(&book_mutex);
+
+    //-- Whatever is left becomes the last run
+    add_run(table, &count);
+
+    free(game);
+    free(table);
+    free(board);
+    return(0);
+}
+
+//===========================================================//
+// Reading the PGN files
+//===========================================================//
+static void queue_game(struct t_book_game *game)
+{
+    mutex_lock(&book_mutex);
+    while (book_queue_head - book_queue_tail >= BOOK_QUEUE_SIZE && book_error == NULL)
+        condition_wait(&book_condition, &book_mutex);
+
+    //-- Nothing more is played through after a failure
+    if (book_error != NULL) {
+        mutex_unlock(&book_mutex);
+        return;
+    }
+
+    struct t_book_game *slot = &book_queue[book_queue_head % BOOK_QUEUE_SIZE];
+    strcpy(slot->fen, game->fen);
+    slot->result = game->result;
+    strcpy(slot->moves, game->moves);
+    book_queue_head++;
+
+    condition_broadcast(&book_condition);
+    mutex_unlock(&book_mutex);
+}
+
+//-- The value of a tag, e.g. [Result "1-0"]
+BOOL read_pgn_tag(const char *line, const char *name, char *value, size_t size)
+{
+    size_t n = strlen(name);
+    const char *p;
+
+    if (strncmp(line + 1, name, n) || line[n + 1] != ' ' || (p = strchr(line, '"')) == NULL)
+        return FALSE;
+
+    n = 0;
+    for (p++; *p && *p != '"' && n < size - 1; p++)
+        value[n++] = *p;
+    value[n] = '\0';
+    return TRUE;
+}
+
+static void read_pgn(char *filename, struct t_book_game *game)
+{
+    static char line[BOOK_GAME_SIZE];
+    static char value[256];
+    FILE *f;
+    size_t length = 0, n;
+    BOOL in_moves = FALSE;
+    BOOL skip = FALSE;
+
+    if ((f = fopen(filename, "r")) == NULL) {
+        sprintf(line, "Book builder: unable to open %s", filename);
+        send_info(line);
+        return;
+    }
+
+    //-- Start with an empty game
+    strcpy(game->fen, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -");
+    game->result = 2;
+    game->moves[0] = '\0';
+
+    while (TRUE) {
+        BOOL eof = (fgets(line, sizeof(line), f) == NULL);
+
+        //-- A tag after the moves (or the end of the file) finishes the game
+        if (eof || (line[0] == '[' && in_moves)) {
+            if (in_moves && !skip && game->result != 2)
+                queue_game(game);
+
+            strcpy(game->fen, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -");
+            game->result = 2;
+            game->moves[0] = '\0';
+            length = 0;
+            in_moves = FALSE;
+            skip = FALSE;
+
+            if (eof)
+                break;
+        }
+
+        if (line[0] == '[') {
+            if (read_pgn_tag(line, "Result", value, sizeof(value))) {
+                if (!strcmp(value, "1-0"))
+                    game->result = 1;
+                else if (!strcmp(value, "0-1"))
+                    game->result = -1;
+                else if (!strcmp(value, "1/2-1/2"))
+                    game->result = 0;
+            }
+            else if (read_pgn_tag(line, "FEN", value, sizeof(value))) {
+                strcpy(game->fen, value);
+
+                //-- Only standard castling rights (no Chess960)
+                char *castling = strchr(value, ' ');
+                if (castling != NULL && (castling = strchr(castling + 1, ' ')) != NULL) {
+                    for (castling++; *castling && *castling != ' '; castling++)
+                        if (strchr("KQkq-", *castling) == NULL)
+                            skip = TRUE;
+                }
+            }
+            else if (read_pgn_tag(line, "Variant", value, sizeof(value))) {
+                if (strcmp(value, "Standard") && strcmp(value, "standard"))
+                    skip = TRUE;
+            }
+            continue;
+        }
+
+        //-- Part of the moves (only as much as the depth could possibly need)
+        n = strlen(line);
+        if (n > 0 && !(n == 1 && line[0] == '\n'))
+            in_moves = TRUE;
+        if (length + n < BOOK_GAME_SIZE) {
+            memcpy(game->moves + length, line, n + 1);
+            length += n;
+        }
+    }
+
+    fclose(f);
+}
+
+//===========================================================//
+// Merging the runs
+//===========================================================//
+static BOOL read_entry(FILE *f, struct t_book_entry *entry)
+{
+    return fread(entry, sizeof(struct t_book_entry), 1, f) == 1;
+}
+
+static int compare_polyglot_weights(const void *a, const void *b)
+{
+    const struct t_book_entry *x = (const struct t_book_entry *)a;
+    const struct t_book_entry *y = (const struct t_book_entry *)b;
+
+    if (x->weight != y->weight)
+        return (x->weight > y->weight) ? -1 : 1;
+    return (x->move < y->move) ? -1 : (x->move > y->move);
+}
+
+//-- Write all the moves for one position, best first and scaled to 16 bits
+static t_nodes write_position(FILE *f, struct t_book_entry *entry, int count)
+{
+    unsigned int biggest = 0;
+    t_nodes written = 0;
+    int i, n = 0;
+
+    for (i = 0; i < count; i++) {
+        if (entry[i].games >= (unsigned int)book_min_games && entry[i].weight > 0)
+            entry[n++] = entry[i];
+    }
+    qsort(entry, n, sizeof(struct t_book_entry), compare_polyglot_weights);
+
+    for (i = 0; i < n; i++) {
+        if (entry[i].weight > biggest)
+            biggest = entry[i].weight;
+    }
+
+    for (i = 0; i < n; i++) {
+        unsigned long long weight = entry[i].weight;
+        if (biggest > 65535)
+            weight = weight * 65535 / biggest;
+        if (weight == 0)
+            continue;
+
+        write_integer(f, entry[i].key, 8);
+        write_integer(f, entry[i].move, 2);
+        write_integer(f, weight, 2);
+        write_integer(f, 0, 4);
+        written++;
+    }
+
+    return written;
+}
+
+//-- Merge the runs, either into another run or (if "book" is set) into the Polyglot book
+static t_nodes merge_runs(FILE **run, int count, FILE *out, BOOL book)
+{
+    static struct t_book_entry position[BOOK_MAX_POSITION_MOVES];
+    struct t_book_entry *next = (struct t_book_entry *)malloc(count * sizeof(struct t_book_entry));
+    BOOL *live = (BOOL *)malloc(count * sizeof(BOOL));
+    struct t_book_entry current;
+    BOOL have_current = FALSE;
+    int moves = 0;
+    t_nodes written = 0;
+    int i, best;
+
+    for (i = 0; i < count; i++)
+        live[i] = read_entry(run[i], &next[i]);
+
+    while (TRUE) {
+
+        //-- The smallest entry of all the runs
+        best = -1;
+        for (i = 0; i < count; i++) {
+            if (live[i] && (best < 0 || compare_book_entries(&next[i], &next[best]) < 0))
+                best = i;
+        }
+
+        //-- Finished with this (key, move)?
+        if (have_current && (best < 0 || compare_book_entries(&next[best], &current) != 0)) {
+            if (!book) {
+                fwrite(&current, sizeof(struct t_book_entry), 1, out);
+                written++;
+            }
+            else {
+                if (moves > 0 && position[0].key != current.key) {
+                    written += write_position(out, position, moves);
+                    moves = 0;
+                }
+                if (moves < BOOK_MAX_POSITION_MOVES)
+                    position[moves++] = current;
+            }
+            have_current = FALSE;
+        }
+
+        if (best < 0)
+            break;
+
+        if (!have_current) {
+            current = next[best];
+            have_current = TRUE;
+        }
+        else {
+            current.weight += next[best].weight;
+            current.games += next[best].games;
+        }
+        live[best] = read_entry(run[best], &next[best]);
+    }
+
+    if (book && moves > 0)
+        written += write_position(out, position, moves);
+
+    free(live);
+    free(next);
+    return written;
+}
+
+BOOL make_book(int argc, char *argv[])
+{
+    static char s[1024];
+    static struct t_book_game game[1];
+    t_thread thread[NUMA_MAX_CPUS];
+    int threads = numa.cpu_count;
+    size_t memory = 256;
+    int i;
+
+    book_depth = 30;
+    book_min_games = 1;
+
+    //-- Options
+    for (i = 1; i < argc - 1; i++) {
+        if (!strcmp(argv[i], "-depth"))
+            book_depth = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            threads = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-memory"))
+            memory = (size_t)atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-min"))
+            book_min_games = atoi(argv[i + 1]);
+    }
+    threads = max(1, min(threads, NUMA_MAX_CPUS));
+
+    //-- Each worker gets its share of the memory (as a power of two table)
+    book_table_size = 1024;
+    while (book_table_size * 2 * sizeof(struct t_book_entry) * threads <= memory * 1024 * 1024)
+        book_table_size *= 2;
+
+    book_queue = (struct t_book_game *)malloc(BOOK_QUEUE_SIZE * sizeof(struct t_book_game));
+    if (book_queue == NULL)
+        return FALSE;
+    book_queue_head = 0;
+    book_queue_tail = 0;
+    book_reading_done = FALSE;
+    book_error = NULL;
+    book_run_count = 0;
+    book_games = 0;
+    book_positions = 0;
+    book_errors = 0;
+
+    mutex_init(&book_mutex);
+    condition_init(&book_condition);
+
+    sprintf(s, "Book builder: depth %d, %d threads, %d MB", book_depth, threads, (int)memory);
+    send_info(s);
+
+    for (i = 0; i < threads; i++)
+        thread_create(&thread[i], book_worker, NULL);
+
+    //-- Read the games (skipping the options)
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            i++;
+            continue;
+        }
+        read_pgn(argv[i], game);
+    }
+
+    mutex_lock(&book_mutex);
+    book_reading_done = TRUE;
+    condition_broadcast(&book_condition);
+    mutex_unlock(&book_mutex);
+
+    for (i = 0; i < threads; i++)
+        thread_join(thread[i]);
+    free(book_queue);
+
+    if (book_error != NULL) {
+        send_info(book_error);
+        for (i = 0; i < book_run_count; i++)
+            fclose(book_run[i]);
+        return FALSE;
+    }
+
+    sprintf(s, "Book builder: " NODE_FORMAT " games, " NODE_FORMAT " positions, " NODE_FORMAT " games with errors", book_games, book_positions, book_errors);
+    send_info(s);
+
+    //-- Not too many runs to merge at once
+    while (book_run_count > BOOK_MAX_RUNS / 4 && book_error == NULL)
+        merge_last_runs();
+    if (book_error != NULL) {
+        send_info(book_error);
+        for (i = 0; i < book_run_count; i++)
+            fclose(book_run[i]);
+        return FALSE;
+    }
+
+    FILE *f = fopen(argv[0], "wb");
+    if (f == NULL) {
+        sprintf(s, "Book builder: unable to create %s", argv[0]);
+        send_info(s);
+        return FALSE;
+    }
+
+    t_nodes entries = merge_runs(book_run, book_run_count, f, TRUE);
+    fclose(f);
+
+    for (i = 0; i < book_run_count; i++)
+        fclose(book_run[i]);
+
+    sprintf(s, "Book builder: wrote " NODE_FORMAT " entries to %s", entries, argv[0]);
+    send_info(s);
+
+    return TRUE;
+}
@@ -0,0 +1,964 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Cluster Search
+//
+// The coordinator (the normal UCI engine) searches the first
+// root move itself and hands the rest of the root moves out
+// to worker processes, one move at a time, with a null window
+// around the current best score.  Fail highs are re-searched
+// with an open window.  While the workers have the moves the
+// coordinator only hands them out and merges the results, so
+// no worker waits on it (it only searches them itself if
+// every worker has gone).  Workers talk to the coordinator over
+// TCP using simple text lines:
+//
+//   coordinator -> worker
+//     position ...                     (as sent by the GUI)
+//     ucinewgame / setoption ...       (passed straight through)
+//     search <depth> <alpha> <beta> <move>
+//     stop / quit
+//     tt <key> <score> <depth> <bound> <move> ...
+//
+//   worker -> coordinator
+//     result <score> <nodes> <aborted> <pv>
+//     tt <key> <score> <depth> <bound> <move> ...
+//
+// Deep hash table entries are collected in batches and passed
+// between the coordinator and the workers.  Local workers are
+// started with "setoption name Cluster Workers value n", remote
+// workers with "maverick worker <host> <port>".  There is no
+// authentication, so the coordinator only listens on 127.0.0.1
+// unless "Cluster Address" says otherwise.
+//===========================================================//
+
+#if defined(_WIN32)
+
+void cluster_set_workers(int n)
+{
+	if (n > 0)
+		send_info("Cluster search is not supported on this platform");
+}
+
+void cluster_set_port(int port)
+{
+
+}
+
+void cluster_set_address(char *address)
+{
+
+}
+
+void cluster_set_position(char *s)
+{
+
+}
+
+void cluster_broadcast(char *s)
+{
+
+}
+
+void cluster_new_search(struct t_board *board)
+{
+
+}
+
+void cluster_search_root(struct t_board *board, struct t_move_list *move_list, int first, int depth, t_chess_value *best_score)
+{
+
+}
+
+void cluster_share_hash(t_hash hash_key, t_chess_value score, int depth, t_hash_bound bound, struct t_move_record *move)
+{
+
+}
+
+void cluster_worker(char *host, char *port)
+{
+	printf("Cluster search is not supported on this platform\n");
+}
+
+void cluster_shutdown()
+{
+
+}
+
+#else
+
+#define CLUSTER_MOVE_WAITING				0
+#define CLUSTER_MOVE_SEARCHING				1
+#define CLUSTER_MOVE_DONE					2
+
+//-- Worker job hand-off (worker process only)
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_condition = PTHREAD_COND_INITIALIZER;
+static BOOL job_pending = FALSE;
+static char job[UCI_BUFFER_SIZE];
+
+//-- Hash entries received while the worker is searching (applied by the search thread)
+static pthread_mutex_t pending_hash_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct t_cluster_hash_entry pending_hash[CLUSTER_PENDING_HASH];
+static int pending_hash_count = 0;
+
+//-- Worker processes started by this coordinator
+static struct t_engine_process cluster_local[CLUSTER_MAX_WORKERS];
+
+//===========================================================//
+// Socket Helpers
+//===========================================================//
+static BOOL cluster_send(struct t_cluster_connection *c, const char *s)
+{
+	size_t length = strlen(s);
+	ssize_t n;
+
+	if (c->socket < 0)
+		return FALSE;
+
+	while (length > 0) {
+		n = send(c->socket, s, length, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+		s += n;
+		length -= n;
+	}
+
+	return send(c->socket, "\n", 1, 0) == 1;
+}
+
+static BOOL cluster_receive(struct t_cluster_connection *c)
+{
+	ssize_t n;
+
+	//-- A line which doesn't fit is a protocol error, so throw it away
+	if (c->length >= (int)sizeof(c->buffer))
+		c->length = 0;
+
+	do {
+		n = recv(c->socket, c->buffer + c->length, sizeof(c->buffer) - c->length, 0);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0)
+		return FALSE;
+
+	c->length += (int)n;
+	return TRUE;
+}
+
+static BOOL cluster_next_line(struct t_cluster_connection *c, char *line)
+{
+	char *p = (char *)memchr(c->buffer, '\n', c->length);
+	int n;
+
+	if (p == NULL)
+		return FALSE;
+
+	n = (int)(p - c->buffer);
+	memcpy(line, c->buffer, n);
+	line[n] = '\0';
+	if (n > 0 && line[n - 1] == '\r')
+		line[n - 1] = '\0';
+
+	c->length -= n + 1;
+	memmove(c->buffer, p + 1, c->length);
+	return TRUE;
+}
+
+static void cluster_close(struct t_cluster_connection *c)
+{
+	if (c->socket >= 0)
+		close(c->socket);
+	c->socket = -1;
+	c->length = 0;
+	c->busy = FALSE;
+}
+
+static void cluster_set_no_delay(int s)
+{
+	int flag = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(flag));
+}
+
+//===========================================================//
+// Shared Hash Entries
+//===========================================================//
+static void cluster_apply_pending_hash();
+
+static void cluster_flush_hash()
+{
+	static char s[CLUSTER_BUFFER_SIZE];
+	struct t_cluster_hash_entry *h;
+	int i, n;
+
+	if (cluster.share_count == 0)
+		return;
+
+	n = sprintf(s, "tt");
+	for (i = 0; i < cluster.share_count; i++) {
+		h = &cluster.share[i];
+		n += sprintf(s + n, " %llx %d %d %d %d", (unsigned long long)h->key, h->score, h->depth, (int)h->bound, h->move);
+	}
+	cluster.share_count = 0;
+
+	//-- Workers send to the coordinator, the coordinator to every worker
+	if (cluster.is_worker) {
+		cluster_send(&cluster.coordinator, s);
+		cluster_apply_pending_hash();
+	}
+	else {
+		for (i = 0; i < cluster.worker_count; i++)
+			cluster_send(&cluster.worker[i], s);
+	}
+}
+
+void cluster_share_hash(t_hash hash_key, t_chess_value score, int depth, t_hash_bound bound, struct t_move_record *move)
+{
+	struct t_cluster_hash_entry *h = &cluster.share[cluster.share_count++];
+
+	h->key = hash_key;
+	h->score = score;
+	h->depth = depth;
+	h->bound = bound;
+	h->move = (move == NULL) ? -1 : (int)(move - xmove_list);
+
+	if (cluster.share_count == CLUSTER_SHARE_BATCH)
+		cluster_flush_hash();
+}
+
+//-- Store the entries of a "tt" line, or queue them if another thread is using the hash table
+static void cluster_store_hash(char *s, BOOL queue)
+{
+	struct t_cluster_hash_entry *h;
+	unsigned long long key;
+	int score, depth, bound, move;
+	int n;
+
+	//-- Skip the "tt"
+	s += 2;
+
+	if (queue)
+		pthread_mutex_lock(&pending_hash_mutex);
+
+	while (sscanf(s, " %llx %d %d %d %d%n", &key, &score, &depth, &bound, &move, &n) == 5) {
+		s += n;
+		if (bound < HASH_LOWER || bound > HASH_UPPER || move >= GLOBAL_MOVE_COUNT || score > CHECKMATE || score < -CHECKMATE)
+			continue;
+		if (!queue)
+			poke_record((t_hash)key, score, depth, (t_hash_bound)bound, (move < 0) ? NULL : &xmove_list[move]);
+		else if (pending_hash_count < CLUSTER_PENDING_HASH) {
+			h = &pending_hash[pending_hash_count++];
+			h->key = (t_hash)key;
+			h->score = score;
+			h->depth = depth;
+			h->bound = (t_hash_bound)bound;
+			h->move = move;
+		}
+	}
+
+	if (queue)
+		pthread_mutex_unlock(&pending_hash_mutex);
+}
+
+static void cluster_apply_pending_hash()
+{
+	struct t_cluster_hash_entry *h;
+
+	pthread_mutex_lock(&pending_hash_mutex);
+	for (int i = 0; i < pending_hash_count; i++) {
+		h = &pending_hash[i];
+		poke_record(h->key, h->score, h->depth, h->bound, (h->move < 0) ? NULL : &xmove_list[h->move]);
+	}
+	pending_hash_count = 0;
+	pthread_mutex_unlock(&pending_hash_mutex);
+}
+
+//===========================================================//
+// Coordinator
+//===========================================================//
+static BOOL cluster_listen(int port)
+{
+	struct sockaddr_in address;
+	socklen_t length = sizeof(address);
+	int flag = 1;
+
+	if (cluster.listen_socket >= 0)
+		return TRUE;
+
+	signal(SIGPIPE, SIG_IGN);
+
+	cluster.listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+	if (cluster.listen_socket < 0)
+		return FALSE;
+	setsockopt(cluster.listen_socket, SOL_SOCKET, SO_REUSEADDR, (char *)&flag, sizeof(flag));
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((unsigned short)port);
+	if (inet_pton(AF_INET, cluster.address, &address.sin_addr) != 1) {
+		close(cluster.listen_socket);
+		cluster.listen_socket = -1;
+		send_info("Cluster: invalid listen address");
+		return FALSE;
+	}
+
+	if (bind(cluster.listen_socket, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(cluster.listen_socket, CLUSTER_MAX_WORKERS) < 0) {
+		close(cluster.listen_socket);
+		cluster.listen_socket = -1;
+		send_info("Cluster: unable to listen for workers");
+		return FALSE;
+	}
+
+	//-- Find out which port we ended up with
+	if (getsockname(cluster.listen_socket, (struct sockaddr *)&address, &length) == 0)
+		cluster.port = ntohs(address.sin_port);
+
+	return TRUE;
+}
+
+static void cluster_accept_workers(int expected, int timeout)
+{
+	struct pollfd p;
+	struct t_cluster_connection *c;
+	char s[256];
+	int connected = 0;
+	int t;
+	unsigned long start = time_now();
+
+	if (cluster.listen_socket < 0)
+		return;
+
+	p.fd = cluster.listen_socket;
+	p.events = POLLIN;
+
+	do {
+		t = (connected < expected) ? timeout - (int)(time_now() - start) : 0;
+		if (t < 0)
+			t = 0;
+
+		p.revents = 0;
+		if (poll(&p, 1, t) <= 0)
+			break;
+
+		int s_worker = accept(cluster.listen_socket, NULL, NULL);
+		if (s_worker < 0)
+			break;
+
+		if (cluster.worker_count >= CLUSTER_MAX_WORKERS) {
+			close(s_worker);
+			continue;
+		}
+
+		c = &cluster.worker[cluster.worker_count++];
+		c->socket = s_worker;
+		c->length = 0;
+		c->busy = FALSE;
+		cluster_set_no_delay(s_worker);
+		connected++;
+
+		//-- Bring the new worker up to date
+		if (uci.options.hash_table_size != 64) {
+			sprintf(s, "setoption name Hash value %d", uci.options.hash_table_size);
+			cluster_send(c, s);
+		}
+
+	} while (TRUE);
+}
+
+static void cluster_remove_worker(int i)
+{
+	cluster_close(&cluster.worker[i]);
+
+	cluster.worker_count--;
+	if (i != cluster.worker_count)
+		cluster.worker[i] = cluster.worker[cluster.worker_count];
+	cluster.worker[cluster.worker_count].socket = -1;
+}
+
+static void cluster_stop_workers()
+{
+	int i;
+
+	for (i = 0; i < cluster.worker_count; i++) {
+		cluster_send(&cluster.worker[i], "quit");
+		cluster_close(&cluster.worker[i]);
+	}
+
+	//-- Collect any local worker processes
+	for (i = 0; i < cluster.local_workers; i++)
+		engine_stop(&cluster_local[i], FALSE);
+
+	cluster.local_workers = 0;
+	cluster.worker_count = 0;
+	cluster.share_hash = FALSE;
+}
+
+void cluster_set_port(int port)
+{
+	if (cluster.listen_socket >= 0 && cluster.port != port) {
+		close(cluster.listen_socket);
+		cluster.listen_socket = -1;
+	}
+	cluster.port = port;
+	if (port > 0 && cluster_listen(port)) {
+		static char s[256];
+		snprintf(s, sizeof(s), "Cluster: waiting for workers on %s port %d", cluster.address, cluster.port);
+		send_info(s);
+	}
+}
+
+void cluster_set_address(char *address)
+{
+	if (!strcmp(address, cluster.address))
+		return;
+	snprintf(cluster.address, sizeof(cluster.address), "%s", address);
+
+	//-- Listen again on the new address
+	if (cluster.listen_socket >= 0) {
+		close(cluster.listen_socket);
+		cluster.listen_socket = -1;
+		cluster_set_port(cluster.port);
+	}
+}
+
+void cluster_set_workers(int n)
+{
+	static char s[256];
+	char port[16];
+	const char *arguments[] = { "worker", "127.0.0.1", port, NULL };
+	int i;
+
+	cluster_stop_workers();
+
+	if (n <= 0)
+		return;
+	if (n > CLUSTER_MAX_WORKERS)
+		n = CLUSTER_MAX_WORKERS;
+
+	if (!cluster_listen(cluster.port))
+		return;
+
+	//-- Start the local workers (with their output going nowhere)
+	sprintf(port, "%d", cluster.port);
+	for (i = 0; i < n; i++) {
+		if (engine_start(&cluster_local[cluster.local_workers], arguments, FALSE))
+			cluster.local_workers++;
+	}
+
+	cluster_accept_workers(n, 5000);
+
+	sprintf(s, "Cluster: %d workers connected on port %d", cluster.worker_count, cluster.port);
+	send_info(s);
+}
+
+void cluster_set_position(char *s)
+{
+	strncpy(cluster.position, s, UCI_BUFFER_SIZE - 1);
+}
+
+void cluster_broadcast(char *s)
+{
+	for (int i = 0; i < cluster.worker_count; i++)
+		cluster_send(&cluster.worker[i], s);
+}
+
+void cluster_new_search(struct t_board *board)
+{
+	cluster.nodes = 0;
+
+	//-- Pick up any remote workers which have connected since the last search
+	cluster_accept_workers(0, 0);
+
+	cluster.share_count = 0;
+	cluster.share_hash = (cluster.worker_count > 0);
+
+	if (cluster.worker_count > 0)
+		cluster_broadcast(cluster.position);
+}
+
+void cluster_shutdown()
+{
+	cluster_stop_workers();
+	if (cluster.listen_socket >= 0)
+		close(cluster.listen_socket);
+	cluster.listen_socket = -1;
+}
+
+static t_chess_value cluster_search_move(struct t_board *board, struct t_move_list *move_list, struct t_move_record *move, int depth, t_chess_value alpha, t_chess_value beta)
+{
+	struct t_pv_data *pv = board->pv_data;
+	struct t_undo undo[1];
+	t_chess_value e;
+
+	pv->current_move = move;
+	make_move(board, move_list->pinned_pieces, move, undo);
+
+	do_uci_consider_move(board, depth);
+
+	evaluate(board, board->pv_data[1].eval);
+
+	//-- Extend for checks (same as the root search)
+	if (board->in_check && see_safe(board, move->to_square, 0))
+		pv->reduction = 0;
+	else
+		pv->reduction = 1;
+
+	e = -alphabeta(board, 1, depth - pv->reduction, -beta, -alpha, TRUE, NULL);
+
+	unmake_move(board, undo);
+
+	return e;
+}
+
+static void cluster_set_best_line(struct t_board *board, char *s)
+{
+	struct t_pv_data *pv = board->pv_data;
+	struct t_move_record *move;
+	struct t_undo undo[MAXPLY];
+	char move_string[16];
+	int i, n = 0;
+
+	pv->best_line_length = 0;
+	while (pv->best_line_length < MAXPLY && sscanf(s, " %15s%n", move_string, &n) == 1) {
+		s += n;
+		move = lookup_move(board, move_string);
+		if (move == NULL || !is_move_legal(board, move))
+			break;
+		pv->best_line[pv->best_line_length] = move;
+		make_move(board, 0, move, undo + pv->best_line_length);
+		pv->best_line_length++;
+	}
+
+	for (i = pv->best_line_length - 1; i >= 0; i--)
+		unmake_move(board, undo + i);
+}
+
+static void cluster_new_best_move(struct t_move_list *move_list, struct t_move_record *move)
+{
+	for (int i = 0; i < move_list->count; i++) {
+		if (move_list->move[i] == move) {
+			new_best_move(move_list, i);
+			return;
+		}
+	}
+}
+
+void cluster_search_root(struct t_board *board, struct t_move_list *move_list, int first, int depth, t_chess_value *best_score)
+{
+	static char line[CLUSTER_BUFFER_SIZE];
+	static char s[256];
+
+	struct t_pv_data *pv = board->pv_data;
+	struct t_cluster_connection *c;
+	struct t_move_record *moves[256];
+	struct pollfd p[CLUSTER_MAX_WORKERS];
+	char state[256];
+	BOOL open_window[256];
+	int searching[CLUSTER_MAX_WORKERS];
+	int i, j, n, count, remaining;
+	unsigned long deadline;
+	t_chess_time t;
+	t_chess_value e, alpha, beta;
+
+	//-- Take a copy of the moves (the move list is re-ordered as new best moves are found)
+	count = 0;
+	for (i = first; i < move_list->count; i++) {
+		moves[count] = move_list->move[i];
+		state[count] = CLUSTER_MOVE_WAITING;
+		open_window[count] = FALSE;
+		count++;
+	}
+	remaining = count;
+
+	//-- Pass on any deep hash entries from the coordinator's search of the first move
+	cluster_flush_hash();
+
+	while (remaining > 0 && !uci.stop) {
+
+		//-- Hand out work to the idle workers
+		for (j = 0; j < cluster.worker_count; j++) {
+			c = &cluster.worker[j];
+			if (c->busy)
+				continue;
+
+			for (i = 0; i < count && state[i] != CLUSTER_MOVE_WAITING; i++);
+			if (i == count)
+				break;
+
+			c->move = moves[i];
+			c->alpha = *best_score;
+			c->beta = open_window[i] ? CHECKMATE : *best_score + 1;
+			sprintf(s, "search %d %d %d %s", depth, c->alpha, c->beta, move_as_str(c->move));
+			if (cluster_send(c, s)) {
+				c->busy = TRUE;
+				searching[j] = i;
+				state[i] = CLUSTER_MOVE_SEARCHING;
+			}
+		}
+
+		//-- Only if every worker has gone does the coordinator search the rest of the moves itself
+		if (cluster.worker_count == 0) {
+			for (i = 0; i < count && state[i] != CLUSTER_MOVE_WAITING; i++);
+			if (i == count)
+				break;
+
+			start_nodes = nodes + qnodes;
+			pv->legal_moves_played++;
+
+			alpha = *best_score;
+			beta = open_window[i] ? CHECKMATE : *best_score + 1;
+			e = cluster_search_move(board, move_list, moves[i], depth, alpha, beta);
+
+			update_move_value(moves[i], move_list, nodes + qnodes - start_nodes);
+
+			if (!uci.stop) {
+				if (e > *best_score && !open_window[i]) {
+					do_uci_fail_high(board, e, depth);
+					e = cluster_search_move(board, move_list, moves[i], depth, *best_score, CHECKMATE);
+				}
+				if (e > *best_score && !uci.stop) {
+					*best_score = e;
+					cluster_new_best_move(move_list, moves[i]);
+					update_best_line(board, 0);
+					do_uci_new_pv(board, *best_score, depth);
+				}
+				state[i] = CLUSTER_MOVE_DONE;
+				remaining--;
+			}
+			continue;
+		}
+
+		//-- Collect the results from the workers (waking up now and then to see if the search has been stopped)
+		for (j = 0; j < cluster.worker_count; j++) {
+			p[j].fd = cluster.worker[j].socket;
+			p[j].events = POLLIN;
+			p[j].revents = 0;
+		}
+		n = poll(p, cluster.worker_count, 5);
+
+		for (j = cluster.worker_count - 1; j >= 0 && n > 0; j--) {
+			c = &cluster.worker[j];
+			if (!(p[j].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			//-- Lost a worker, so put its move back in the queue
+			if (!cluster_receive(c)) {
+				if (c->busy)
+					state[searching[j]] = CLUSTER_MOVE_WAITING;
+				searching[j] = searching[cluster.worker_count - 1];
+				cluster_remove_worker(j);
+				continue;
+			}
+
+			while (cluster_next_line(c, line)) {
+
+				if (!strncmp(line, "tt ", 3)) {
+					cluster_store_hash(line, FALSE);
+					for (int k = 0; k < cluster.worker_count; k++) {
+						if (k != j)
+							cluster_send(&cluster.worker[k], line);
+					}
+					continue;
+				}
+
+				if (strncmp(line, "result ", 7) || !c->busy)
+					continue;
+
+				unsigned long long worker_nodes = 0;
+				int score, aborted, offset = 0;
+				if (sscanf(line + 7, "%d %llu %d%n", &score, &worker_nodes, &aborted, &offset) != 3)
+					continue;
+
+				c->busy = FALSE;
+				cluster.nodes += worker_nodes;
+				i = searching[j];
+				update_move_value(moves[i], move_list, worker_nodes);
+
+				if (aborted || uci.stop)
+					continue;
+
+				//-- Fail low (against the best score when the move was handed out)
+				if (score <= c->alpha) {
+					state[i] = CLUSTER_MOVE_DONE;
+					remaining--;
+				}
+
+				//-- Fail high - re-search with an open window if it really is better
+				else if (score >= c->beta) {
+					if (score > *best_score) {
+						pv->current_move = moves[i];
+						do_uci_fail_high(board, score, depth);
+						open_window[i] = TRUE;
+					}
+					state[i] = CLUSTER_MOVE_WAITING;
+				}
+
+				//-- Exact score
+				else {
+					if (score > *best_score) {
+						*best_score = score;
+						pv->current_move = moves[i];
+						cluster_new_best_move(move_list, moves[i]);
+						cluster_set_best_line(board, line + 7 + offset);
+						do_uci_new_pv(board, *best_score, depth);
+					}
+					state[i] = CLUSTER_MOVE_DONE;
+					remaining--;
+				}
+			}
+		}
+	}
+
+	//-- Stop any workers which are still busy and wait for them to finish (dropping any which don't answer in time)
+	for (j = 0; j < cluster.worker_count; j++) {
+		c = &cluster.worker[j];
+		if (c->busy)
+			cluster_send(c, "stop");
+	}
+	deadline = time_now() + CLUSTER_STOP_TIMEOUT;
+	for (j = cluster.worker_count - 1; j >= 0; j--) {
+		c = &cluster.worker[j];
+		while (c->busy) {
+			if (cluster_next_line(c, line)) {
+				if (!strncmp(line, "result ", 7)) {
+					unsigned long long worker_nodes = 0;
+					sscanf(line + 7, "%*d %llu", &worker_nodes);
+					cluster.nodes += worker_nodes;
+					c->busy = FALSE;
+				}
+				continue;
+			}
+
+			t = (t_chess_time)(deadline - time_now());
+			p[0].fd = c->socket;
+			p[0].events = POLLIN;
+			p[0].revents = 0;
+			if (t <= 0 || poll(p, 1, (int)t) <= 0 || !cluster_receive(c)) {
+				cluster_remove_worker(j);
+				break;
+			}
+		}
+	}
+}
+
+//===========================================================//
+// Worker
+//===========================================================//
+static void cluster_do_search(struct t_board *board, char *s)
+{
+	static char result[CLUSTER_BUFFER_SIZE];
+
+	struct t_pv_data *pv = board->pv_data;
+	struct t_move_list move_list[1];
+	struct t_move_record *move;
+	char move_string[16];
+	int depth, alpha, beta;
+	int i, n;
+	t_chess_value e;
+
+	if (sscanf(s, "search %d %d %d %15s", &depth, &alpha, &beta, move_string) != 4)
+		return;
+
+	nodes = 0;
+	qnodes = 0;
+	deepest = 0;
+	search_ply = depth;
+	search_start_time = time_now();
+	last_display_update = search_start_time;
+	search_start_draw_stack_count = board->draw_stack_count;
+
+	//-- Pick up the entries which arrived during the last search
+	cluster_apply_pending_hash();
+
+	generate_legal_moves(board, move_list);
+	move = lookup_move(board, move_string);
+
+	if (move == NULL || !is_move_in_list(move, move_list)) {
+		sprintf(result, "result %d 0 1", -CHECKMATE);
+		cluster_send(&cluster.coordinator, result);
+		return;
+	}
+
+	pv->node_type = node_pv;
+	pv->legal_moves_played = 2;
+
+	e = cluster_search_move(board, move_list, move, depth, alpha, beta);
+
+	//-- Pass on the deep entries before the result, so the coordinator has them first
+	cluster_flush_hash();
+
+	n = sprintf(result, "result %d %llu %d %s", e, (unsigned long long)(nodes + qnodes), uci.stop ? 1 : 0, move_as_str(move));
+	for (i = 1; i < pv[1].best_line_length && n < CLUSTER_BUFFER_SIZE - 16; i++)
+		n += sprintf(result + n, " %s", move_as_str(pv[1].best_line[i]));
+
+	cluster_send(&cluster.coordinator, result);
+}
+
+static void *cluster_worker_loop(void *arguments)
+{
+	numa_init_thread(0);
+
+	while (TRUE) {
+		pthread_mutex_lock(&job_mutex);
+		while (!job_pending)
+			pthread_cond_wait(&job_condition, &job_mutex);
+		pthread_mutex_unlock(&job_mutex);
+
+		cluster_do_search(position, job);
+
+		pthread_mutex_lock(&job_mutex);
+		job_pending = FALSE;
+		pthread_cond_broadcast(&job_condition);
+		pthread_mutex_unlock(&job_mutex);
+	}
+	return NULL;
+}
+
+static void cluster_wait_for_job()
+{
+	pthread_mutex_lock(&job_mutex);
+	while (job_pending)
+		pthread_cond_wait(&job_condition, &job_mutex);
+	pthread_mutex_unlock(&job_mutex);
+}
+
+void cluster_worker(char *host, char *port)
+{
+	static char line[CLUSTER_BUFFER_SIZE];
+
+	struct addrinfo hints, *address, *a;
+	struct t_cluster_connection *c = &cluster.coordinator;
+	pthread_t thread;
+	BOOL searching;
+
+	signal(SIGPIPE, SIG_IGN);
+
+	//-- Connect to the coordinator
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &address) != 0) {
+		printf("Cluster worker: unknown host %s\n", host);
+		return;
+	}
+
+	c->socket = -1;
+	for (a = address; a != NULL && c->socket < 0; a = a->ai_next) {
+		c->socket = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (c->socket >= 0 && connect(c->socket, a->ai_addr, a->ai_addrlen) < 0) {
+			close(c->socket);
+			c->socket = -1;
+		}
+	}
+	freeaddrinfo(address);
+
+	if (c->socket < 0) {
+		printf("Cluster worker: unable to connect to %s:%s\n", host, port);
+		return;
+	}
+	cluster_set_no_delay(c->socket);
+	c->length = 0;
+
+	flush_output();
+	printf("Cluster worker: connected to %s:%s\n", host, port);
+	fflush(stdout);
+
+	cluster.is_worker = TRUE;
+	cluster.share_hash = TRUE;
+
+	//-- Workers never run out of time, the coordinator tells them when to stop
+	uci.level.infinite = TRUE;
+	uci.options.current_line = FALSE;
+	freopen("/dev/null", "w", stdout);
+
+	pthread_create(&thread, NULL, cluster_worker_loop, NULL);
+
+	while (cluster_receive(c)) {
+		while (cluster_next_line(c, line)) {
+
+			if (!strcmp(line, "stop"))
+				uci.stop = TRUE;
+
+			//-- Only the main thread sets job_pending, so if it's clear the search thread is idle
+			else if (!strncmp(line, "tt ", 3)) {
+				pthread_mutex_lock(&job_mutex);
+				searching = job_pending;
+				pthread_mutex_unlock(&job_mutex);
+				cluster_store_hash(line, searching);
+			}
+
+			else if (!strncmp(line, "search ", 7)) {
+				cluster_wait_for_job();
+				pthread_mutex_lock(&job_mutex);
+				strcpy(job, line);
+				uci.stop = FALSE;
+				job_pending = TRUE;
+				pthread_cond_broadcast(&job_condition);
+				pthread_mutex_unlock(&job_mutex);
+			}
+
+			else if (!strncmp(line, "position ", 9)) {
+				cluster_wait_for_job();
+				uci_position(position, line);
+				hash_age++;
+			}
+
+			else if (!strcmp(line, "ucinewgame")) {
+				cluster_wait_for_job();
+				uci_new_game(position);
+			}
+
+			else if (!strncmp(line, "setoption ", 10)) {
+				cluster_wait_for_job();
+				uci_setoption(line);
+			}
+
+			else if (!strcmp(line, "quit")) {
+				uci.stop = TRUE;
+				cluster_wait_for_job();
+				cluster_close(c);
+				return;
+			}
+		}
+	}
+
+	//-- Lost the coordinator
+	uci.stop = TRUE;
+	cluster_wait_for_job();
+	cluster_close(c);
+}
+
+#endif
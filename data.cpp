@@ -17,6 +17,7 @@
 #include <stdlib.h>
 
 #include "defs.h"
+#include "eval.h"
 #include "data.h"
 #include "procs.h"
 #include "bittwiddle.h"
@@ -27,6 +28,22 @@
 struct t_uci uci;
 char engine_author[30];
 char engine_name[30];
+char engine_path[FILENAME_MAX];
+
+// ----------------------------------------------------------//
+// Cluster Search
+// ----------------------------------------------------------//
+struct t_cluster cluster;
+
+// ----------------------------------------------------------//
+// NUMA Topology
+// ----------------------------------------------------------//
+struct t_numa numa;
+
+// ----------------------------------------------------------//
+// NNUE Evaluation
+// ----------------------------------------------------------//
+struct t_nnue nnue;
 
 // ----------------------------------------------------------//
 // Chess Board
@@ -52,8 +69,10 @@ int search_ply;
 unsigned long cutoffs;
 unsigned long first_move_cutoffs;
 
-int message_update_count;
-t_nodes message_update_mask;
+#ifdef USE_SEARCH_STATS
+THREAD_LOCAL struct t_search_stats search_stats;
+#endif
+
 long last_display_update;
 long search_start_time;
 int deepest;
@@ -61,6 +80,8 @@ int most_captures;
 t_nodes nodes;
 t_nodes qnodes;
 t_nodes start_nodes;
+THREAD_LOCAL t_nodes fixed_search_nodes;
+THREAD_LOCAL t_nodes fixed_search_limit;
 t_chess_time early_move_time;
 t_chess_time target_move_time;
 t_chess_time abort_move_time;
@@ -108,8 +129,6 @@ struct t_castle_record castle[4];
 // ----------------------------------------------------------//
 // Repitition Variables
 // ----------------------------------------------------------//
-t_hash draw_stack[MAX_MOVES];
-int draw_stack_count;
 int search_start_draw_stack_count;
 
 // ----------------------------------------------------------//
@@ -147,11 +166,14 @@ t_piece_mask can_move[64][64];
 // ----------------------------------------------------------//
 // Piece Tables
 // ----------------------------------------------------------//
-t_chess_value piece_value[2][8];
+t_chess_value piece_value[2][8] = {
+	{ 0, MG_KNIGHT_VALUE, MG_BISHOP_VALUE, MG_ROOK_VALUE, MG_QUEEN_VALUE, MG_PAWN_VALUE, 0, 0 },
+	{ 0, EG_KNIGHT_VALUE, EG_BISHOP_VALUE, EG_ROOK_VALUE, EG_QUEEN_VALUE, EG_PAWN_VALUE, 0, 0 }
+};
 
 t_chess_value piece_square_table[16][2][64];
 
-const t_chess_value pawn_pst[2][64] = {
+t_chess_value pawn_pst[2][64] = {
 	{ 0, 0, 0, 0, 0, 0, 0, 0,
 	-36, -25, -21, -16, -16, -21, -25, -36,
 	-36, -25, -18, -16, -16, -18, -25, -36,
@@ -173,7 +195,7 @@ const t_chess_value pawn_pst[2][64] = {
 	}
 };
 
-const t_chess_value knight_pst[2][64] = {
+t_chess_value knight_pst[2][64] = {
 	{ -20, -13, -10, -10, -10, -10, -13, -20,
 	-13, 7, 13, 13, 13, 13, 7, -13,
 	-13, 15, 20, 23, 23, 20, 15, -13,
@@ -193,7 +215,7 @@ const t_chess_value knight_pst[2][64] = {
 	-21, -18, -15, -15, -15, -15, -18, -21 }
 };
 
-const t_chess_value bishop_pst[2][64] = {
+t_chess_value bishop_pst[2][64] = {
 	{
 		-14, -12, -11, -10, -10, -11, -12, -14,
 	-7, 7, 0, 0, 0, 0, 7, -7,
@@ -218,7 +240,7 @@ const t_chess_value bishop_pst[2][64] = {
 
 };
 
-const t_chess_value rook_pst[2][64] = {
+t_chess_value rook_pst[2][64] = {
     {   -8, -6, 2, 7, 7, 2, -6, -8,
         -8, -6, 2, 7, 7, 2, -6, -8,
         -8, -6, 6, 7, 7, 6, -6, -8,
@@ -240,7 +262,7 @@ const t_chess_value rook_pst[2][64] = {
     }
 };
 
-const t_chess_value queen_pst[2][64] = {
+t_chess_value queen_pst[2][64] = {
     {   -26, -16, -6, 4, 4, -6, -16, -26,
         -16, -11, -1, 4, 4, -1, -11, -16,
         -6, -6, -1, 4, 4, -1, -6, -6,
@@ -262,7 +284,7 @@ const t_chess_value queen_pst[2][64] = {
     }
 };
 
-const t_chess_value king_pst[2][64] = {
+t_chess_value king_pst[2][64] = {
     {   -20, -1, 0, -20, -1, -25, 0, -10,
         -30, -30, -35, -40, -40, -35, -30, -30,
         -40, -40, -45, -50, -50, -45, -40, -40,
@@ -330,7 +352,7 @@ const t_chess_color square_color[64] = {
     WHITE, BLACK, WHITE, BLACK, WHITE, BLACK, WHITE, BLACK
 };
 
-const t_chess_value passed_pawn_bonus[2][64] = {
+t_chess_value passed_pawn_bonus[2][64] = {
     {   0, 0, 0, 0, 0, 0, 0, 0,
         15, 14, 12, 10, 10, 12, 14, 15,
         30, 28, 26, 25, 25, 26, 28, 30,
@@ -358,10 +380,20 @@ const t_chess_value rook_behind_passed[2][2] = { // [Color][MG / EG]
     {-5, -15}
 };
 
+// ----------------------------------------------------------//
+// Piece Evaluation (the defaults are in eval.h)
+// ----------------------------------------------------------//
+t_chess_value bishop_pair[2] = { MG_BISHOP_PAIR, EG_BISHOP_PAIR };
+t_chess_value connected_knights[2] = { MG_CONNECTED_KNIGHTS, EG_CONNECTED_KNIGHTS };
+t_chess_value rook_behind_passed_pawn[2] = { MG_ROOK_BEHIND_PASSED_PAWN, EG_ROOK_BEHIND_PASSED_PAWN };
+t_chess_value rook_on_7th[2] = { MG_ROOK_ON_7TH, MG_ROOK_ON_7TH };		// The endgame bonus has always been the middlegame one
+t_chess_value rook_on_open_file = MG_ROOK_ON_OPEN_FILE;
+t_chess_value rook_on_semi_open_file = MG_ROOK_ON_SEMI_OPEN_FILE;
+
 // ----------------------------------------------------------//
 // Pawn Evaluation
 // ----------------------------------------------------------//
-const t_chess_value isolated_pawn[2][9] = {
+t_chess_value isolated_pawn[2][9] = {
     {0, -15, -30, -45, -60, -75, -90, -105, -120},
     { 0, -25, -50, -75, -100, -125, -150, -175, -200}
 };
@@ -379,7 +411,7 @@ const t_bitboard central_duo_defence[2][2] = {
 };
 const t_bitboard central_kq_pawns[2] = { SQUARE64(E2) | SQUARE64(D2), SQUARE64(D7) | SQUARE64(E7) };
 
-const t_chess_value inward_chain[2][64] = {
+t_chess_value inward_chain[2][64] = {
 	{
 		0, 0, 0, 0, 0, 0, 0, 0,
 		0, 0, 0, 0, 0, 0, 0, 0,
@@ -406,17 +438,17 @@ const t_chess_value inward_chain[2][64] = {
 // ----------------------------------------------------------//
 // Futility Margin
 // ----------------------------------------------------------//
-const t_chess_value futility_margin[5] = { 100, 300, 500, 900, 1200 };
+t_chess_value futility_margin[5] = { 100, 300, 500, 900, 1200 };
 
 // ----------------------------------------------------------//
 // Mobility
 // ----------------------------------------------------------//
-const t_chess_value horizontal_rook_mobility[2][8] = {
+t_chess_value horizontal_rook_mobility[2][8] = {
     {-4, -2, 0, 2, 4, 6, 6, 6},
     { -6, -3, 0, 3, 6, 9, 12, 15}
 };
 
-const t_chess_value vertical_rook_mobility[2][8] = {
+t_chess_value vertical_rook_mobility[2][8] = {
     {-8, -4, 0, 3, 6, 9, 12, 15},
     {-15, -5, 0, 5, 10, 15, 20, 25}
 };
@@ -426,7 +458,7 @@ const t_chess_value trapped_rook[2][16] = {
     {-100, -50, -10, 0, 10, 7, 24, 28, 30, 30, 30, 30, 30, 30, 30, 30 }
 };
 
-const t_chess_value bishop_mobility[2][16] = {
+t_chess_value bishop_mobility[2][16] = {
 	{ -50, -40, -10, 0, 5, 10, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60 },
 	{ -90, -50, -20, 0, 5, 10, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60 }
 	//{-50, -40, -10, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26},
@@ -438,7 +470,7 @@ const t_chess_value queen_mobility[2][32] = {
     {-50, -30, 0, 2, 5, 8, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10}
 };
 
-const t_chess_value knight_mobility[2][9] = {
+t_chess_value knight_mobility[2][9] = {
     {-30, -10, -2, 0, 2, 4, 6, 6, 6},
     {-25, -7, -1, 0, 1, 2, 3, 3, 2}
 };
@@ -451,15 +483,135 @@ t_bitboard intact_pawns[2][2];
 t_bitboard wrecked_pawns[2][2];
 t_bitboard pawn_wedge_mask[2][2];
 
-const t_chess_value pawn_storm[8] = {0, -50, -48, -30, -10, 0, 0, 0};
+t_chess_value intact_pawn_shield = MG_INTACT_PAWN_SHIELD;
+t_chess_value pawn_shield_wrecked = MG_PAWN_SHIELD_WRECKED;
+t_chess_value f6_pawn_wedge = MG_F6_PAWN_WEDGE;
+t_chess_value backward_pawn = MG_BACKWARD_PAWN;
+
+t_chess_value pawn_storm[8] = {0, -50, -48, -30, -10, 0, 0, 0};
 t_bitboard king_zone[64];
 
-const t_chess_value king_safety[8] = {0, 0, 64, 96, 113, 120, 124, 128};
+t_chess_value king_safety[8] = {0, 0, 64, 96, 113, 120, 124, 128};
+t_chess_value king_attack_weight[8] = {0, 20, 20, 40, 80, 0, 0, 0};		// Pressure for each square of the king zone a piece attacks
+
+// ----------------------------------------------------------//
+// Evaluation Parameters (names for loading, saving and tuning)
+// ----------------------------------------------------------//
+int eval_params_version;
+
+struct t_eval_param eval_param[] = {
+	{ "piece_value_mg", &piece_value[MIDDLEGAME][KNIGHT], 5 },			// Knight, bishop, rook, queen, pawn
+	{ "piece_value_eg", &piece_value[ENDGAME][KNIGHT], 5 },
+	{ "pawn_pst_mg", pawn_pst[MIDDLEGAME], 64 },
+	{ "pawn_pst_eg", pawn_pst[ENDGAME], 64 },
+	{ "knight_pst_mg", knight_pst[MIDDLEGAME], 64 },
+	{ "knight_pst_eg", knight_pst[ENDGAME], 64 },
+	{ "bishop_pst_mg", bishop_pst[MIDDLEGAME], 64 },
+	{ "bishop_pst_eg", bishop_pst[ENDGAME], 64 },
+	{ "rook_pst_mg", rook_pst[MIDDLEGAME], 64 },
+	{ "rook_pst_eg", rook_pst[ENDGAME], 64 },
+	{ "queen_pst_mg", queen_pst[MIDDLEGAME], 64 },
+	{ "queen_pst_eg", queen_pst[ENDGAME], 64 },
+	{ "king_pst_mg", king_pst[MIDDLEGAME], 64 },
+	{ "king_pst_eg", king_pst[ENDGAME], 64 },
+	{ "passed_pawn_bonus", passed_pawn_bonus[WHITE], 64 },				// Black's half is mirrored
+	{ "isolated_pawn_mg", isolated_pawn[MIDDLEGAME], 9 },
+	{ "isolated_pawn_eg", isolated_pawn[ENDGAME], 9 },
+	{ "inward_chain", inward_chain[WHITE], 64 },						// Black's half is mirrored
+	{ "backward_pawn", &backward_pawn, 1 },
+	{ "horizontal_rook_mobility_mg", horizontal_rook_mobility[MIDDLEGAME], 8 },
+	{ "horizontal_rook_mobility_eg", horizontal_rook_mobility[ENDGAME], 8 },
+	{ "vertical_rook_mobility_mg", vertical_rook_mobility[MIDDLEGAME], 8 },
+	{ "vertical_rook_mobility_eg", vertical_rook_mobility[ENDGAME], 8 },
+	{ "bishop_mobility_mg", bishop_mobility[MIDDLEGAME], 16 },
+	{ "bishop_mobility_eg", bishop_mobility[ENDGAME], 16 },
+	{ "knight_mobility_mg", knight_mobility[MIDDLEGAME], 9 },
+	{ "knight_mobility_eg", knight_mobility[ENDGAME], 9 },
+	{ "bishop_pair", bishop_pair, 2 },
+	{ "connected_knights", connected_knights, 2 },
+	{ "rook_behind_passed_pawn", rook_behind_passed_pawn, 2 },
+	{ "rook_on_7th", rook_on_7th, 2 },
+	{ "rook_on_open_file", &rook_on_open_file, 1 },
+	{ "rook_on_semi_open_file", &rook_on_semi_open_file, 1 },
+	{ "intact_pawn_shield", &intact_pawn_shield, 1 },
+	{ "pawn_shield_wrecked", &pawn_shield_wrecked, 1 },
+	{ "f6_pawn_wedge", &f6_pawn_wedge, 1 },
+	{ "pawn_storm", pawn_storm, 8 },
+	{ "king_safety", king_safety, 8 },
+	{ "king_attack_weight", &king_attack_weight[KNIGHT], 4 },			// Knight, bishop, rook, queen
+	{ NULL, NULL, 0 }
+};
 
 // ----------------------------------------------------------//
 // Search
 // ----------------------------------------------------------//
-const int aspiration_window[6] = {25, 75, 250, 500, 1000, CHECKMATE};
+int aspiration_window[6] = {25, 75, 250, 500, 1000, CHECKMATE};
+
+//-- Beta pruning: static score - depth * beta_prune_depth - beta_prune_margin
+int beta_prune_margin = 100;
+int beta_prune_depth = 50;
+
+//-- Razoring: static score + depth * razor_depth + razor_margin
+int razor_margin = 50;
+int razor_depth = 50;
+
+//-- Null move: R = min(null_move_max, null_move_base + depth * null_move_depth / 128 + (static score - beta) / null_move_eval)
+int null_move_base = 2;
+int null_move_depth = 25;
+int null_move_eval = 128;
+int null_move_max = 4;
+
+//-- Late move reductions (for a capture, a quiet move to an unsafe square and a quiet move, in
+//-- the early, middle and late bands) by node type, and the move numbers where the bands start
+int lmr_reduction[NODE_TYPES][LMR_MOVES][LMR_BANDS] = {
+	{ { 4, 4, 4 }, { 3, 3, 3 }, { 3, 3, 3 } },						// Cut
+	{ { 5, 5, 5 }, { 4, 4, 4 }, { 4, 4, 4 } },						// Super cut
+	{ { 1, 2, 2 }, { 1, 2, 2 }, { 1, 2, 2 } },						// PV
+	{ { 2, 3, 3 }, { 1, 2, 2 }, { 1, 2, 2 } },						// Lite all
+	{ { 3, 4, 4 }, { 4, 5, 6 }, { 2, 3, 4 } },						// Super all
+	{ { 3, 4, 4 }, { 4, 5, 5 }, { 2, 3, 4 } }						// All
+};
+int lmr_band_start[NODE_TYPES][LMR_BANDS - 1] = { { 4, 12 }, { 4, 12 }, { 3, 12 }, { 3, 12 }, { 4, 12 }, { 4, 18 } };
+
+#define LMR_SEARCH_PARAMS(name, type) \
+	{ "LMR " name " Capture Early", &lmr_reduction[type][lmr_capture][0], 1, 8, 1 }, \
+	{ "LMR " name " Capture Middle", &lmr_reduction[type][lmr_capture][1], 1, 8, 1 }, \
+	{ "LMR " name " Capture Late", &lmr_reduction[type][lmr_capture][2], 1, 8, 1 }, \
+	{ "LMR " name " Unsafe Early", &lmr_reduction[type][lmr_unsafe][0], 1, 8, 1 }, \
+	{ "LMR " name " Unsafe Middle", &lmr_reduction[type][lmr_unsafe][1], 1, 8, 1 }, \
+	{ "LMR " name " Unsafe Late", &lmr_reduction[type][lmr_unsafe][2], 1, 8, 1 }, \
+	{ "LMR " name " Quiet Early", &lmr_reduction[type][lmr_quiet][0], 1, 8, 1 }, \
+	{ "LMR " name " Quiet Middle", &lmr_reduction[type][lmr_quiet][1], 1, 8, 1 }, \
+	{ "LMR " name " Quiet Late", &lmr_reduction[type][lmr_quiet][2], 1, 8, 1 }, \
+	{ "LMR " name " Middle Move", &lmr_band_start[type][0], 2, 64, 1 }, \
+	{ "LMR " name " Late Move", &lmr_band_start[type][1], 2, 64, 1 }
+
+//-- Each is a UCI option (name, value, min, max and the SPSA step)
+struct t_search_param search_param[] = {
+	{ "Futility Margin 1", &futility_margin[1], 0, 1000, 20 },
+	{ "Futility Margin 2", &futility_margin[2], 0, 1500, 30 },
+	{ "Futility Margin 3", &futility_margin[3], 0, 2000, 50 },
+	{ "Futility Margin 4", &futility_margin[4], 0, 3000, 60 },
+	{ "Aspiration Window 0", &aspiration_window[0], 5, 500, 4 },
+	{ "Aspiration Window 1", &aspiration_window[1], 10, 1000, 10 },
+	{ "Aspiration Window 2", &aspiration_window[2], 20, 2000, 25 },
+	{ "Aspiration Window 3", &aspiration_window[3], 40, 4000, 50 },
+	{ "Beta Prune Margin", &beta_prune_margin, 0, 500, 10 },
+	{ "Beta Prune Depth", &beta_prune_depth, 0, 300, 5 },
+	{ "Razor Margin", &razor_margin, 0, 500, 10 },
+	{ "Razor Depth", &razor_depth, 0, 300, 5 },
+	{ "Null Move Base", &null_move_base, 0, 6, 1 },
+	{ "Null Move Depth", &null_move_depth, 0, 128, 4 },
+	{ "Null Move Eval", &null_move_eval, 16, 1024, 16 },
+	{ "Null Move Max", &null_move_max, 1, 8, 1 },
+	LMR_SEARCH_PARAMS("Cut", node_cut),
+	LMR_SEARCH_PARAMS("Super Cut", node_super_cut),
+	LMR_SEARCH_PARAMS("PV", node_pv),
+	LMR_SEARCH_PARAMS("Lite All", node_lite_all),
+	LMR_SEARCH_PARAMS("Super All", node_super_all),
+	LMR_SEARCH_PARAMS("All", node_all),
+	{ NULL, NULL, 0, 0, 0 }
+};
 
 // ----------------------------------------------------------//
 // Magics
@@ -519,12 +671,15 @@ const struct t_magic_structure bishop_magic[64] = {
 // ----------------------------------------------------------//
 // Hash Table Data & Polyglot Random Numbers
 // ----------------------------------------------------------//
-struct t_pawn_hash_record *pawn_hash;
-t_hash pawn_hash_mask;
+THREAD_LOCAL struct t_pawn_hash_record *pawn_hash;
+THREAD_LOCAL t_hash pawn_hash_mask;
+THREAD_LOCAL int pawn_hash_version;
 
-struct t_material_hash_record *material_hash;
+THREAD_LOCAL struct t_material_hash_record *material_hash;
 t_hash material_hash_mask;
 t_hash material_hash_values[16][10];
+unsigned int kpk_bitbase[KPK_INDEX_COUNT / 32];
+BOOL kpk_available;
 
 struct t_hash_record *hash_table;
 t_hash hash_mask;
@@ -9,6 +9,16 @@
 extern struct t_uci uci;
 extern char engine_author[30];
 extern char engine_name[30];
+extern char engine_path[FILENAME_MAX];
+
+// Cluster
+extern struct t_cluster cluster;
+
+// NUMA
+extern struct t_numa numa;
+
+// NNUE Evaluation
+extern struct t_nnue nnue;
 
 // Board Position
 extern struct t_board position[1];
@@ -26,8 +36,10 @@ extern int search_ply;
 extern unsigned long cutoffs;
 extern unsigned long first_move_cutoffs;
 
-extern int message_update_count;
-extern t_nodes message_update_mask;
+#ifdef USE_SEARCH_STATS
+extern THREAD_LOCAL struct t_search_stats search_stats;
+#endif
+
 extern long last_display_update;
 extern long search_start_time;
 extern int deepest;
@@ -35,6 +47,8 @@ extern int most_captures;
 extern t_nodes nodes;
 extern t_nodes qnodes;
 extern t_nodes start_nodes;
+extern THREAD_LOCAL t_nodes fixed_search_nodes;
+extern THREAD_LOCAL t_nodes fixed_search_limit;
 extern t_chess_time early_move_time;
 extern t_chess_time target_move_time;
 extern t_chess_time abort_move_time;
@@ -56,8 +70,6 @@ extern const int see_piece_value[15];
 extern struct t_castle_record castle[4];
 
 /* Repetition Variables */
-extern t_hash draw_stack[MAX_MOVES];
-extern int draw_stack_count;
 extern int search_start_draw_stack_count;
 
 // Bitboards
@@ -87,22 +99,30 @@ extern t_piece_mask can_move[64][64];
 extern t_chess_value piece_value[2][8];
 extern t_chess_value piece_square_table[16][2][64];
 
-extern const t_chess_value pawn_pst[2][64];
-extern const t_chess_value knight_pst[2][64];
-extern const t_chess_value bishop_pst[2][64];
-extern const t_chess_value rook_pst[2][64];
-extern const t_chess_value queen_pst[2][64];
-extern const t_chess_value king_pst[2][64];
+extern t_chess_value pawn_pst[2][64];
+extern t_chess_value knight_pst[2][64];
+extern t_chess_value bishop_pst[2][64];
+extern t_chess_value rook_pst[2][64];
+extern t_chess_value queen_pst[2][64];
+extern t_chess_value king_pst[2][64];
 
 extern const t_chess_value lone_king[64];
 extern const t_chess_value bishop_knight_corner[2][64];
 extern const t_chess_color square_color[64];
 
-extern const t_chess_value passed_pawn_bonus[2][64];
+extern t_chess_value passed_pawn_bonus[2][64];
 extern const t_chess_value rook_behind_passed[2][2];
 
+//-- Piece evaluation
+extern t_chess_value bishop_pair[2];
+extern t_chess_value connected_knights[2];
+extern t_chess_value rook_behind_passed_pawn[2];
+extern t_chess_value rook_on_7th[2];
+extern t_chess_value rook_on_open_file;
+extern t_chess_value rook_on_semi_open_file;
+
 //-- Pawn evaluation
-extern const t_chess_value isolated_pawn[2][9];
+extern t_chess_value isolated_pawn[2][9];
 extern t_bitboard cannot_catch_pawn_mask[2][2][64];
 extern const t_bitboard candidate_outposts[2];
 extern const t_bitboard color_square_mask[2];
@@ -112,33 +132,53 @@ extern const t_bitboard central_duo_defence_mask[2];
 extern const t_bitboard central_duo_defence[2][2];
 
 extern const t_bitboard central_kq_pawns[2];
-extern const t_chess_value inward_chain[2][64];
+extern t_chess_value inward_chain[2][64];
 
 //-- Futility
-extern const t_chess_value futility_margin[5];
+extern t_chess_value futility_margin[5];
 
 //-- Mobility
-extern const t_chess_value horizontal_rook_mobility[2][8];
-extern const t_chess_value vertical_rook_mobility[2][8];
-extern const t_chess_value knight_mobility[2][9];
+extern t_chess_value horizontal_rook_mobility[2][8];
+extern t_chess_value vertical_rook_mobility[2][8];
+extern t_chess_value knight_mobility[2][9];
 
 extern const t_chess_value trapped_rook[2][16];
 
 
 extern const t_chess_value queen_mobility[2][32];
-extern const t_chess_value bishop_mobility[2][16];
+extern t_chess_value bishop_mobility[2][16];
 
 //-- King Safety
 extern t_bitboard king_castle_squares[2][2];
 extern t_bitboard intact_pawns[2][2];
 extern t_bitboard wrecked_pawns[2][2];
 extern t_bitboard pawn_wedge_mask[2][2];
-extern const t_chess_value pawn_storm[8];
+extern t_chess_value intact_pawn_shield;
+extern t_chess_value pawn_shield_wrecked;
+extern t_chess_value f6_pawn_wedge;
+extern t_chess_value backward_pawn;
+extern t_chess_value pawn_storm[8];
 extern t_bitboard king_zone[64];								// Square around the king which are used in the king safety evaluation
-extern const t_chess_value king_safety[8];
+extern t_chess_value king_safety[8];
+extern t_chess_value king_attack_weight[8];
+
+//-- Evaluation parameters
+extern struct t_eval_param eval_param[];
+extern int eval_params_version;
 
 //-- Search
-extern const int aspiration_window[6];
+extern int aspiration_window[6];
+extern int beta_prune_margin;
+extern int beta_prune_depth;
+extern int razor_margin;
+extern int razor_depth;
+extern int null_move_base;
+extern int null_move_depth;
+extern int null_move_eval;
+extern int null_move_max;
+extern int lmr_reduction[NODE_TYPES][LMR_MOVES][LMR_BANDS];
+extern int lmr_band_start[NODE_TYPES][LMR_BANDS - 1];
+extern struct t_search_param search_param[];
 
 // Magics
 extern t_bitboard rook_magic_moves[64][4096];
@@ -147,8 +187,9 @@ extern const struct t_magic_structure rook_magic[64];
 extern const struct t_magic_structure bishop_magic[64];
 
 // Hash Table
-extern struct t_pawn_hash_record *pawn_hash;
-extern t_hash pawn_hash_mask;
+extern THREAD_LOCAL struct t_pawn_hash_record *pawn_hash;
+extern THREAD_LOCAL t_hash pawn_hash_mask;
+extern THREAD_LOCAL int pawn_hash_version;
 
 extern struct t_hash_record *hash_table;
 extern t_hash hash_mask;
@@ -157,9 +198,11 @@ extern t_nodes hash_hits;
 extern t_nodes hash_full;
 extern int hash_age;
 
-extern struct t_material_hash_record *material_hash;
+extern THREAD_LOCAL struct t_material_hash_record *material_hash;
 extern t_hash material_hash_mask;
 extern t_hash material_hash_values[16][10];
+extern unsigned int kpk_bitbase[KPK_INDEX_COUNT / 32];
+extern BOOL kpk_available;
 
 extern t_hash hash_value[16][64];
 extern t_hash castle_hash[16];
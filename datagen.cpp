@@ -0,0 +1,629 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+#include "bittwiddle.h"
+
+//===========================================================//
+// Datagen
+//
+//   datagen <file> [games n] [depth n | nodes n] [threads n]
+//           [random n] [openings file.epd] [book]
+//           [filter check mate captures | none] [seed n]
+//
+// Plays self-play games on every thread at once, each thread
+// with its own board and pawn hash and the fixed depth search
+// (iterative deepening up to the depth, or until the node
+// budget runs out), which doesn't use the hash table.  A game starts from the start position,
+// a random line of the openings file or the opening book and
+// then plays "random" random moves.  Each position searched
+// is written with its score, the best move and (once the game
+// is over) the result to a binary file (see t_datagen_record),
+// appended to if it already exists.  "datadump <file> [count
+// n]" prints the records as EPD.
+//===========================================================//
+
+static t_mutex datagen_mutex;
+static FILE *datagen_file;
+static int datagen_games;
+static int datagen_next_game;
+static int datagen_games_done;
+static t_nodes datagen_positions;
+static t_nodes datagen_filtered;
+static int datagen_results[3];
+static unsigned long long datagen_start;
+
+static int datagen_depth;
+static t_nodes datagen_nodes;
+static int datagen_random;
+static BOOL datagen_book;
+static int datagen_filter;
+static unsigned long long datagen_seed;
+
+static char **datagen_opening;
+static int datagen_openings;
+
+static const char datagen_piece_char[16] = { ' ', 'N', 'B', 'R', 'Q', 'P', 'K', ' ', ' ', 'n', 'b', 'r', 'q', 'p', 'k', ' ' };
+
+//-- xorshift64*, one per game so a game only depends on the seed and its number
+static unsigned long long datagen_rand(unsigned long long *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+//-- Scores from the side to move, mates as +/-(DATAGEN_MATE_SCORE - plies to mate)
+static short datagen_score(t_chess_value score)
+{
+    if (score >= MAX_CHECKMATE)
+        return (short)max(DATAGEN_MAX_SCORE + 1, DATAGEN_MATE_SCORE - (CHECKMATE - score));
+    if (score <= -MAX_CHECKMATE)
+        return (short)min(-DATAGEN_MAX_SCORE - 1, -DATAGEN_MATE_SCORE + (CHECKMATE + score));
+    return (short)max(-DATAGEN_MAX_SCORE, min(score, DATAGEN_MAX_SCORE));
+}
+
+static void datagen_pack(struct t_board *board, struct t_move_record *move, t_chess_value score, struct t_datagen_record *record)
+{
+    pack_position(board, record);
+    record->score = datagen_score(score);
+    record->move = move->from_square | (move->to_square << 6) | (PIECETYPE(move->promote_to) << 12);
+}
+
+//-- The best move at the root (ply 1) by iterative deepening, the best move so far searched first
+static struct t_move_record *datagen_search(struct t_board *board, struct t_move_list *moves, t_chess_value *score)
+{
+    struct t_undo undo[1];
+    struct t_move_record *best_move = moves->move[0];
+    struct t_move_record *move;
+    t_chess_value alpha, e, best_score = 0;
+    int depth, i, j, best;
+
+    fixed_search_nodes = 0;
+    for (depth = 1; depth <= datagen_depth; depth++) {
+
+        //-- The first iteration always finishes, then the node budget can cut one short
+        fixed_search_limit = (depth > 1) ? datagen_nodes : 0;
+
+        alpha = -CHECKMATE;
+        best = 0;
+        for (i = 0; i < moves->count; i++) {
+            make_move(board, moves->pinned_pieces, moves->move[i], undo);
+            board->pv_data[1].current_move = moves->move[i];
+            evaluate(board, board->pv_data[2].eval);
+            e = -fixed_search(board, 2, depth - 1, -CHECKMATE, -alpha);
+            unmake_move(board, undo);
+
+            if (fixed_search_limit && fixed_search_nodes > fixed_search_limit)
+                break;
+            if (e > alpha) {
+                alpha = e;
+                best = i;
+            }
+        }
+        if (i < moves->count)
+            break;
+
+        //-- Keep the best move at the front
+        move = moves->move[best];
+        for (j = best; j > 0; j--)
+            moves->move[j] = moves->move[j - 1];
+        moves->move[0] = move;
+        best_move = move;
+        best_score = alpha;
+
+        if (best_score >= MAX_CHECKMATE || best_score <= -MAX_CHECKMATE)
+            break;
+        if (datagen_nodes && fixed_search_nodes > datagen_nodes)
+            break;
+    }
+    fixed_search_limit = 0;
+
+    //-- Mate distances from ply 0
+    if (best_score >= MAX_CHECKMATE)
+        best_score++;
+    else if (best_score <= -MAX_CHECKMATE)
+        best_score--;
+
+    *score = best_score;
+    return best_move;
+}
+
+//-- Sets up the opening (FALSE if it's over already)
+static BOOL datagen_opening_position(struct t_board *board, unsigned long long *rng)
+{
+    struct t_move_list moves[1];
+    struct t_move_record *move;
+    struct t_undo undo[1];
+    int i;
+
+    if (datagen_openings > 0)
+        set_fen(board, datagen_opening[datagen_rand(rng) % datagen_openings]);
+    else
+        set_fen(board, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -");
+
+    //-- probe_book() picks with rand(), which isn't thread safe
+    if (datagen_book) {
+        for (i = 0; i < DATAGEN_MAX_BOOK_PLIES; i++) {
+            mutex_lock(&datagen_mutex);
+            move = probe_book(board);
+            mutex_unlock(&datagen_mutex);
+            if (move == NULL)
+                break;
+            generate_legal_moves(board, moves);
+            make_move(board, moves->pinned_pieces, move, undo);
+        }
+    }
+
+    for (i = 0; i < datagen_random; i++) {
+        generate_legal_moves(board, moves);
+        if (moves->count == 0)
+            return FALSE;
+        make_move(board, moves->pinned_pieces, moves->move[datagen_rand(rng) % moves->count], undo);
+    }
+
+    return TRUE;
+}
+
+//-- Plays a game and writes out its positions
+static void datagen_play(struct t_board *board, int game, struct t_datagen_record *record)
+{
+    static char s[1024];
+    struct t_move_list moves[1];
+    struct t_move_record *move;
+    struct t_undo undo[1];
+    unsigned long long rng = (datagen_seed + 1) * 0x9E3779B97F4A7C15ULL ^ ((unsigned long long)(game + 1) * 0xBF58476D1CE4E5B9ULL);
+    t_chess_value score;
+    t_nodes filtered = 0;
+    int count = 0;
+    int result = 0;
+    int ply, i;
+    double seconds;
+
+    //-- Nothing left over from the last game (e.g. check killers)
+    clear_killers(board);
+
+    //-- Try another opening if the random moves ran into the end of the game
+    while (!datagen_opening_position(board, &rng))
+        ;
+
+    for (ply = 0; ply < DATAGEN_MAX_GAME_PLIES; ply++) {
+        generate_legal_moves(board, moves);
+        if (moves->count == 0) {
+            if (board->in_check)
+                result = (board->to_move == WHITE) ? -1 : 1;
+            break;
+        }
+        if (repetition_draw(board))
+            break;
+
+        evaluate(board, board->pv_data[1].eval);
+        move = datagen_search(board, moves, &score);
+
+        if ((datagen_filter & DATAGEN_FILTER_CHECK) && board->in_check)
+            filtered++;
+        else if ((datagen_filter & DATAGEN_FILTER_MATE) && (score >= MAX_CHECKMATE || score <= -MAX_CHECKMATE))
+            filtered++;
+        else if ((datagen_filter & DATAGEN_FILTER_CAPTURE) && (move->captured != BLANK || move->promote_to != BLANK))
+            filtered++;
+        else
+            datagen_pack(board, move, score, &record[count++]);
+
+        make_move(board, moves->pinned_pieces, move, undo);
+    }
+
+    for (i = 0; i < count; i++)
+        record[i].result = (signed char)result;
+
+    mutex_lock(&datagen_mutex);
+    fwrite(record, sizeof(struct t_datagen_record), count, datagen_file);
+    datagen_positions += count;
+    datagen_filtered += filtered;
+    datagen_results[result + 1]++;
+    datagen_games_done++;
+    if (datagen_games_done % DATAGEN_REPORT_GAMES == 0 && datagen_games_done < datagen_games) {
+        seconds = (time_now_ns() - datagen_start) / 1e9;
+        sprintf(s, "Datagen: %d of %d games, " NODE_FORMAT " positions, %.0f positions/s", datagen_games_done, datagen_games, datagen_positions,
+            (seconds > 0) ? datagen_positions / seconds : 0.0);
+        send_info(s);
+    }
+    mutex_unlock(&datagen_mutex);
+}
+
+static unsigned __stdcall datagen_worker(void* pArguments)
+{
+    struct t_board *board = (struct t_board *)malloc(sizeof(struct t_board));
+    struct t_datagen_record *record = (struct t_datagen_record *)malloc(DATAGEN_MAX_GAME_PLIES * sizeof(struct t_datagen_record));
+    int game;
+
+    numa_init_thread((int)(size_t)pArguments);
+    init_board(board);
+
+    for (;;) {
+        mutex_lock(&datagen_mutex);
+        game = datagen_next_game++;
+        mutex_unlock(&datagen_mutex);
+        if (game >= datagen_games)
+            break;
+
+        datagen_play(board, game, record);
+    }
+
+    numa_exit_thread();
+    free(record);
+    free(board);
+    return 0;
+}
+
+//-- The openings file's positions (only the first four fields, so the games can't start near the fifty move rule)
+static BOOL datagen_load_openings(char *filename)
+{
+    static char line[1024];
+    char copy[1024];
+    char *word[4];
+    int n, size = 0;
+    FILE *f;
+
+    if ((f = fopen(filename, "r")) == NULL)
+        return FALSE;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        strcpy(copy, line);
+        n = split_words(copy, word, 4);
+        if (!is_valid_fen(word, n))
+            continue;
+        if (datagen_openings == size) {
+            size = 2 * size + 1024;
+            datagen_opening = (char **)realloc(datagen_opening, size * sizeof(char *));
+        }
+        snprintf(line, sizeof(line), "%s %s %s %s", word[0], word[1], word[2], word[3]);
+        datagen_opening[datagen_openings++] = strdup(line);
+    }
+    fclose(f);
+
+    return TRUE;
+}
+
+//-- Opens the file to append to, writing the header if it's new
+static BOOL datagen_open(char *filename)
+{
+    struct t_datagen_header header[1];
+
+    if ((datagen_file = fopen(filename, "r+b")) != NULL) {
+        if (fread(header, sizeof(struct t_datagen_header), 1, datagen_file) != 1 || strcmp(header->magic, DATAGEN_MAGIC)
+            || header->version != DATAGEN_VERSION || header->record_size != sizeof(struct t_datagen_record)) {
+            fclose(datagen_file);
+            return FALSE;
+        }
+        fseek(datagen_file, 0, SEEK_END);
+        return TRUE;
+    }
+
+    if ((datagen_file = fopen(filename, "wb")) == NULL)
+        return FALSE;
+    memset(header, 0, sizeof(struct t_datagen_header));
+    strcpy(header->magic, DATAGEN_MAGIC);
+    header->version = DATAGEN_VERSION;
+    header->record_size = sizeof(struct t_datagen_record);
+    fwrite(header, sizeof(struct t_datagen_header), 1, datagen_file);
+    return TRUE;
+}
+
+BOOL datagen(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    static t_thread thread[DATAGEN_MAX_THREADS];
+    static struct t_board start_board[1];
+    char *word[64];
+    char *filename = NULL;
+    char *openings = NULL;
+    int threads = numa.cpu_count;
+    int i, n;
+    double seconds;
+    BOOL ok = TRUE;
+
+    //-- Options
+    datagen_games = DATAGEN_DEFAULT_GAMES;
+    datagen_depth = DATAGEN_DEFAULT_DEPTH;
+    datagen_nodes = 0;
+    datagen_random = DATAGEN_DEFAULT_RANDOM;
+    datagen_book = FALSE;
+    datagen_filter = DATAGEN_FILTER_CHECK | DATAGEN_FILTER_MATE | DATAGEN_FILTER_CAPTURE;
+    datagen_seed = 0;
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "games") && i < n - 1)
+            datagen_games = atoi(word[++i]);
+        else if (!strcmp(word[i], "depth") && i < n - 1) {
+            datagen_depth = atoi(word[++i]);
+            datagen_nodes = 0;
+        }
+        else if (!strcmp(word[i], "nodes") && i < n - 1) {
+            datagen_nodes = atoll(word[++i]);
+            datagen_depth = DATAGEN_MAX_DEPTH;
+        }
+        else if (!strcmp(word[i], "threads") && i < n - 1)
+            threads = atoi(word[++i]);
+        else if (!strcmp(word[i], "random") && i < n - 1)
+            datagen_random = atoi(word[++i]);
+        else if (!strcmp(word[i], "openings") && i < n - 1)
+            openings = word[++i];
+        else if (!strcmp(word[i], "book"))
+            datagen_book = TRUE;
+        else if (!strcmp(word[i], "seed") && i < n - 1)
+            datagen_seed = strtoull(word[++i], NULL, 10);
+        else if (!strcmp(word[i], "filter")) {
+            datagen_filter = 0;
+            while (i < n - 1) {
+                if (!strcmp(word[i + 1], "check"))
+                    datagen_filter |= DATAGEN_FILTER_CHECK;
+                else if (!strcmp(word[i + 1], "mate"))
+                    datagen_filter |= DATAGEN_FILTER_MATE;
+                else if (!strcmp(word[i + 1], "captures"))
+                    datagen_filter |= DATAGEN_FILTER_CAPTURE;
+                else if (strcmp(word[i + 1], "none"))
+                    break;
+                i++;
+            }
+        }
+        else if (filename == NULL)
+            filename = word[i];
+    }
+    threads = max(1, min(threads, DATAGEN_MAX_THREADS));
+    datagen_depth = max(1, min(datagen_depth, DATAGEN_MAX_DEPTH));
+    datagen_random = max(0, min(datagen_random, DATAGEN_MAX_RANDOM));
+    datagen_games = max(1, datagen_games);
+
+    if (filename == NULL) {
+        send_info("Datagen: datagen <file> [games n] [depth n | nodes n] [threads n] [random n] [openings file.epd] [book] [filter check mate captures | none] [seed n]");
+        return FALSE;
+    }
+    if (datagen_book && uci.opening_book.data == NULL) {
+        send_info("Datagen: no opening book is open");
+        return FALSE;
+    }
+
+    uci_wait_for_search();
+
+    datagen_opening = NULL;
+    datagen_openings = 0;
+    if (openings != NULL && (!datagen_load_openings(openings) || datagen_openings == 0)) {
+        snprintf(s, sizeof(s), "Datagen: no positions in %s", openings);
+        send_info(s);
+        ok = FALSE;
+    }
+    if (ok && !datagen_open(filename)) {
+        snprintf(s, sizeof(s), "Datagen: unable to write %s (or it isn't a datagen file)", filename);
+        send_info(s);
+        ok = FALSE;
+    }
+
+    if (ok) {
+        //-- Standard castling tables (set_fen() only changes them for Chess960) and a search which isn't stopped
+        init_board(start_board);
+        new_game(start_board);
+        uci.stop = FALSE;
+
+        datagen_next_game = 0;
+        datagen_games_done = 0;
+        datagen_positions = 0;
+        datagen_filtered = 0;
+        datagen_results[0] = datagen_results[1] = datagen_results[2] = 0;
+        mutex_init(&datagen_mutex);
+
+        datagen_start = time_now_ns();
+        for (i = 0; i < threads; i++)
+            thread_create(&thread[i], datagen_worker, (void *)(size_t)i);
+        for (i = 0; i < threads; i++)
+            thread_join(thread[i]);
+        seconds = (time_now_ns() - datagen_start) / 1e9;
+
+        if (fclose(datagen_file) != 0)
+            ok = FALSE;
+
+        sprintf(s, "Datagen: %d games (+%d =%d -%d for white), " NODE_FORMAT " positions (" NODE_FORMAT " filtered) in %.2f seconds = %.0f positions/s on %d threads",
+            datagen_games_done, datagen_results[2], datagen_results[1], datagen_results[0], datagen_positions, datagen_filtered, seconds,
+            (seconds > 0) ? datagen_positions / seconds : 0.0, threads);
+        send_info(s);
+    }
+
+    for (i = 0; i < datagen_openings; i++)
+        free(datagen_opening[i]);
+    free(datagen_opening);
+    datagen_opening = NULL;
+    datagen_openings = 0;
+
+    return ok;
+}
+
+//===========================================================//
+// Datagen Reader
+//
+// Streams the records of a datagen file a buffer at a time,
+// e.g. for tuning on more positions than fit in memory.
+//===========================================================//
+BOOL open_datagen_reader(struct t_datagen_reader *reader, char *filename)
+{
+    struct t_datagen_header header[1];
+
+    memset(reader, 0, sizeof(struct t_datagen_reader));
+    if ((reader->file = fopen(filename, "rb")) == NULL)
+        return FALSE;
+
+    if (fread(header, sizeof(struct t_datagen_header), 1, reader->file) != 1 || strcmp(header->magic, DATAGEN_MAGIC)
+        || header->version != DATAGEN_VERSION || header->record_size != sizeof(struct t_datagen_record)) {
+        fclose(reader->file);
+        reader->file = NULL;
+        return FALSE;
+    }
+
+    reader->buffer = (struct t_datagen_record *)malloc(DATAGEN_READ_RECORDS * sizeof(struct t_datagen_record));
+    return TRUE;
+}
+
+BOOL read_datagen_record(struct t_datagen_reader *reader, struct t_datagen_record *record)
+{
+    if (reader->next == reader->count) {
+        reader->count = (int)fread(reader->buffer, sizeof(struct t_datagen_record), DATAGEN_READ_RECORDS, reader->file);
+        reader->next = 0;
+        if (reader->count == 0)
+            return FALSE;
+    }
+
+    *record = reader->buffer[reader->next++];
+    return TRUE;
+}
+
+void close_datagen_reader(struct t_datagen_reader *reader)
+{
+    if (reader->file != NULL)
+        fclose(reader->file);
+    free(reader->buffer);
+    memset(reader, 0, sizeof(struct t_datagen_reader));
+}
+
+//-- The record's position as a FEN (without the move counters)
+void datagen_record_fen(struct t_datagen_record *record, char *fen)
+{
+    t_bitboard b = record->occupied;
+    t_chess_piece square[64];
+    t_chess_square s;
+    int r, c, i = 0, n;
+    char *p = fen;
+
+    memset(square, 0, sizeof(square));
+    while (b) {
+        s = bitscan_reset(&b);
+        square[s] = (record->pieces[i / 2] >> (4 * (i & 1))) & 15;
+        i++;
+    }
+
+    for (r = 7; r >= 0; r--) {
+        for (c = 0; c <= 7; c++) {
+            for (n = 0; c <= 7 && square[r * 8 + c] == BLANK; c++)
+                n++;
+            if (n)
+                *p++ = '0' + n;
+            if (c <= 7)
+                *p++ = datagen_piece_char[square[r * 8 + c]];
+        }
+        if (r > 0)
+            *p++ = '/';
+    }
+
+    *p++ = ' ';
+    *p++ = (record->flags & 1) ? 'b' : 'w';
+    *p++ = ' ';
+    if (record->flags & (WHITE_CASTLE_OO << 1))
+        *p++ = 'K';
+    if (record->flags & (WHITE_CASTLE_OOO << 1))
+        *p++ = 'Q';
+    if (record->flags & (BLACK_CASTLE_OO << 1))
+        *p++ = 'k';
+    if (record->flags & (BLACK_CASTLE_OOO << 1))
+        *p++ = 'q';
+    if (!(record->flags & 30))
+        *p++ = '-';
+    *p++ = ' ';
+    if (record->ep_square < 64) {
+        *p++ = 'a' + COLUMN(record->ep_square);
+        *p++ = '1' + RANK(record->ep_square);
+    }
+    else
+        *p++ = '-';
+    *p = 0;
+}
+
+//-- Just the position (no score, move or result)
+void pack_position(struct t_board *board, struct t_datagen_record *record)
+{
+    t_bitboard b = board->all_pieces;
+    t_chess_square s;
+    int i = 0;
+
+    memset(record, 0, sizeof(struct t_datagen_record));
+    record->occupied = b;
+    while (b) {
+        s = bitscan_reset(&b);
+        record->pieces[i / 2] |= board->square[s] << (4 * (i & 1));
+        i++;
+    }
+    record->flags = board->to_move | (board->castling << 1);
+    record->ep_square = board->ep_square ? bitscan(board->ep_square) : 64;
+    record->fifty_move_count = board->fifty_move_count;
+}
+
+//-- Sets up the board from a record (the fifty move count is left at zero, as there's no history for it)
+void unpack_position(struct t_board *board, struct t_datagen_record *record)
+{
+    char fen[128];
+
+    datagen_record_fen(record, fen);
+    set_fen(board, fen);
+}
+
+//-- "datadump <file> [count n]"
+BOOL datagen_dump(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    static const char *result[3] = { "0-1", "1/2-1/2", "1-0" };
+    static const char promotion[8] = { ' ', 'n', 'b', 'r', 'q', ' ', ' ', ' ' };
+    struct t_datagen_reader reader[1];
+    struct t_datagen_record record[1];
+    char fen[128];
+    char move[8];
+    char *word[64];
+    char *filename = NULL;
+    t_nodes count = 0, limit = 0;
+    int i, n, from, to;
+
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "count") && i < n - 1)
+            limit = atoll(word[++i]);
+        else if (filename == NULL)
+            filename = word[i];
+    }
+
+    if (filename == NULL || !open_datagen_reader(reader, filename)) {
+        snprintf(s, sizeof(s), "Datadump: unable to read %s (or it isn't a datagen file)", filename ? filename : "");
+        send_info(s);
+        return FALSE;
+    }
+
+    while ((limit == 0 || count < limit) && read_datagen_record(reader, record)) {
+        datagen_record_fen(record, fen);
+        from = record->move & 63;
+        to = (record->move >> 6) & 63;
+        move[0] = 'a' + COLUMN(from);
+        move[1] = '1' + RANK(from);
+        move[2] = 'a' + COLUMN(to);
+        move[3] = '1' + RANK(to);
+        move[4] = promotion[(record->move >> 12) & 7];
+        move[record->move >> 12 ? 5 : 4] = 0;
+        sprintf(s, "%s ce %d; sm %s; hmvc %d; c0 \"%s\";", fen, record->score, move, record->fifty_move_count, result[record->result + 1]);
+        send_command(s);
+        count++;
+    }
+    close_datagen_reader(reader);
+
+    sprintf(s, "Datadump: " NODE_FORMAT " records", count);
+    send_info(s);
+    return TRUE;
+}
@@ -27,6 +27,7 @@
 
 #define ENGINE_AUTHOR						"Steve Maughan"
 #include <cassert>
+#include <atomic>
 
 #if defined(__APPLE__)
 #include <pthread.h>
@@ -34,6 +35,24 @@
 #define Sleep(value) sleep(value)
 #endif
 
+#if defined(_WIN32)
+#include <windows.h>
+typedef CRITICAL_SECTION					t_mutex;
+typedef CONDITION_VARIABLE					t_condition;
+typedef HANDLE								t_thread;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t						t_mutex;
+typedef pthread_cond_t						t_condition;
+typedef pthread_t							t_thread;
+#endif
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 //===========================================================//
 // Primitive Logic
 //===========================================================///
@@ -153,6 +172,8 @@ typedef enum enginestates {
 // UCI Constants
 //===========================================================//
 #define UCI_BUFFER_SIZE						4096
+#define OUTPUT_BUFFER_SIZE					65536
+#define LOG_FILENAME						"maverick-log.txt"
 
 //===========================================================//
 // General Macros
@@ -304,6 +325,13 @@ struct t_material_hash_record
     void									(*eval_endgame)(struct t_board *board, struct t_chess_eval *eval);
 };
 
+//-- KPK bitbase (strong side normalised to white with the pawn on files a to d)
+#define KPK_INDEX_COUNT						(2 * 24 * 64 * 64)
+#define KPK_INVALID							0
+#define KPK_UNKNOWN							1
+#define KPK_DRAW							2
+#define KPK_WIN								4
+
 //===========================================================//
 // PV Data Structures
 //===========================================================//
@@ -348,6 +376,52 @@ struct t_pv_data
     t_node_type								node_type;
 };
 
+//===========================================================//
+// NNUE Evaluation
+//===========================================================//
+#define NNUE_MAGIC							"MAVNNUE"		// Followed by a zero, so 8 bytes
+#define NNUE_VERSION						1
+#define NNUE_DEFAULT_FILE					"maverick.nnue"
+#define NNUE_FEATURES						768				// Piece (own or theirs) x type x square, from each side's view
+#define NNUE_HIDDEN							256				// Accumulator values for each side
+#define NNUE_QA								127				// The accumulator's 1.0 (and where it's clipped)
+#define NNUE_QB								64				// The output weights' 1.0
+#define NNUE_SCALE							400				// Centipawns for an output of 1.0
+#define NNUE_MAX_COLUMNS					32				// Columns added or taken away at once
+
+//-- The file is this header followed by the arrays of t_nnue_network, in order and little-endian
+struct t_nnue_header
+{
+    char									magic[8];
+    int										version;
+    int										features;
+    int										hidden;
+};
+
+struct t_nnue_network
+{
+    short									feature_weight[NNUE_FEATURES][NNUE_HIDDEN];
+    short									feature_bias[NNUE_HIDDEN];
+    signed char								output_weight[2 * NNUE_HIDDEN];		// Side to move's half first
+    int										output_bias;
+};
+
+typedef enum t_nnue_kernel {
+    NNUE_SCALAR,
+    NNUE_SSSE3,
+    NNUE_AVX2
+} t_nnue_kernel;
+
+struct t_nnue
+{
+    BOOL									loaded;
+    BOOL									use;				// The "Use NNUE" option
+    BOOL									active;				// Used by evaluate() (and kept up to date by make_move)
+    int										version;			// Changes when the network does, so the boards refresh
+    char									filename[FILENAME_MAX];
+    struct t_nnue_network					*network;
+};
+
 
 //===========================================================//
 // Chess Board Structure
@@ -372,13 +446,12 @@ struct t_board
     uchar									fifty_move_count;
     struct t_pv_data						pv_data[MAXPLY + 2];
     BOOL									castling_squares_changed;
+    t_hash									draw_stack[MAX_MOVES];
+    int										draw_stack_count;
+    short									nnue_accumulator[2][NNUE_HIDDEN];	// By color, from that side's view
+    int										nnue_version;						// The accumulator is only good if this is nnue.version
 };
 
-//===========================================================//
-// Search Constants
-//===========================================================//
-#define NULL_REDUCTION						3
-
 //===========================================================//
 // Opening Book
 //===========================================================//
@@ -436,7 +509,7 @@ struct t_uci_opening_book
 {
     BOOL									use_own_book;
     char									filename[FILENAME_MAX];
-    FILE									*f;
+    const unsigned char						*data;
     int										book_size;
 	t_bookselectivity						book_selectivity;
 };
@@ -444,7 +517,7 @@ struct t_uci_opening_book
 struct t_uci
 {
     t_uci_engine_state						engine_state;
-    BOOL									stop;
+    std::atomic<BOOL>						stop;
     BOOL									quit;
     struct t_uci_opening_book				opening_book;
     struct t_level							level;
@@ -489,6 +562,535 @@ struct t_multi_pv {
     int										count;
     struct t_pv_record						pv[128];
 };
+//===========================================================//
+// Cluster Search
+//===========================================================//
+#define CLUSTER_MAX_WORKERS					64
+#define CLUSTER_SHARE_DEPTH					6
+#define CLUSTER_SHARE_BATCH					64
+#define CLUSTER_BUFFER_SIZE					(4 * UCI_BUFFER_SIZE)
+#define CLUSTER_PENDING_HASH				1024
+#define CLUSTER_STOP_TIMEOUT				1000
+#define CLUSTER_DEFAULT_ADDRESS				"127.0.0.1"
+
+struct t_cluster_hash_entry
+{
+    t_hash									key;
+    t_chess_value							score;
+    int										depth;
+    t_hash_bound							bound;
+    int										move;				// index into xmove_list (-1 if there's no move)
+};
+
+struct t_cluster_connection
+{
+    int										socket;
+    BOOL									busy;
+    struct t_move_record					*move;				// root move being searched by the worker
+    t_chess_value							alpha;
+    t_chess_value							beta;
+    int										length;
+    char									buffer[CLUSTER_BUFFER_SIZE];
+};
+
+struct t_cluster
+{
+    BOOL									is_worker;
+    BOOL									share_hash;
+    int										listen_socket;
+    int										port;
+    char									address[64];		// address the coordinator listens on
+    int										worker_count;
+    int										local_workers;
+    t_nodes									nodes;				// nodes searched by the workers
+    char									position[UCI_BUFFER_SIZE];
+    int										share_count;
+    struct t_cluster_hash_entry				share[CLUSTER_SHARE_BATCH];
+    struct t_cluster_connection				coordinator;
+    struct t_cluster_connection				worker[CLUSTER_MAX_WORKERS];
+};
+
+
+//===========================================================//
+// NUMA
+//===========================================================//
+#define NUMA_MAX_NODES						64
+#define NUMA_MAX_CPUS						1024
+
+typedef enum numa_hash_policy {
+	NUMA_HASH_DEFAULT,
+	NUMA_HASH_INTERLEAVE,
+	NUMA_HASH_LOCAL
+} t_numa_hash_policy;
+
+struct t_numa
+{
+    int										node_count;
+    int										cpu_count;
+    int										node_cpu_count[NUMA_MAX_NODES];
+    int										cpu_node[NUMA_MAX_CPUS];			// node of each processor (-1 if offline)
+    BOOL									bind_threads;
+    BOOL									rebind;
+    t_numa_hash_policy						hash_policy;
+    struct t_material_hash_record			*material_hash[NUMA_MAX_NODES];		// copy of the material hash on each node
+};
+
+//===========================================================//
+// Perft
+//===========================================================//
+#define PERFT_MAX_WORK						(256 * 256)
+#define PERFT_CACHE_BUCKET					2
+#define PERFT_TEST_CACHE					64				// Megabytes for the cached run of "testperft"
+
+//-- The check is the hash XOR the data, so a record torn by another thread is just a miss
+struct t_perft_cache_record
+{
+    t_hash									check;
+    t_hash									data;				// Nodes << 8 | depth
+};
+
+struct t_perft_work
+{
+    int										root;				// Index into the root moves
+    struct t_move_record					*move;				// Root move
+    t_bitboard								pinned;
+    struct t_move_record					*reply;				// Reply (NULL when splitting at the root)
+    t_bitboard								reply_pinned;
+    t_nodes									nodes;
+};
+
+//===========================================================//
+// Search Statistics
+//
+// Build with -DUSE_SEARCH_STATS to collect them; otherwise
+// SEARCH_STAT() expands to nothing and they cost nothing.
+//===========================================================//
+#ifdef USE_SEARCH_STATS
+#define SEARCH_STAT(x)						x
+#else
+#define SEARCH_STAT(x)
+#endif
+
+#define STATS_MOVE_INDEXES					16
+#define STATS_MAX_DEPTH						32
+#define STATS_DEPTH(d)						((d) < 0 ? 0 : ((d) >= STATS_MAX_DEPTH ? STATS_MAX_DEPTH - 1 : (d)))
+#define NODE_TYPES							6
+
+enum t_move_stage
+{
+    stage_hash,
+    stage_good_capture,
+    stage_killer,
+    stage_quiet,
+    stage_bad_capture,
+    stage_evasion
+};
+#define MOVE_STAGES							6
+
+enum t_node_outcome
+{
+    outcome_cut,
+    outcome_all,
+    outcome_pv
+};
+#define NODE_OUTCOMES						3
+
+struct t_search_stats
+{
+    t_nodes									cutoffs_by_index[STATS_MOVE_INDEXES];
+    t_nodes									cutoffs_by_stage[MOVE_STAGES];
+    t_nodes									null_move_tries;
+    t_nodes									null_move_cutoffs;
+    t_nodes									razor_tries;
+    t_nodes									razor_cutoffs;
+    t_nodes									beta_prune_tries;
+    t_nodes									beta_prune_cutoffs;
+    t_nodes									etc_tries;
+    t_nodes									etc_cutoffs;
+    t_nodes									lmr_reductions[NODE_TYPES];		// Moves reduced by more than one ply
+    t_nodes									lmr_researches[NODE_TYPES];
+    t_nodes									node_outcome[NODE_TYPES][NODE_OUTCOMES];	// Predicted node type against the result
+    t_nodes									iteration_nodes[MAXPLY + 1];	// Total nodes at the end of each iteration
+    int										iterations;
+    t_nodes									hash_probes[STATS_MAX_DEPTH];
+    t_nodes									hash_hits[STATS_MAX_DEPTH];
+    t_nodes									hash_cutoffs[STATS_MAX_DEPTH];
+};
+
+//===========================================================//
+// Search Trace
+//
+// Build with -DUSE_SEARCH_TRACE to be able to record the tree
+// ("trace" command).  The analyzer works in any build.
+//===========================================================//
+#ifdef USE_SEARCH_TRACE
+#define TRACE(x)							x
+#else
+#define TRACE(x)
+#endif
+
+#define TRACE_DEFAULT_NODES					250000
+#define TRACE_MAX_PATH						16
+#define TRACE_HOTSPOTS						10
+#define TRACE_VERSION						1
+
+enum t_trace_event
+{
+    trace_event_enter,
+    trace_event_exit,
+    trace_event_prune
+};
+
+enum t_prune_reason
+{
+    prune_hash,
+    prune_beta,
+    prune_razor,
+    prune_null_move,
+    prune_etc,
+    prune_futility
+};
+#define PRUNE_REASONS						6
+
+struct t_trace_record
+{
+    t_hash									hash;
+    unsigned int							node;				// For a prune, the node it happened in
+    unsigned int							parent;
+    int										alpha;
+    int										beta;
+    int										score;				// Result (exit) or the score used to prune
+    unsigned short							move;				// from | to << 6 | promotion << 12 (0 = none or null move)
+    uchar									event;
+    uchar									ply;
+    signed char								depth;
+    uchar									node_type;
+    uchar									reduction;
+    uchar									reason;
+};
+
+struct t_trace_header
+{
+    char									magic[8];
+    unsigned int							version;
+    unsigned int							record_size;
+    unsigned long long						count;
+};
+
+//-- Kept on the stack by alphabeta() so nested calls (e.g. IID) unwind correctly
+struct t_trace_frame
+{
+    unsigned int							node;
+    unsigned int							parent;
+    BOOL									in_subtree;
+};
+
+//===========================================================//
+// Bench
+//===========================================================//
+#define BENCH_MAX_POSITIONS					1024
+#define BENCH_DEFAULT_DEPTH					12
+#define BENCH_DEFAULT_HASH					512
+#define BENCH_DEFAULT_THRESHOLD				5				// Percentage nps drop allowed against a baseline
+
+enum t_bench_format
+{
+    BENCH_TEXT,
+    BENCH_JSON,
+    BENCH_CSV
+};
+
+struct t_bench_position
+{
+    char									fen[256];
+    int										depth;
+    t_nodes									nodes;
+    t_chess_time							time;
+    char									best_move[8];
+};
+
+//===========================================================//
+// Micro-benchmarks
+//===========================================================//
+#define MICRO_MAX_SAMPLES					1000
+
+enum t_micro_positions
+{
+    MICRO_ALL,
+    MICRO_NOT_IN_CHECK,
+    MICRO_IN_CHECK
+};
+
+struct t_micro_position
+{
+    struct t_board							*board;
+    struct t_move_list						moves[1];
+    struct t_move_list						captures[1];
+};
+
+struct t_micro_bench
+{
+    const char								*name;
+    t_micro_positions						positions;
+    t_nodes									(*run)(struct t_micro_position *p);		// Returns the number of operations
+};
+
+//===========================================================//
+// Batch Evaluation
+//===========================================================//
+#define BATCH_BLOCK_SIZE					(64 * 1024)		// Bytes of input handed to a thread at a time
+#define BATCH_BLOCKS_PER_THREAD				4
+#define BATCH_MAX_THREADS					256
+#define BATCH_MAX_DEPTH						16
+
+enum t_batch_mode
+{
+    BATCH_EVAL,
+    BATCH_QSEARCH,
+    BATCH_SEARCH
+};
+
+enum t_batch_state
+{
+    batch_block_free,
+    batch_block_filled,
+    batch_block_working,
+    batch_block_done
+};
+
+struct t_batch_block
+{
+    t_batch_state							state;
+    char									*data;				// Whole lines, either in the mapped file or in buffer
+    size_t									length;
+    char									*buffer;			// Only used when reading stdin
+    char									*output;
+    size_t									output_length;
+    size_t									output_size;
+    t_nodes									positions;
+    t_nodes									skipped;
+};
+
+//===========================================================//
+// Engine Processes
+//===========================================================//
+#define ENGINE_MAX_ARGUMENTS				8
+
+struct t_engine_process
+{
+    int										pid;
+    int										input;				// Pipe to the engine's stdin
+    int										output;				// Pipe from the engine's stdout
+    int										length;
+    char									buffer[4 * UCI_BUFFER_SIZE];
+};
+
+//===========================================================//
+// EPD Test Suites
+//===========================================================//
+#define SUITE_MAX_POSITIONS					4096
+#define SUITE_MAX_MOVES						8
+#define SUITE_MAX_WORKERS					64
+#define SUITE_DEFAULT_MOVETIME				1000
+#define SUITE_DEFAULT_HASH					512				// Split between the workers
+#define SUITE_STOP_GRACE					5000			// Milliseconds past the limit before a worker is told to stop
+
+struct t_suite_position
+{
+    char									fen[256];
+    char									id[64];
+    char									best_move[SUITE_MAX_MOVES][8];		// "bm", in coordinate notation
+    char									avoid_move[SUITE_MAX_MOVES][8];		// "am"
+    int										best_count;
+    int										avoid_count;
+    char									move[8];			// The move played
+    BOOL									solved;
+    t_chess_time							solve_time;			// When the move played was first found (-1 if not found)
+    t_nodes									solve_nodes;
+    t_chess_time							time;				// Search time reported by the worker
+    t_nodes									nodes;
+};
+
+struct t_suite_worker
+{
+    struct t_engine_process					process;
+    int										position;			// Position being searched (-1 if idle)
+    t_chess_time							start;
+    BOOL									stopped;
+};
+
+//===========================================================//
+// Datagen
+//===========================================================//
+#define DATAGEN_MAGIC						"MAVDATA"		// Followed by a zero, so 8 bytes
+#define DATAGEN_VERSION						1
+#define DATAGEN_MAX_THREADS					256
+#define DATAGEN_MAX_DEPTH					16
+#define DATAGEN_MAX_RANDOM					40				// Random plies at the start of a game
+#define DATAGEN_MAX_BOOK_PLIES				40
+#define DATAGEN_MAX_GAME_PLIES				400				// Then it's a draw
+#define DATAGEN_DEFAULT_GAMES				1000
+#define DATAGEN_DEFAULT_DEPTH				6
+#define DATAGEN_DEFAULT_RANDOM				8
+#define DATAGEN_MATE_SCORE					32000			// A mate in n (plies) is stored as +/-(32000 - n)
+#define DATAGEN_MAX_SCORE					30000
+#define DATAGEN_REPORT_GAMES				100
+#define DATAGEN_READ_RECORDS				4096			// Records read from the file at a time
+
+#define DATAGEN_FILTER_CHECK				1				// Positions where the side to move is in check
+#define DATAGEN_FILTER_MATE					2				// Mate scores
+#define DATAGEN_FILTER_CAPTURE				4				// Captures and promotions as the best move
+
+//-- The file is a header and then 32 byte records, little endian, in the order the games finish
+struct t_datagen_header
+{
+    char									magic[8];
+    unsigned int							version;
+    unsigned int							record_size;
+};
+
+struct t_datagen_record
+{
+    t_bitboard								occupied;
+    uchar									pieces[16];			// 4 bits a piece (as in square[]) for each occupied square, lowest square first
+    short									score;				// Side to move
+    unsigned short							move;				// from | to << 6 | promotion piece type << 12
+    signed char								result;				// 1 white wins, 0 draw, -1 black wins
+    uchar									flags;				// Bit 0 black to move, bits 1 to 4 castling rights
+    uchar									ep_square;			// 64 if none
+    uchar									fifty_move_count;
+};
+
+struct t_datagen_reader
+{
+    FILE									*file;
+    struct t_datagen_record					*buffer;
+    int										count;
+    int										next;
+};
+
+//===========================================================//
+// Evaluation Parameters
+//===========================================================//
+#define EVAL_PARAM_MAX_COUNT				64				// Values in the largest parameter
+#define TUNE_MAX_THREADS					256
+#define TUNE_DEFAULT_PASSES					10
+#define TUNE_MAX_POSITIONS					(64 * 1024 * 1024)
+
+struct t_eval_param
+{
+    const char								*name;
+    t_chess_value							*value;
+    int										count;
+};
+
+struct t_tune_position
+{
+    struct t_datagen_record					position;			// The quiet position at the end of the quiescent search's PV
+    float									result;				// 1 white wins, 0.5 draw, 0 black wins
+};
+
+enum t_tune_job
+{
+    TUNE_RESOLVE,
+    TUNE_ERROR,
+    TUNE_QUIT
+};
+
+//===========================================================//
+// Search Parameters
+//===========================================================//
+#define SEARCH_PARAM_MAX_COUNT				128
+#define LMR_MOVES							3
+#define LMR_BANDS							3				// Early, middle and late moves
+
+enum t_lmr_move
+{
+    lmr_capture,
+    lmr_unsafe,												// A quiet move to a square which isn't SEE safe
+    lmr_quiet
+};
+
+struct t_search_param
+{
+    const char								*name;
+    int										*value;
+    int										min;
+    int										max;
+    int										step;				// SPSA perturbation at the end of a run
+};
+
+//===========================================================//
+// Book Builder
+//===========================================================//
+#define BOOK_GAME_SIZE						16384
+#define BOOK_QUEUE_SIZE						64
+#define BOOK_MAX_RUNS						256
+#define BOOK_MAX_POSITION_MOVES				256
+
+struct t_book_entry
+{
+    t_hash									key;
+    unsigned int							move;				// Polyglot encoding
+    unsigned int							weight;				// 2 for a win, 1 for a draw
+    unsigned int							games;
+};
+
+struct t_book_game
+{
+    char									fen[256];
+    int										result;				// 1 = white win, 0 = draw, -1 = black win
+    char									moves[BOOK_GAME_SIZE];
+};
+
+//===========================================================//
+// PGN Annotation
+//===========================================================//
+#define ANNOTATE_TAG_SIZE					4096
+#define ANNOTATE_GAME_SIZE					16384
+#define ANNOTATE_OUTPUT_SIZE				65536
+#define ANNOTATE_QUEUE_SIZE					128				// Games read ahead of, or finished after, the next one to be written
+#define ANNOTATE_MAX_THREADS				64
+#define ANNOTATE_MAX_PLIES					800				// Longer games are copied as they are
+#define ANNOTATE_HISTORY_PLIES				100				// Moves sent with each position (enough for the fifty move rule)
+#define ANNOTATE_DEFAULT_NODES				200000
+#define ANNOTATE_DEFAULT_HASH				256				// Split between the threads
+#define ANNOTATE_DEFAULT_BLUNDER			200				// Centipawns lost by the move ("??", half as much for "?")
+#define ANNOTATE_SCORE_CAP					1000			// Scores beyond this (and mates) count as this much
+#define ANNOTATE_REPORT_INTERVAL			60000
+
+typedef enum t_annotate_state {
+    ANNOTATE_EMPTY,
+    ANNOTATE_WAITING,
+    ANNOTATE_WORKING,
+    ANNOTATE_DONE
+} t_annotate_state;
+
+struct t_annotate_game
+{
+    t_annotate_state						state;
+    BOOL									truncated;			// Too big to keep, so it's left out of the output
+    BOOL									annotated;			// Otherwise the game is written as it was read
+    char									fen[256];
+    char									result[16];
+    char									tags[ANNOTATE_TAG_SIZE];
+    char									moves[ANNOTATE_GAME_SIZE];
+    char									output[ANNOTATE_OUTPUT_SIZE];
+};
+
+//-- Each position in a game, and the move played from it
+struct t_annotate_position
+{
+    char									fen[100];
+    char									move[8];			// Coordinate notation
+    char									san[16];
+    char									best[16];			// The engine's move, in SAN
+    BOOL									best_played;
+    int										score;				// Centipawns for the side to move
+    int										mate;				// Mate in n moves (negative if mated), otherwise 0
+    BOOL									checkmate;
+    BOOL									stalemate;
+};
 
 //===========================================================//
 // Squares
@@ -588,6 +1190,6 @@ struct t_multi_pv {
 #define INFO_STRING_FAIL_LOW_SCORE				"info score cp %d upperbound time %ld depth %d seldepth %d nodes " NODE_FORMAT " pv "
 #define INFO_STRING_SEND_NODES					"info nodes " NODE_FORMAT " nps " NODE_FORMAT "\n"
 #define INFO_STRING_SEND_HASH_FULL				"info hashfull " NODE_FORMAT "\n"
-#define INFO_STRING_PERFT_SPEED					"Total Nodes: " NODE_FORMAT " in %d milliseconds = nps " NODE_FORMAT "\n"
-#define INFO_STRING_PERFT_NODES					"Total Nodes: " NODE_FORMAT "\n"
+#define INFO_STRING_PERFT_SPEED					"Total Nodes: " NODE_FORMAT " in %d milliseconds = nps " NODE_FORMAT
+#define INFO_STRING_PERFT_NODES					"Total Nodes: " NODE_FORMAT
 
@@ -22,8 +22,8 @@ BOOL repetition_draw(struct t_board *board)
         i = 4;
         do
         {
-            if (draw_stack[draw_stack_count - i] == board->hash) {
-                if (TRUE || draw_stack_count - i > search_start_draw_stack_count)
+            if (board->draw_stack[board->draw_stack_count - i] == board->hash) {
+                if (TRUE || board->draw_stack_count - i > search_start_draw_stack_count)
                     return TRUE;
                 reps++;
                 if (reps == 2)
@@ -0,0 +1,197 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Engine Processes
+//
+// Copies of this engine started as child processes, with a
+// pipe to their stdin and one from their stdout.  Used by the
+// EPD suite, the engine games, PGN annotation and the local
+// cluster workers (whose output isn't read).  Lines are read
+// into the engine's buffer, either one read at a time by
+// callers which poll many engines, or blocking with
+// engine_wait_line().
+//===========================================================//
+
+#if !defined(_WIN32)
+
+//-- Pipes and forks are made one thread at a time, so no engine inherits another's pipes
+static pthread_mutex_t engine_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void engine_close(struct t_engine_process *e)
+{
+    close(e->input);
+    if (e->output >= 0)
+        close(e->output);
+}
+
+//-- Start the engine with any command line arguments (a NULL terminated list, or NULL)
+BOOL engine_start(struct t_engine_process *e, const char *arguments[], BOOL read_output)
+{
+    const char *argv[ENGINE_MAX_ARGUMENTS + 2];
+    int to_engine[2], from_engine[2];
+    int null_file, i;
+
+    memset(e, 0, sizeof(struct t_engine_process));
+
+    argv[0] = engine_path;
+    for (i = 0; arguments != NULL && arguments[i] != NULL && i < ENGINE_MAX_ARGUMENTS; i++)
+        argv[i + 1] = arguments[i];
+    argv[i + 1] = NULL;
+
+    pthread_mutex_lock(&engine_mutex);
+    if (pipe(to_engine) < 0) {
+        pthread_mutex_unlock(&engine_mutex);
+        return FALSE;
+    }
+
+    //-- Output which isn't read goes nowhere, so the engine never blocks writing it
+    if (!read_output)
+        from_engine[0] = from_engine[1] = -1;
+    else if (pipe(from_engine) < 0) {
+        close(to_engine[0]);
+        close(to_engine[1]);
+        pthread_mutex_unlock(&engine_mutex);
+        return FALSE;
+    }
+
+    //-- Our ends aren't passed on to the other engines
+    fcntl(to_engine[1], F_SETFD, FD_CLOEXEC);
+    if (read_output)
+        fcntl(from_engine[0], F_SETFD, FD_CLOEXEC);
+
+    e->pid = fork();
+    if (e->pid == 0) {
+        dup2(to_engine[0], STDIN_FILENO);
+        close(to_engine[0]);
+        if (read_output) {
+            dup2(from_engine[1], STDOUT_FILENO);
+            close(from_engine[1]);
+        }
+        else if ((null_file = open("/dev/null", O_WRONLY)) >= 0)
+            dup2(null_file, STDOUT_FILENO);
+        execvp(engine_path, (char * const *)argv);
+        _exit(1);
+    }
+
+    close(to_engine[0]);
+    if (read_output)
+        close(from_engine[1]);
+    e->input = to_engine[1];
+    e->output = from_engine[0];
+    pthread_mutex_unlock(&engine_mutex);
+
+    if (e->pid < 0) {
+        engine_close(e);
+        e->pid = 0;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void engine_stop(struct t_engine_process *e, BOOL quit)
+{
+    if (e->pid <= 0)
+        return;
+    if (quit)
+        engine_send(e, "quit\n");
+    engine_close(e);
+    waitpid(e->pid, NULL, 0);
+    e->pid = 0;
+    e->length = 0;
+}
+
+BOOL engine_send(struct t_engine_process *e, const char *s)
+{
+    size_t length = strlen(s);
+    ssize_t n;
+
+    if (e->pid <= 0)
+        return FALSE;
+
+    while (length > 0) {
+        n = write(e->input, s, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        s += n;
+        length -= n;
+    }
+    return TRUE;
+}
+
+//-- One read into the buffer (FALSE if the engine has gone)
+BOOL engine_read(struct t_engine_process *e)
+{
+    ssize_t n;
+
+    if (e->output < 0)
+        return FALSE;
+
+    //-- A line which doesn't fit is thrown away
+    if (e->length >= (int)sizeof(e->buffer))
+        e->length = 0;
+
+    do {
+        n = read(e->output, e->buffer + e->length, sizeof(e->buffer) - e->length);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0)
+        return FALSE;
+    e->length += (int)n;
+    return TRUE;
+}
+
+//-- The next complete line in the buffer, if there is one
+BOOL engine_next_line(struct t_engine_process *e, char *line)
+{
+    char *p = (char *)memchr(e->buffer, '\n', e->length);
+    int n;
+
+    if (p == NULL)
+        return FALSE;
+
+    n = (int)(p - e->buffer);
+    memcpy(line, e->buffer, n);
+    line[n] = '\0';
+    if (n > 0 && line[n - 1] == '\r')
+        line[n - 1] = '\0';
+
+    e->length -= n + 1;
+    memmove(e->buffer, p + 1, e->length);
+    return TRUE;
+}
+
+//-- Block until the next line arrives (FALSE if the engine has gone)
+BOOL engine_wait_line(struct t_engine_process *e, char *line)
+{
+    while (!engine_next_line(e, line)) {
+        if (!engine_read(e))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+#endif
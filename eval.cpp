@@ -23,6 +23,7 @@
 #include "data.h"
 #include "procs.h"
 #include "bittwiddle.h"
+#include "profile.h"
 
 #ifdef USE_EVAL_HASH
 
@@ -38,6 +39,8 @@
 
 t_chess_value evaluate(struct t_board *board, struct t_chess_eval *eval) {
 
+    PROFILE(profile_evaluate);
+
     t_chess_value score;
 
 #ifdef USE_EVAL_HASH    
@@ -62,6 +65,8 @@ t_chess_value evaluate(struct t_board *board, struct t_chess_eval *eval) {
         material_hash[index].eval_endgame(board, eval);
         score = eval->static_score;
     }
+    else if (nnue.active)
+        score = nnue_evaluate(board, eval);
     else
         score = calc_evaluation(board, eval);
 
@@ -179,18 +184,18 @@ inline void calc_piece_value(struct t_board *board, struct t_chess_eval *eval) {
 
         //-- Rooks on the 7th
         if ((b & rank_mask[color][6]) && (board->pieces[opponent][KING] & rank_mask[color][7])) {
-            middlegame += MG_ROOK_ON_7TH;
-            endgame += MG_ROOK_ON_7TH;
+            middlegame += rook_on_7th[MIDDLEGAME];
+            endgame += rook_on_7th[ENDGAME];
         }
 
         //-- Rooks on Open file
         if (b & pawn_record->open_file) {
-			middlegame += popcount(b & pawn_record->open_file) * pawn_record->pawn_count[color] * MG_ROOK_ON_OPEN_FILE;
+			middlegame += popcount(b & pawn_record->open_file) * pawn_record->pawn_count[color] * rook_on_open_file;
         }
 
         //-- Rooks on Semi-Open file
         if (b & pawn_record->semi_open_file[color]) {
-			middlegame += popcount(b & pawn_record->semi_open_file[color]) * pawn_record->pawn_count[color] * MG_ROOK_ON_SEMI_OPEN_FILE;
+			middlegame += popcount(b & pawn_record->semi_open_file[color]) * pawn_record->pawn_count[color] * rook_on_semi_open_file;
         }
 
         //-- Loop around for all pieces
@@ -217,7 +222,7 @@ inline void calc_piece_value(struct t_board *board, struct t_chess_eval *eval) {
             //-- King safety
             if (attack_squares = (moves & eval->king_zone[opponent])) {
                 eval->king_attack_count[opponent]++;
-                eval->king_attack_pressure[opponent] += popcount(attack_squares) * 40;
+                eval->king_attack_pressure[opponent] += popcount(attack_squares) * king_attack_weight[ROOK];
             }
 			assert(eval->king_zone[opponent] != 0);
 
@@ -259,7 +264,7 @@ inline void calc_piece_value(struct t_board *board, struct t_chess_eval *eval) {
             //-- King safety
             if (attack_squares = ((rook_moves | bishop_moves) & eval->king_zone[opponent])) {
                 eval->king_attack_count[opponent]++;
-                eval->king_attack_pressure[opponent] += 80 * popcount(attack_squares);
+                eval->king_attack_pressure[opponent] += king_attack_weight[QUEEN] * popcount(attack_squares);
             }
 
             //-- piece-square tables
@@ -308,8 +313,8 @@ inline void calc_piece_value(struct t_board *board, struct t_chess_eval *eval) {
 
         //-- Bishop pair bonus
         if (b & (b - 1)) {
-            middlegame += MG_BISHOP_PAIR;
-            endgame += EG_BISHOP_PAIR;
+            middlegame += bishop_pair[MIDDLEGAME];
+            endgame += bishop_pair[ENDGAME];
         }
 
         //-- Remove Own Pieces (leave pawns)
@@ -338,7 +343,7 @@ inline void calc_piece_value(struct t_board *board, struct t_chess_eval *eval) {
             //-- King safety
             if (attack_squares = (moves & eval->king_zone[opponent])) {
                 eval->king_attack_count[opponent]++;
-                eval->king_attack_pressure[opponent] += 20 * popcount(attack_squares);
+                eval->king_attack_pressure[opponent] += king_attack_weight[BISHOP] * popcount(attack_squares);
             }
 
             // piece-square tables
@@ -386,14 +391,14 @@ inline void calc_piece_value(struct t_board *board, struct t_chess_eval *eval) {
 
             //-- Connected to another knight
             if (moves & board->piecelist[piece]) {
-                middlegame += MG_CONNECTED_KNIGHTS;
-                endgame += EG_CONNECTED_KNIGHTS;
+                middlegame += connected_knights[MIDDLEGAME];
+                endgame += connected_knights[ENDGAME];
             }
 
             //-- King safety
             if (attack_squares = (moves & eval->king_zone[opponent])) {
                 eval->king_attack_count[opponent]++;
-                eval->king_attack_pressure[opponent] += 20 * popcount(attack_squares);
+                eval->king_attack_pressure[opponent] += king_attack_weight[KNIGHT] * popcount(attack_squares);
             }
 
             //-- Mobility (not including any squares attacked by enemy pawns)
@@ -528,8 +533,8 @@ inline void calc_passed_pawns(struct t_board *board, struct t_chess_eval *eval)
 
             //-- Is a Rook behind the passed pawn
             if (forward_squares[opponent][square] & board->pieces[color][ROOK]) {
-                middlegame += MG_ROOK_BEHIND_PASSED_PAWN * (1 - color * 2);
-                endgame += EG_ROOK_BEHIND_PASSED_PAWN * (1 - color * 2);
+                middlegame += rook_behind_passed_pawn[MIDDLEGAME] * (1 - color * 2);
+                endgame += rook_behind_passed_pawn[ENDGAME] * (1 - color * 2);
             }
         }
 
@@ -569,24 +574,6 @@ void init_eval_function() {
     t_chess_square square, s;
     t_chess_color color;
 
-    piece_value[0][PAWN] = MG_PAWN_VALUE;
-    piece_value[1][PAWN] = EG_PAWN_VALUE;
-
-    piece_value[0][KNIGHT] = MG_KNIGHT_VALUE;
-    piece_value[1][KNIGHT] = EG_KNIGHT_VALUE;
-
-    piece_value[0][BISHOP] = MG_BISHOP_VALUE;
-    piece_value[1][BISHOP] = EG_BISHOP_VALUE;
-
-    piece_value[0][ROOK] = MG_ROOK_VALUE;
-    piece_value[1][ROOK] = EG_ROOK_VALUE;
-
-    piece_value[0][QUEEN] = MG_QUEEN_VALUE;
-    piece_value[1][QUEEN] = EG_QUEEN_VALUE;
-
-    piece_value[0][KING] = 0;
-    piece_value[1][KING] = 0;
-
     //-- reset
     for (color = WHITE; color <= BLACK; color++) {
         for (s = A1; s <= H8; s++) {
@@ -599,24 +586,24 @@ void init_eval_function() {
                 piece_square_table[piece][ENDGAME][square] = 0;
                 switch (piece_type) {
                 case KNIGHT:
-                    piece_square_table[piece][MIDDLEGAME][square] = knight_pst[MIDDLEGAME][s] + MG_KNIGHT_VALUE;
-                    piece_square_table[piece][ENDGAME][square] = knight_pst[ENDGAME][s] + EG_KNIGHT_VALUE;
+                    piece_square_table[piece][MIDDLEGAME][square] = knight_pst[MIDDLEGAME][s] + piece_value[MIDDLEGAME][KNIGHT];
+                    piece_square_table[piece][ENDGAME][square] = knight_pst[ENDGAME][s] + piece_value[ENDGAME][KNIGHT];
                     break;
                 case BISHOP:
-                    piece_square_table[piece][MIDDLEGAME][square] = bishop_pst[MIDDLEGAME][s] + MG_BISHOP_VALUE;
-                    piece_square_table[piece][ENDGAME][square] = bishop_pst[ENDGAME][s] + EG_BISHOP_VALUE;
+                    piece_square_table[piece][MIDDLEGAME][square] = bishop_pst[MIDDLEGAME][s] + piece_value[MIDDLEGAME][BISHOP];
+                    piece_square_table[piece][ENDGAME][square] = bishop_pst[ENDGAME][s] + piece_value[ENDGAME][BISHOP];
                     break;
                 case ROOK:
-                    piece_square_table[piece][MIDDLEGAME][square] = rook_pst[MIDDLEGAME][s] + MG_ROOK_VALUE;
-                    piece_square_table[piece][ENDGAME][square] = rook_pst[ENDGAME][s] + EG_ROOK_VALUE;
+                    piece_square_table[piece][MIDDLEGAME][square] = rook_pst[MIDDLEGAME][s] + piece_value[MIDDLEGAME][ROOK];
+                    piece_square_table[piece][ENDGAME][square] = rook_pst[ENDGAME][s] + piece_value[ENDGAME][ROOK];
                     break;
                 case QUEEN:
-                    piece_square_table[piece][MIDDLEGAME][square] = queen_pst[MIDDLEGAME][s] + MG_QUEEN_VALUE;
-                    piece_square_table[piece][ENDGAME][square] = queen_pst[ENDGAME][s] + EG_QUEEN_VALUE;
+                    piece_square_table[piece][MIDDLEGAME][square] = queen_pst[MIDDLEGAME][s] + piece_value[MIDDLEGAME][QUEEN];
+                    piece_square_table[piece][ENDGAME][square] = queen_pst[ENDGAME][s] + piece_value[ENDGAME][QUEEN];
                     break;
                 case PAWN:
-                    piece_square_table[piece][MIDDLEGAME][square] = pawn_pst[MIDDLEGAME][s] + MG_PAWN_VALUE;
-                    piece_square_table[piece][ENDGAME][square] = pawn_pst[ENDGAME][s] + EG_PAWN_VALUE;
+                    piece_square_table[piece][MIDDLEGAME][square] = pawn_pst[MIDDLEGAME][s] + piece_value[MIDDLEGAME][PAWN];
+                    piece_square_table[piece][ENDGAME][square] = pawn_pst[ENDGAME][s] + piece_value[ENDGAME][PAWN];
                     break;
                 case KING:
                     piece_square_table[piece][MIDDLEGAME][square] = king_pst[MIDDLEGAME][s];
@@ -653,37 +640,20 @@ void known_endgame_KPvk(struct t_board *board, struct t_chess_eval *eval)
     t_chess_square own_king = board->king_square[WHITE];
     t_chess_square s = bitscan(board->piecelist[WHITEPAWN]);
 
-    //-- Is the pawn obviously unstoppable?
-    if (board->piecelist[WHITEPAWN] & cannot_catch_pawn_mask[BLACK][board->to_move][opponents_king])
-        eval->static_score = 400 + 30 * RANK(s);
-
-    //-- Is it a king's rook pawn?
-    else if (COLUMN(s) == 7) {
-
-        //-- Who is closer to h8
-        if (square_distance(H8, own_king) > (square_distance(H8, opponents_king) - (board->to_move == BLACK)))
-            eval->static_score = 0;
-        else
-            eval->static_score = 350 + 20 * RANK(s);
+    //-- The bitbase couldn't be built, so the normal evaluation
+    if (!kpk_available) {
+        calc_evaluation(board, eval);
+        return;
     }
 
-    //-- Is it a queen's rook pawn?
-    else if (COLUMN(s) == 0) {
-
-        //-- Who is closer to h8
-        if (square_distance(A8, own_king) > (square_distance(H8, opponents_king) - (board->to_move == BLACK)))
-            eval->static_score = 0;
-        else
-            eval->static_score = 350 + 20 * RANK(s);
+    //-- Look up the result in the bitbase
+    if (!kpk_probe(board->to_move, own_king, opponents_king, s)) {
+        eval->static_score = 0;
+        return;
     }
 
-    //-- Can the pawn be taken by the opponent
-    else if (square_distance(s, own_king) < (square_distance(s, opponents_king) - (board->to_move == BLACK)))
-        eval->static_score = 10;
-
-    //-- Use normal heuristic of pawn advancing and proximity to king
-    else
-        eval->static_score = piece_square_table[WHITEKING][ENDGAME][own_king] - piece_square_table[BLACKKING][ENDGAME][opponents_king] + piece_square_table[WHITEPAWN][ENDGAME][s] + passed_pawn_bonus[WHITE][s] - 10 * square_distance(s, own_king) + 10 * square_distance(s, opponents_king);
+    //-- A won ending, so push the pawn and keep the king close to it
+    eval->static_score = 400 + 30 * RANK(s) + 10 * (square_distance(s, opponents_king) - square_distance(s, own_king));
 
     //-- Adjust for side to move
     eval->static_score *= (1 - board->to_move * 2);
@@ -699,37 +669,20 @@ void known_endgame_Kvkp(struct t_board *board, struct t_chess_eval *eval)
     t_chess_square own_king = board->king_square[BLACK];
     t_chess_square s = bitscan(board->piecelist[BLACKPAWN]);
 
-    //-- Is the pawn obviously unstoppable?
-    if (board->piecelist[BLACKPAWN] & cannot_catch_pawn_mask[WHITE][board->to_move][opponents_king])
-        eval->static_score = -400 - 30 * (7 - RANK(s));
-
-    //-- Is it a king's rook pawn?
-    else if (COLUMN(s) == 7) {
-
-        //-- Who is closer to H1
-        if (square_distance(H1, own_king) > (square_distance(H1, opponents_king) - (board->to_move == WHITE)))
-            eval->static_score = 0;
-        else
-            eval->static_score = -350 - 20 * (7 - RANK(s));
+    //-- The bitbase couldn't be built, so the normal evaluation
+    if (!kpk_available) {
+        calc_evaluation(board, eval);
+        return;
     }
 
-    //-- Is it a queen's rook pawn?
-    else if (COLUMN(s) == 0) {
-
-        //-- Who is closer to A1
-        if (square_distance(A1, own_king) > (square_distance(H1, opponents_king) - (board->to_move == WHITE)))
-            eval->static_score = 0;
-        else
-            eval->static_score = -350 - 20 * (7 - RANK(s));
+    //-- Look up the result in the bitbase, flipping the board so black becomes the strong side
+    if (!kpk_probe(OPPONENT(board->to_move), FLIP64(own_king), FLIP64(opponents_king), FLIP64(s))) {
+        eval->static_score = 0;
+        return;
     }
 
-    //-- Can the pawn be taken by the opponent
-    else if (square_distance(s, own_king) < (square_distance(s, opponents_king) - (board->to_move == WHITE)))
-        eval->static_score = -10;
-
-    //-- Use normal heuristic of pawn advancing and proximity to king
-    else
-        eval->static_score = -piece_square_table[BLACKKING][ENDGAME][own_king] + piece_square_table[WHITEKING][ENDGAME][opponents_king] - piece_square_table[BLACKPAWN][ENDGAME][s] + passed_pawn_bonus[BLACK][s] + 10 * square_distance(s, own_king) - 10 * square_distance(s, opponents_king);
+    //-- A won ending, so push the pawn and keep the king close to it
+    eval->static_score = -400 - 30 * (7 - RANK(s)) - 10 * (square_distance(s, opponents_king) - square_distance(s, own_king));
 
     //-- Adjust for side to move
     eval->static_score *= (1 - board->to_move * 2);
@@ -1199,7 +1152,7 @@ void known_endgame_KPPvk(struct t_board *board, struct t_chess_eval *eval){
 
 	int c = COLUMN(p1);
 
-	if ((c == 0 || c == 7) && (c == COLUMN(p2))){
+	if (kpk_available && (c == 0 || c == 7) && (c == COLUMN(p2))){
 		b = board->piecelist[WHITEPAWN];
 		board->piecelist[WHITEPAWN] = SQUARE64(p2);
 		known_endgame_KPvk(board, eval);
@@ -1223,7 +1176,7 @@ void known_endgame_Kvkpp(struct t_board *board, struct t_chess_eval *eval){
 
 	int c = COLUMN(p1);
 
-	if ((c == 0 || c == 7) && (c == COLUMN(p2))){
+	if (kpk_available && (c == 0 || c == 7) && (c == COLUMN(p2))){
 		b = board->piecelist[BLACKPAWN];
 		board->piecelist[BLACKPAWN] = SQUARE64(p1);
 		known_endgame_Kvkp(board, eval);
@@ -5,6 +5,8 @@
 //
 //===========================================================//
 
+//-- The default weights: the evaluation uses the parameters in data.cpp, which start
+//-- out with these values and can be changed at run time ("evalparams", evalparams.cpp)
 
 //-- Pawns
 #define MG_DOUBLE_PAWN					-10
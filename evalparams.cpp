@@ -0,0 +1,195 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Evaluation Parameters
+//
+//   evalparams [load <file> | save <file> | show [name]]
+//   setoption name Eval Params value <file>
+//
+// The weights in eval_param[] (data.cpp) can be changed at
+// run time.  A parameter file is each parameter's name
+// followed by all of its values; "#" starts a comment and any
+// parameter left out keeps its value.
+//===========================================================//
+
+struct t_eval_param *find_eval_param(char *name)
+{
+    struct t_eval_param *p;
+
+    for (p = eval_param; p->name != NULL; p++)
+        if (!strcmp(p->name, name))
+            return p;
+    return NULL;
+}
+
+//-- Brings the tables built from the parameters up to date (and every thread's pawn hash, when it next looks)
+void apply_eval_params()
+{
+    t_chess_square s;
+
+    for (s = A1; s <= H8; s++) {
+        passed_pawn_bonus[BLACK][s] = -passed_pawn_bonus[WHITE][FLIP64(s)];
+        inward_chain[BLACK][s] = -inward_chain[WHITE][FLIP64(s)];
+    }
+    init_eval_function();
+    eval_params_version++;
+    clear_pawn_hash();
+}
+
+//-- All or nothing, so a bad file leaves the parameters as they were
+BOOL load_eval_params(char *filename)
+{
+    static char line[1024];
+    static char s[1024];
+    static t_chess_value saved[4096];
+    struct t_eval_param *p, *param = NULL;
+    char *word[256];
+    int i, j, n, line_number = 0, filled = 0;
+    BOOL ok = TRUE;
+    FILE *f;
+
+    //-- The copy to go back to must hold every value
+    for (p = eval_param, i = 0; p->name != NULL; p++)
+        i += p->count;
+    if (i > (int)(sizeof(saved) / sizeof(saved[0]))) {
+        send_info("Eval Params: too many values to load");
+        return FALSE;
+    }
+
+    if ((f = fopen(filename, "r")) == NULL) {
+        snprintf(s, sizeof(s), "Eval Params: unable to read %s", filename);
+        send_info(s);
+        return FALSE;
+    }
+
+    for (p = eval_param, i = 0; p->name != NULL; p++)
+        for (j = 0; j < p->count; j++)
+            saved[i++] = p->value[j];
+
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        line_number++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        n = split_words(line, word, 256);
+
+        for (i = 0; ok && i < n; i++) {
+            if (is_number(word[i])) {
+                if (param == NULL || filled == param->count) {
+                    snprintf(s, sizeof(s), "Eval Params: %s line %d has too many values", filename, line_number);
+                    ok = FALSE;
+                }
+                else
+                    param->value[filled++] = atoi(word[i]);
+            }
+            else if (param != NULL && filled < param->count) {
+                snprintf(s, sizeof(s), "Eval Params: %s line %d, \"%s\" has %d values (not %d)", filename, line_number, param->name, filled, param->count);
+                ok = FALSE;
+            }
+            else if ((param = find_eval_param(word[i])) == NULL) {
+                snprintf(s, sizeof(s), "Eval Params: %s line %d, unknown parameter \"%.64s\"", filename, line_number, word[i]);
+                ok = FALSE;
+            }
+            else
+                filled = 0;
+        }
+    }
+    fclose(f);
+
+    if (ok && param != NULL && filled < param->count) {
+        snprintf(s, sizeof(s), "Eval Params: %s, \"%s\" has %d values (not %d)", filename, param->name, filled, param->count);
+        ok = FALSE;
+    }
+
+    if (!ok) {
+        for (p = eval_param, i = 0; p->name != NULL; p++)
+            for (j = 0; j < p->count; j++)
+                p->value[j] = saved[i++];
+        send_info(s);
+        return FALSE;
+    }
+
+    apply_eval_params();
+    snprintf(s, sizeof(s), "Eval Params: loaded %s", filename);
+    send_info(s);
+    return TRUE;
+}
+
+static void write_eval_param(FILE *f, struct t_eval_param *p)
+{
+    int i;
+
+    //-- Tables of squares as a board (a1 first), the rest on one line
+    if (p->count == 64) {
+        fprintf(f, "%s\n", p->name);
+        for (i = 0; i < 64; i++)
+            fprintf(f, "%s%5d%s", (i & 7) ? "" : "   ", p->value[i], ((i & 7) == 7) ? "\n" : "");
+    }
+    else {
+        fprintf(f, "%s", p->name);
+        for (i = 0; i < p->count; i++)
+            fprintf(f, " %d", p->value[i]);
+        fprintf(f, "\n");
+    }
+}
+
+BOOL save_eval_params(char *filename)
+{
+    struct t_eval_param *p;
+    FILE *f;
+
+    if ((f = fopen(filename, "w")) == NULL)
+        return FALSE;
+
+    fprintf(f, "# Maverick %s evaluation parameters\n", ENGINE_VERSION);
+    for (p = eval_param; p->name != NULL; p++)
+        write_eval_param(f, p);
+
+    return fclose(f) == 0;
+}
+
+void uci_eval_params(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    struct t_eval_param *p;
+    char *word[4];
+    int i, n, length;
+
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 4);
+
+    if (n >= 3 && !strcmp(word[1], "load")) {
+        uci_wait_for_search();
+        //-- The hash table's scores are from the old evaluation
+        if (load_eval_params(word[2]))
+            clear_hash();
+    }
+    else if (n >= 3 && !strcmp(word[1], "save")) {
+        snprintf(s, sizeof(s), save_eval_params(word[2]) ? "Eval Params: saved %s" : "Eval Params: unable to write %s", word[2]);
+        send_info(s);
+    }
+    else if (n >= 2 && !strcmp(word[1], "show")) {
+        for (p = eval_param; p->name != NULL; p++) {
+            if (n >= 3 && strstr(p->name, word[2]) == NULL)
+                continue;
+            length = sprintf(s, "info string %s", p->name);
+            for (i = 0; i < p->count && length < (int)sizeof(s) - 16; i++)
+                length += sprintf(s + length, " %d", p->value[i]);
+            send_command(s);
+        }
+    }
+    else
+        send_info("Eval Params: evalparams [load <file> | save <file> | show [name]]");
+}
@@ -15,32 +15,32 @@
 #include "procs.h"
 #include "bittwiddle.h"
 
-void set_fen(struct t_board *board, char *epd)
+void set_fen(struct t_board *board, const char *epd)
 {
 
     int r, c, i, l;
     char s;
     int count;
-    char fen[1024], tms[1024], ep[1024], castle[1024];
+    char copy[1024];
+    char *word[4];
+    char *fen, *tms, *ep, *castle;
 
     clear_board(board);
 
     board->chess960 = FALSE;
 
-    fen[0] = 0;
-    tms[0] = 0;
-    ep[0] = 0;
-    castle[0] = 0;
-
     board->hash = 0;
     board->pawn_hash = 0;
     board->material_hash = 0;
 
-    count = word_count(epd);
-    if (count >= 0) strcpy(fen, word_index(0, epd));
-    if (count >= 1) strcpy(tms, word_index(1, epd));
-    if (count >= 2) strcpy(castle, word_index(2, epd));
-    if (count >= 3) strcpy(ep, word_index(3, epd));
+    //-- Split the fields in one pass (and without any static buffers, so boards can be set up on several threads)
+    strncpy(copy, epd, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = 0;
+    count = split_words(copy, word, 4);
+    fen = (count > 0) ? word[0] : (char *)"";
+    tms = (count > 1) ? word[1] : (char *)"";
+    castle = (count > 2) ? word[2] : (char *)"";
+    ep = (count > 3) ? word[3] : (char *)"";
 
     l = (int)strlen(fen);
     r = 7;
@@ -210,7 +210,7 @@ void set_fen(struct t_board *board, char *epd)
 
     /* en-passant */
     board->ep_square = 0;
-    if (ep[0] != '-')
+    if (ep[0] >= 'a' && ep[0] <= 'h')
     {
         if (board->to_move ==  WHITE) {
             i = ep[0] - 'a' + 40;
@@ -238,8 +238,8 @@ void set_fen(struct t_board *board, char *epd)
 
     //// Reset draw variables
     board->fifty_move_count = 0;
-    draw_stack_count = 0;
-    draw_stack[0] = board->hash;
+    board->draw_stack_count = 0;
+    board->draw_stack[0] = board->hash;
 
     //// Evaluate Position
     //board->static_value = evaluate(board);
@@ -387,3 +387,41 @@ char *get_fen(struct t_board *board)
     s[i] = 0;
     return s;
 }
+
+//-- Checks the first four fields of a FEN from a file before set_fen() (which trusts its input): only the layout and the kings
+//-- are checked, and Chess960 castling is refused since it changes global tables (so it's no good for several threads)
+BOOL is_valid_fen(char *word[], int n)
+{
+    int rank = 0, file = 0, kings[2] = { 0, 0 };
+    char *s;
+
+    if (n < 4)
+        return FALSE;
+    for (s = word[0]; *s; s++) {
+        if (*s == '/') {
+            if (file != 8)
+                return FALSE;
+            rank++;
+            file = 0;
+        }
+        else if (*s >= '1' && *s <= '8')
+            file += *s - '0';
+        else if (strchr("pnbrqkPNBRQK", *s) != NULL) {
+            kings[BLACK] += (*s == 'k');
+            kings[WHITE] += (*s == 'K');
+            file++;
+        }
+        else
+            return FALSE;
+        if (file > 8)
+            return FALSE;
+    }
+    if (rank != 7 || file != 8 || kings[WHITE] != 1 || kings[BLACK] != 1)
+        return FALSE;
+    if (strcmp(word[1], "w") && strcmp(word[1], "b"))
+        return FALSE;
+    for (s = word[2]; *s; s++)
+        if (strchr("KQkq-", *s) == NULL)
+            return FALSE;
+    return TRUE;
+}
@@ -14,6 +14,7 @@
 #include "data.h"
 #include "procs.h"
 #include "bittwiddle.h"
+#include "profile.h"
 
 void generate_legal_moves(struct t_board *board, struct t_move_list *move_list)
 {
@@ -39,6 +40,8 @@ void generate_legal_moves(struct t_board *board, struct t_move_list *move_list)
 
 void generate_moves(struct t_board *board, struct t_move_list *move_list) {
 
+    PROFILE(profile_generate_moves);
+
     t_bitboard _all_pieces = board->all_pieces;
 
     struct t_move_record *move;
@@ -412,6 +415,8 @@ void generate_quiet_checks(struct t_board *board, struct t_move_list *move_list)
 
 void generate_captures(struct t_board *board, struct t_move_list *move_list) {
 
+    PROFILE(profile_generate_captures);
+
     t_bitboard _all_pieces = board->all_pieces;
 
     t_chess_color to_move = board->to_move;
@@ -591,6 +596,8 @@ void generate_captures(struct t_board *board, struct t_move_list *move_list) {
 
 void generate_evade_check(struct t_board *board, struct t_move_list *move_list) {
 
+    PROFILE(profile_generate_evade_check);
+
     t_bitboard _all_pieces = board->all_pieces;
     t_chess_piece piece, captured, promote_to;
     t_chess_square from_square, to_square;
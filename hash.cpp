@@ -16,24 +16,27 @@
 #include "data.h"
 #include "procs.h"
 #include "bittwiddle.h"
+#include "profile.h"
 
 void destroy_hash()
 {
-    free(hash_table);
+    if (hash_table != NULL)
+        numa_free(hash_table, (hash_mask + HASH_ATTEMPTS) * sizeof(struct t_hash_record));
 }
 
 void set_hash(unsigned int size)
 {
     size_t i;
 
-    if (uci.options.hash_table_size == size) return;
+    if (uci.options.hash_table_size == size && hash_table != NULL) return;
 
     i = 1;
     while ((i + 1) * sizeof(struct t_hash_record) <= size * 1024 * 1024)
         (i <<= 1);
 
-    free(hash_table);
-    hash_table = (struct t_hash_record*)malloc(i * sizeof(struct t_hash_record));
+    //-- Allocated with the NUMA policy (interleaved, local or default)
+    destroy_hash();
+    hash_table = (struct t_hash_record*)numa_alloc(i * sizeof(struct t_hash_record));
 
     hash_mask = i - HASH_ATTEMPTS;
     clear_hash();
@@ -43,10 +46,8 @@ void set_hash(unsigned int size)
 void poke(t_hash hash_key, t_chess_value score, int ply, int depth, t_hash_bound bound, struct t_move_record *move)
 {
 
-    struct t_hash_record *h, *best_hash;
-    int best_score;
-    int h_score;
-    int i;
+    PROFILE(profile_poke);
+
     int poke_score = score;
 	int poke_depth = depth;
 
@@ -68,6 +69,22 @@ void poke(t_hash hash_key, t_chess_value score, int ply, int depth, t_hash_bound
 			poke_depth = depth + 2;
 	}
 
+	//-- Pass the deep entries on to the rest of the cluster
+	if (cluster.share_hash && poke_depth >= CLUSTER_SHARE_DEPTH)
+		cluster_share_hash(hash_key, poke_score, poke_depth, bound, move);
+
+	poke_record(hash_key, poke_score, poke_depth, bound, move);
+}
+
+//-- Store a record whose score and depth have already been adjusted for mates
+void poke_record(t_hash hash_key, t_chess_value score, int depth, t_hash_bound bound, struct t_move_record *move)
+{
+
+    struct t_hash_record *h, *best_hash;
+    int best_score;
+    int h_score;
+    int i;
+
     h =	&hash_table[hash_key & hash_mask];
 
     best_score = -CHESS_INFINITY;
@@ -82,8 +99,8 @@ void poke(t_hash hash_key, t_chess_value score, int ply, int depth, t_hash_bound
 			//-- Make the current entry fresh
 			h->age = hash_age;
 			h->bound = bound;
-			h->score = poke_score;
-			h->depth = poke_depth;	
+			h->score = score;
+			h->depth = depth;	
 			h->move = move;
             
 			return;
@@ -102,9 +119,9 @@ void poke(t_hash hash_key, t_chess_value score, int ply, int depth, t_hash_bound
 
     best_hash->age = hash_age;
     best_hash->bound = bound;
-	h->depth = poke_depth;
+	best_hash->depth = depth;
 	best_hash->key = hash_key;
-    best_hash->score = poke_score;
+    best_hash->score = score;
     best_hash->move = move;
 
     return;
@@ -112,6 +129,8 @@ void poke(t_hash hash_key, t_chess_value score, int ply, int depth, t_hash_bound
 
 struct t_hash_record *probe(t_hash hash_key)
 {
+    PROFILE(profile_probe);
+
     struct t_hash_record *h;
     int i;
 
@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(_WIN32)
 #include <process.h>
@@ -21,30 +22,116 @@
 #include "procs.h"
 #include "bittwiddle.h"
 
+//-- The arguments as a UCI style command (e.g. "maverick bench depth 10" -> "bench depth 10")
+static char *command_line(int argc, char *argv[])
+{
+    static char command[1024];
+
+    command[0] = '\0';
+    for (int i = 1; i < argc; i++) {
+        if (i > 1)
+            strncat(command, " ", sizeof(command) - strlen(command) - 1);
+        strncat(command, argv[i], sizeof(command) - strlen(command) - 1);
+    }
+    return command;
+}
+
 int main(int argc, char *argv[])
 {
+    int exit_code = TRUE;
+
     setbuf(stdout, NULL);
     setbuf(stdin, NULL);
     setvbuf(stdout, NULL, _IONBF, 0);
     setvbuf(stdin, NULL, _IONBF, 0);
 
+    //-- Everything sent to the GUI goes through the writer thread
+    init_output();
+
     uci.engine_initialized = FALSE;
     uci.quit = FALSE;
     uci.stop = FALSE;
 
+    strncpy(engine_path, argv[0], FILENAME_MAX - 1);
+    cluster.listen_socket = -1;
+    strcpy(cluster.address, CLUSTER_DEFAULT_ADDRESS);
+
     init_engine(position);
     set_fen(position, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -");
 
+    //-- Run as a cluster worker ("maverick worker <host> <port>")
+    if (argc == 4 && !strcmp(argv[1], "worker")) {
+        cluster_worker(argv[2], argv[3]);
+        destroy_output();
+        return TRUE;
+    }
+
+    //-- Build a Polyglot book ("maverick makebook <book.bin> <games.pgn>... [options]")
+    if (argc >= 4 && !strcmp(argv[1], "makebook")) {
+        BOOL ok = make_book(argc - 2, argv + 2);
+        destroy_output();
+        return ok ? 0 : 1;
+    }
+
     create_uci_engine_thread();
 
     uci_set_author();
-    listen_for_uci_input();
+
+    //-- Run the bench and exit, failing against a baseline ("maverick bench [options]")
+    if (argc >= 2 && !strcmp(argv[1], "bench")) {
+        exit_code = bench(command_line(argc, argv)) ? 0 : 1;
+        uci_quit();
+    }
+
+    //-- Run an EPD test suite and exit, failing below the minimum ("maverick suite <file.epd> [options]")
+    else if (argc >= 3 && !strcmp(argv[1], "suite")) {
+        exit_code = run_test_suite(command_line(argc, argv)) ? 0 : 1;
+        uci_quit();
+    }
+
+    //-- Score positions from a file or stdin and exit ("maverick batch [eval | qsearch | depth n] [options] < in.epd")
+    else if (argc >= 2 && !strcmp(argv[1], "batch")) {
+        exit_code = batch_evaluate(command_line(argc, argv), TRUE) ? 0 : 1;
+        uci_quit();
+    }
+
+    //-- Play self-play games for training data and exit ("maverick datagen <file> [options]")
+    else if (argc >= 3 && !strcmp(argv[1], "datagen")) {
+        exit_code = datagen(command_line(argc, argv)) ? 0 : 1;
+        uci_quit();
+    }
+
+    //-- Tune the evaluation parameters and exit ("maverick tune <file> [options]")
+    else if (argc >= 3 && !strcmp(argv[1], "tune")) {
+        exit_code = tune_eval(command_line(argc, argv)) ? 0 : 1;
+        uci_quit();
+    }
+
+    //-- Annotate the games in a PGN file and exit ("maverick annotate <games.pgn> [options]")
+    else if (argc >= 3 && !strcmp(argv[1], "annotate")) {
+        exit_code = annotate_pgn(command_line(argc, argv)) ? 0 : 1;
+        uci_quit();
+    }
+
+    //-- Check the network's evaluation and exit ("maverick nnue <file.epd> [network f] verify")
+    else if (argc >= 3 && !strcmp(argv[1], "nnue")) {
+        exit_code = nnue_test(command_line(argc, argv)) ? 0 : 1;
+        uci_quit();
+    }
+    else
+        listen_for_uci_input();
+
+    cluster_shutdown();
 
     destroy_pawn_hash();
     destroy_material_hash();
+    destroy_nnue();
     destroy_hash();
+    destroy_numa();
 
     close_book();
 
-    return TRUE;
+    destroy_output();
+
+    return exit_code;
 }
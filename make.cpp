@@ -14,6 +14,7 @@
 #include "data.h"
 #include "procs.h"
 #include "bittwiddle.h"
+#include "profile.h"
 
 inline BOOL is_in_check_after_move(struct t_board *board, struct t_move_record *move) {
 
@@ -106,7 +107,7 @@ void make_null_move(struct t_board *board, struct t_undo *undo) {
         board->ep_square = 0;
     }
     board->fifty_move_count++;
-    draw_stack[++draw_stack_count] = board->hash;
+    board->draw_stack[++board->draw_stack_count] = board->hash;
 }
 
 void unmake_null_move(struct t_board *board, struct t_undo *undo) {
@@ -117,11 +118,13 @@ void unmake_null_move(struct t_board *board, struct t_undo *undo) {
     board->hash = undo->hash;
     board->pawn_hash = undo->pawn_hash;
     board->to_move = OPPONENT(board->to_move);
-    draw_stack_count--;
+    board->draw_stack_count--;
 }
 
 BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *move, struct t_undo *undo) {
 
+    PROFILE(profile_make_move);
+
     t_chess_color			color				= board->to_move;
     t_chess_color			opponent			= OPPONENT(color);
     t_chess_square			from				= move->from_square;
@@ -188,6 +191,10 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
     undo->pawn_hash					= board->pawn_hash;
     undo->material_hash				= board->material_hash;
 
+    // Update the network's accumulator
+    if (nnue.active)
+        nnue_make_move(board, move);
+
     // Move on board
     board->square[from] = BLANK;
 
@@ -223,7 +230,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // King square
         board->king_square[color] = to;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PAWN_PUSH1:
@@ -240,7 +247,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // Update ep flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PAWN_PUSH2:
@@ -262,7 +269,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         else
             board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PxPAWN:
@@ -283,7 +290,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // e.p flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PxPIECE:
@@ -304,7 +311,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // e.p flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PxP_EP:
@@ -328,7 +335,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // e.p flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PROMOTION:
@@ -349,7 +356,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // e.p flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_CAPTUREPROMOTE:
@@ -373,7 +380,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // e.p flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PIECE_MOVE:
@@ -390,7 +397,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // Update ep flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PIECExPIECE:
@@ -411,7 +418,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // Update ep flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_PIECExPAWN:
@@ -432,7 +439,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // Update ep flag
         board->ep_square = 0;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         return TRUE;
     case MOVE_KING_MOVE:
         // Update bitboards
@@ -450,7 +457,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // Update King Position
         board->king_square[color] = to;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_KINGxPIECE:
@@ -473,7 +480,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // Update King Position
         board->king_square[color] = to;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     case MOVE_KINGxPAWN:
@@ -496,7 +503,7 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
         // Update King Position
         board->king_square[color] = to;
         // Update draw stack with new hash value
-        draw_stack[++draw_stack_count] = board->hash;
+        board->draw_stack[++board->draw_stack_count] = board->hash;
         assert(integrity(board));
         return TRUE;
     }
@@ -506,6 +513,8 @@ BOOL make_move(struct t_board *board, t_bitboard pinned, struct t_move_record *m
 
 void unmake_move(struct t_board *board, struct t_undo *undo) {
 
+    PROFILE(profile_unmake_move);
+
     struct t_move_record *move		= undo->move;
     t_chess_square from				= move->from_square;
     t_chess_square to				= move->to_square;
@@ -532,7 +541,11 @@ void unmake_move(struct t_board *board, struct t_undo *undo) {
     board->square[from] = piece;
     board->to_move = color;
 
-    draw_stack_count--;
+    board->draw_stack_count--;
+
+    //-- Take the move out of the network's accumulator
+    if (nnue.active)
+        nnue_unmake_move(board, move);
 
     switch (move->move_type)
     {
@@ -44,6 +44,160 @@ void init_material_hash()
 
     } while (!fill_material_hash());
 
+    //-- Master copy for the threads on other NUMA nodes
+    numa.material_hash[0] = material_hash;
+
+    //-- Exact win / draw table for K + P vs. k
+    init_kpk_bitbase();
+}
+
+static inline int kpk_index(t_chess_color to_move, t_chess_square strong_king, t_chess_square weak_king, t_chess_square pawn)
+{
+    return strong_king | (weak_king << 6) | (to_move << 12) | ((COLUMN(pawn) + 4 * (RANK(pawn) - 1)) << 13);
+}
+
+static inline t_bitboard kpk_pawn_attacks(t_chess_square pawn)
+{
+    //-- pawn_attackers[] is empty on the seventh rank, so work it out here
+    t_bitboard b = 0;
+    if (COLUMN(pawn) > 0)
+        b |= SQUARE64(pawn + 7);
+    if (COLUMN(pawn) < 7)
+        b |= SQUARE64(pawn + 9);
+    return b;
+}
+
+static uchar kpk_initial_result(t_chess_color to_move, t_chess_square strong_king, t_chess_square weak_king, t_chess_square pawn)
+{
+    //-- Kings touching, or a king standing on the pawn?
+    if (strong_king == weak_king || strong_king == pawn || weak_king == pawn || (king_mask[strong_king] & SQUARE64(weak_king)))
+        return KPK_INVALID;
+
+    //-- White to move with the black king in check
+    if (to_move == WHITE && (kpk_pawn_attacks(pawn) & SQUARE64(weak_king)))
+        return KPK_INVALID;
+
+    if (to_move == WHITE) {
+
+        //-- Can the pawn promote safely?
+        t_chess_square promote_square = pawn + 8;
+        if (RANK(pawn) == 6 && promote_square != strong_king && promote_square != weak_king
+            && (!(king_mask[weak_king] & SQUARE64(promote_square)) || (king_mask[strong_king] & SQUARE64(promote_square))))
+            return KPK_WIN;
+    }
+    else {
+
+        //-- Stalemate?
+        if (!(king_mask[weak_king] & ~(king_mask[strong_king] | kpk_pawn_attacks(pawn))))
+            return KPK_DRAW;
+
+        //-- Can the pawn be taken?
+        if ((king_mask[weak_king] & SQUARE64(pawn)) && !(king_mask[strong_king] & SQUARE64(pawn)))
+            return KPK_DRAW;
+    }
+
+    return KPK_UNKNOWN;
+}
+
+static uchar kpk_classify(uchar *result, t_chess_color to_move, t_chess_square strong_king, t_chess_square weak_king, t_chess_square pawn)
+{
+    uchar r = KPK_INVALID;
+    t_bitboard b;
+
+    //-- Combine the results of every move.  Illegal moves lead to invalid positions and add nothing.
+    if (to_move == WHITE) {
+        b = king_mask[strong_king];
+        while (b)
+            r |= result[kpk_index(BLACK, bitscan_reset(&b), weak_king, pawn)];
+
+        if (RANK(pawn) < 6 && pawn + 8 != strong_king && pawn + 8 != weak_king) {
+            r |= result[kpk_index(BLACK, strong_king, weak_king, pawn + 8)];
+            if (RANK(pawn) == 1 && pawn + 16 != strong_king && pawn + 16 != weak_king)
+                r |= result[kpk_index(BLACK, strong_king, weak_king, pawn + 16)];
+        }
+
+        //-- White needs one winning move
+        if (r & KPK_WIN)
+            return KPK_WIN;
+        if (r & KPK_UNKNOWN)
+            return KPK_UNKNOWN;
+        return KPK_DRAW;
+    }
+
+    b = king_mask[weak_king];
+    while (b)
+        r |= result[kpk_index(WHITE, strong_king, bitscan_reset(&b), pawn)];
+
+    //-- Black needs one drawing move
+    if (r & KPK_DRAW)
+        return KPK_DRAW;
+    if (r & KPK_UNKNOWN)
+        return KPK_UNKNOWN;
+    return KPK_WIN;
+}
+
+//-- Without the memory to build it, K + P vs. k is left to the normal evaluation
+BOOL init_kpk_bitbase()
+{
+    uchar *result = (uchar *)malloc(KPK_INDEX_COUNT);
+    t_chess_square pawn;
+
+    kpk_available = FALSE;
+    if (result == NULL)
+        return FALSE;
+
+    //-- Mark the positions which are decided without looking at any moves
+    for (int p = 0; p < 24; p++) {
+        pawn = (t_chess_square)(8 + 8 * (p / 4) + (p % 4));
+        for (t_chess_color to_move = WHITE; to_move <= BLACK; to_move++) {
+            for (t_chess_square strong_king = 0; strong_king < 64; strong_king++) {
+                for (t_chess_square weak_king = 0; weak_king < 64; weak_king++)
+                    result[kpk_index(to_move, strong_king, weak_king, pawn)] = kpk_initial_result(to_move, strong_king, weak_king, pawn);
+            }
+        }
+    }
+
+    //-- Work backwards until nothing changes
+    BOOL changed;
+    do {
+        changed = FALSE;
+        for (int p = 0; p < 24; p++) {
+            pawn = (t_chess_square)(8 + 8 * (p / 4) + (p % 4));
+            for (t_chess_color to_move = WHITE; to_move <= BLACK; to_move++) {
+                for (t_chess_square strong_king = 0; strong_king < 64; strong_king++) {
+                    for (t_chess_square weak_king = 0; weak_king < 64; weak_king++) {
+                        int i = kpk_index(to_move, strong_king, weak_king, pawn);
+                        if (result[i] == KPK_UNKNOWN && (result[i] = kpk_classify(result, to_move, strong_king, weak_king, pawn)) != KPK_UNKNOWN)
+                            changed = TRUE;
+                    }
+                }
+            }
+        }
+    } while (changed);
+
+    //-- Pack the wins into bits
+    memset(kpk_bitbase, 0, sizeof(kpk_bitbase));
+    for (int i = 0; i < KPK_INDEX_COUNT; i++) {
+        if (result[i] == KPK_WIN)
+            kpk_bitbase[i >> 5] |= (1u << (i & 31));
+    }
+
+    free(result);
+    kpk_available = TRUE;
+    return TRUE;
+}
+
+BOOL kpk_probe(t_chess_color to_move, t_chess_square strong_king, t_chess_square weak_king, t_chess_square pawn)
+{
+    //-- Mirror the king side onto the queen side
+    if (COLUMN(pawn) > 3) {
+        strong_king ^= 7;
+        weak_king ^= 7;
+        pawn ^= 7;
+    }
+
+    int i = kpk_index(to_move, strong_king, weak_king, pawn);
+    return (kpk_bitbase[i >> 5] >> (i & 31)) & 1;
 }
 
 t_hash get_material_hash(const int material [])
@@ -0,0 +1,298 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+#include "bittwiddle.h"
+
+//===========================================================//
+// Micro-benchmarks
+//
+//   microbench [warmup passes] [samples n] [passes n] [name]...
+//
+// Each primitive is run on its own over a fixed set of
+// positions.  A pass is one run over every position, a sample
+// is a timed batch of passes, and the report gives the mean
+// ns/op, ops/s, the fastest sample and the spread between
+// samples.  Naming components (e.g. "microbench see eval")
+// runs just those.
+//===========================================================//
+
+static const char *micro_fen[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq -",
+    "1rq5/p3kp2/2Bp1p2/1P2p1r1/QP3n2/2P5/5PPP/R4RK1 b - -",
+    "2kr3r/pp1q1ppp/5n2/1Nb5/2Pp1B2/7Q/P4PPP/1R3RK1 w - -",
+    "8/5p2/pk2p3/4P2p/2b1pP1P/P3P2B/8/7K w - -",
+    "5rk1/2p4p/2p4r/3P4/4p1b1/1Q2NqPp/PP3P1K/R4R2 b - -",
+    "r1bq1rk1/pp2nppp/2n1p3/3pP3/1b1P4/2NB1N2/PP3PPP/R1BQK2R w KQ -",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - -",
+    //-- In check
+    "rnbqkbnr/ppp2ppp/8/1B1pp3/4P3/8/PPPP1PPP/RNBQK1NR b KQkq -",
+    "6k1/5ppp/8/8/8/8/5PPP/3r2K1 w - -",
+    "4k3/8/8/8/8/8/3p4/4K3 w - -",
+    "6k1/5ppp/8/8/8/6P1/5PqP/3R2K1 w - -",
+    "4k3/8/8/8/8/5n2/8/R3K2R w KQ -"
+};
+
+#define MICRO_POSITIONS (int)(sizeof(micro_fen) / sizeof(micro_fen[0]))
+
+static struct t_micro_position *micro_position;
+
+//-- Results go here so the compiler can't throw the work away
+static volatile t_nodes micro_sink;
+
+static t_nodes micro_generate_moves(struct t_micro_position *p)
+{
+    struct t_move_list move_list[1];
+
+    generate_moves(p->board, move_list);
+    micro_sink += move_list->count;
+    return 1;
+}
+
+static t_nodes micro_generate_captures(struct t_micro_position *p)
+{
+    struct t_move_list move_list[1];
+
+    generate_captures(p->board, move_list);
+    micro_sink += move_list->count;
+    return 1;
+}
+
+static t_nodes micro_generate_evade_check(struct t_micro_position *p)
+{
+    struct t_move_list move_list[1];
+
+    generate_evade_check(p->board, move_list);
+    micro_sink += move_list->count;
+    return 1;
+}
+
+//-- One operation is a make_move() and (if it was legal) the unmake_move()
+static t_nodes micro_make_move(struct t_micro_position *p)
+{
+    struct t_undo undo[1];
+    int i;
+
+    for (i = 0; i < p->moves->count; i++) {
+        if (make_move(p->board, p->moves->pinned_pieces, p->moves->move[i], undo))
+            unmake_move(p->board, undo);
+    }
+    return p->moves->count;
+}
+
+static t_nodes micro_evaluate(struct t_micro_position *p)
+{
+    micro_sink += evaluate(p->board, p->board->pv_data[0].eval);
+    return 1;
+}
+
+static t_nodes micro_pawn_hash_hit(struct t_micro_position *p)
+{
+    micro_sink += lookup_pawn_hash(p->board, p->board->pv_data[0].eval)->key;
+    return 1;
+}
+
+//-- Force the pawn structure to be evaluated from scratch
+static t_nodes micro_pawn_hash_miss(struct t_micro_position *p)
+{
+    pawn_hash[p->board->pawn_hash & pawn_hash_mask].key = 0;
+    micro_sink += lookup_pawn_hash(p->board, p->board->pv_data[0].eval)->key;
+    return 1;
+}
+
+static t_nodes micro_see(struct t_micro_position *p)
+{
+    int i;
+
+    for (i = 0; i < p->captures->count; i++)
+        micro_sink += see(p->board, p->captures->move[i], 0);
+    return p->captures->count;
+}
+
+static t_nodes micro_probe(struct t_micro_position *p)
+{
+    micro_sink += (probe(p->board->hash) != NULL);
+    return 1;
+}
+
+static t_nodes micro_poke(struct t_micro_position *p)
+{
+    poke(p->board->hash, 1, 0, 1, HASH_LOWER, p->moves->move[0]);
+    return 1;
+}
+
+//-- Rook and bishop attacks from every square
+static t_nodes micro_magic(struct t_micro_position *p)
+{
+    t_bitboard occupied = p->board->all_pieces;
+    t_bitboard b = 0;
+    t_chess_square s;
+
+    for (s = A1; s <= H8; s++) {
+        b ^= rook_magic_moves[s][((rook_magic[s].mask & occupied) * rook_magic[s].magic) >> 52];
+        b ^= bishop_magic_moves[s][((bishop_magic[s].mask & occupied) * bishop_magic[s].magic) >> 55];
+    }
+    micro_sink += b;
+    return 128;
+}
+
+static struct t_micro_bench micro_bench_list[] = {
+    { "movegen", MICRO_NOT_IN_CHECK, micro_generate_moves },
+    { "captures", MICRO_NOT_IN_CHECK, micro_generate_captures },
+    { "evasions", MICRO_IN_CHECK, micro_generate_evade_check },
+    { "makemove", MICRO_ALL, micro_make_move },
+    { "eval", MICRO_NOT_IN_CHECK, micro_evaluate },
+    { "pawnhash", MICRO_ALL, micro_pawn_hash_hit },
+    { "pawnhash-miss", MICRO_ALL, micro_pawn_hash_miss },
+    { "see", MICRO_NOT_IN_CHECK, micro_see },
+    { "probe", MICRO_ALL, micro_probe },
+    { "poke", MICRO_ALL, micro_poke },
+    { "magic", MICRO_ALL, micro_magic }
+};
+
+static t_nodes micro_pass(struct t_micro_bench *bench)
+{
+    t_nodes ops = 0;
+    int i;
+
+    for (i = 0; i < MICRO_POSITIONS; i++) {
+        if (bench->positions == MICRO_IN_CHECK && !micro_position[i].board->in_check)
+            continue;
+        if (bench->positions == MICRO_NOT_IN_CHECK && micro_position[i].board->in_check)
+            continue;
+        ops += bench->run(&micro_position[i]);
+    }
+    return ops;
+}
+
+static void run_micro_bench(struct t_micro_bench *bench, int warmup, int samples, int passes)
+{
+    static double ns_per_op[MICRO_MAX_SAMPLES];
+    static char s[1024];
+    unsigned long long start;
+    double mean = 0, best = 0, deviation = 0;
+    t_nodes ops;
+    int i, j;
+
+    for (i = 0; i < warmup; i++)
+        micro_pass(bench);
+
+    for (i = 0; i < samples; i++) {
+        ops = 0;
+        start = time_now_ns();
+        for (j = 0; j < passes; j++)
+            ops += micro_pass(bench);
+        ns_per_op[i] = (ops > 0) ? (double)(time_now_ns() - start) / ops : 0;
+
+        mean += ns_per_op[i];
+        if (i == 0 || ns_per_op[i] < best)
+            best = ns_per_op[i];
+    }
+    mean /= samples;
+
+    for (i = 0; i < samples; i++)
+        deviation += (ns_per_op[i] - mean) * (ns_per_op[i] - mean);
+    deviation = (samples > 1) ? sqrt(deviation / (samples - 1)) : 0;
+
+    sprintf(s, "%-14s %10.2f ns/op %14.0f ops/s  min %.2f  sd %.2f (%.1f%%)", bench->name, mean, (mean > 0) ? 1e9 / mean : 0,
+        best, deviation, (mean > 0) ? 100 * deviation / mean : 0);
+    send_command(s);
+}
+
+BOOL micro_bench(char *command)
+{
+    static char options[1024];
+    char *word[64];
+    int warmup = 100;
+    int samples = 10;
+    int passes = 2000;
+    int components = 0;
+    int count = sizeof(micro_bench_list) / sizeof(struct t_micro_bench);
+    BOOL selected[64] = { FALSE };
+    int i, j, n;
+
+    //-- Options
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "warmup") && i < n - 1)
+            warmup = atoi(word[++i]);
+        else if (!strcmp(word[i], "samples") && i < n - 1)
+            samples = atoi(word[++i]);
+        else if (!strcmp(word[i], "passes") && i < n - 1)
+            passes = atoi(word[++i]);
+        else {
+            for (j = 0; j < count; j++) {
+                if (!strcmp(word[i], micro_bench_list[j].name)) {
+                    selected[j] = TRUE;
+                    components++;
+                }
+            }
+        }
+    }
+    samples = max(1, min(samples, MICRO_MAX_SAMPLES));
+    passes = max(1, passes);
+
+    uci_wait_for_search();
+
+    //-- The positions, with their moves worked out up front
+    micro_position = (struct t_micro_position *)malloc(MICRO_POSITIONS * sizeof(struct t_micro_position));
+    if (micro_position == NULL) {
+        send_info("Micro-benchmarks: not enough memory");
+        return FALSE;
+    }
+    for (i = 0; i < MICRO_POSITIONS; i++) {
+        micro_position[i].board = (struct t_board *)malloc(sizeof(struct t_board));
+        if (micro_position[i].board == NULL) {
+            send_info("Micro-benchmarks: not enough memory");
+            for (j = 0; j < i; j++)
+                free(micro_position[j].board);
+            free(micro_position);
+            return FALSE;
+        }
+        init_board(micro_position[i].board);
+        set_fen(micro_position[i].board, (char *)micro_fen[i]);
+
+        if (micro_position[i].board->in_check) {
+            generate_evade_check(micro_position[i].board, micro_position[i].moves);
+            micro_position[i].captures->count = 0;
+        }
+        else {
+            generate_moves(micro_position[i].board, micro_position[i].moves);
+            generate_captures(micro_position[i].board, micro_position[i].captures);
+        }
+    }
+
+    //-- poke() does nothing once a search has been stopped
+    uci.stop = FALSE;
+
+    for (j = 0; j < count; j++) {
+        if (components == 0 || selected[j])
+            run_micro_bench(&micro_bench_list[j], warmup, samples, passes);
+    }
+
+    //-- Don't leave the made up entries behind
+    clear_hash();
+    destroy_pawn_hash();
+    init_pawn_hash();
+
+    for (i = 0; i < MICRO_POSITIONS; i++)
+        free(micro_position[i].board);
+    free(micro_position);
+
+    return TRUE;
+}
@@ -0,0 +1,540 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+#include "bittwiddle.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define USE_NNUE_SIMD
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+
+//===========================================================//
+// NNUE Evaluation
+//
+//   nnue <file> [network f] [limit n] [scalar | ssse3] [verify]
+//
+// An optional evaluation by a small network, switched on with
+// the "Use NNUE" option once a network has been loaded (from
+// NNUE_DEFAULT_FILE at startup, or the "EvalFile" option).
+// The first layer has a column of NNUE_HIDDEN weights for each
+// (piece, square) from each side's point of view, and the board
+// keeps the sum of the columns for its pieces (the accumulator)
+// for both sides.  make_move() and unmake_move() add and take
+// away the columns for the pieces which moved, so evaluate()
+// only has to clip the two accumulators to 0..NNUE_QA (side to
+// move first) and take their dot product with the int8 output
+// weights.  The accumulators are int16.  Both steps have AVX2
+// and SSSE3 versions, picked by what the CPU has, and plain C
+// for everything else.  A board which has been set up (or was
+// made while the network was off) has its accumulator worked
+// out again from scratch the next time it's evaluated.  The
+// "nnue" command times the network against the hand-crafted
+// evaluation and with "verify" checks the incremental updates
+// and every kernel against the plain C.
+//===========================================================//
+
+static t_nnue_kernel nnue_kernel;
+
+//-- The first layer's column for a piece on a square, seen from one side (so Black's view is flipped)
+static inline int nnue_feature(t_chess_color view, t_chess_piece piece, t_chess_square square)
+{
+    int type = PIECETYPE(piece) - 1 + ((COLOR(piece) == view) ? 0 : 6);
+
+    return 64 * type + ((view == WHITE) ? square : (square ^ 56));
+}
+
+//===========================================================//
+// Kernels
+//===========================================================//
+static void nnue_update_scalar(short *accumulator, const short **add, int add_count, const short **sub, int sub_count)
+{
+    int i, j;
+
+    for (i = 0; i < NNUE_HIDDEN; i++) {
+        int value = accumulator[i];
+        for (j = 0; j < add_count; j++)
+            value += add[j][i];
+        for (j = 0; j < sub_count; j++)
+            value -= sub[j][i];
+        accumulator[i] = (short)value;
+    }
+}
+
+static int nnue_output_scalar(const short *us, const short *them, const signed char *weight)
+{
+    int i, x, sum = 0;
+
+    for (i = 0; i < NNUE_HIDDEN; i++) {
+        x = max(0, min(NNUE_QA, us[i]));
+        sum += x * weight[i];
+        x = max(0, min(NNUE_QA, them[i]));
+        sum += x * weight[NNUE_HIDDEN + i];
+    }
+    return sum;
+}
+
+#if defined(USE_NNUE_SIMD)
+
+static AVX2_TARGET void nnue_update_avx2(short *accumulator, const short **add, int add_count, const short **sub, int sub_count)
+{
+    __m256i v;
+    int i, j;
+
+    for (i = 0; i < NNUE_HIDDEN; i += 16) {
+        v = _mm256_loadu_si256((const __m256i *)(accumulator + i));
+        for (j = 0; j < add_count; j++)
+            v = _mm256_add_epi16(v, _mm256_loadu_si256((const __m256i *)(add[j] + i)));
+        for (j = 0; j < sub_count; j++)
+            v = _mm256_sub_epi16(v, _mm256_loadu_si256((const __m256i *)(sub[j] + i)));
+        _mm256_storeu_si256((__m256i *)(accumulator + i), v);
+    }
+}
+
+//-- The clipped values fit in a byte, so maddubs can multiply 32 of them by the int8 weights at once
+static AVX2_TARGET int nnue_output_avx2(const short *us, const short *them, const signed char *weight)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i top = _mm256_set1_epi16(NNUE_QA);
+    const __m256i one = _mm256_set1_epi16(1);
+    const short *accumulator[2] = { us, them };
+    __m256i a, b, x, sum = zero;
+    __m128i s;
+    int i, side;
+
+    for (side = 0; side < 2; side++) {
+        for (i = 0; i < NNUE_HIDDEN; i += 32) {
+            a = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(accumulator[side] + i)), zero), top);
+            b = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(accumulator[side] + i + 16)), zero), top);
+
+            //-- packus works within each 128-bit half, so put the bytes back in order
+            x = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            x = _mm256_maddubs_epi16(x, _mm256_loadu_si256((const __m256i *)(weight + side * NNUE_HIDDEN + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, one));
+        }
+    }
+
+    s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+}
+
+static SSSE3_TARGET void nnue_update_ssse3(short *accumulator, const short **add, int add_count, const short **sub, int sub_count)
+{
+    __m128i v;
+    int i, j;
+
+    for (i = 0; i < NNUE_HIDDEN; i += 8) {
+        v = _mm_loadu_si128((const __m128i *)(accumulator + i));
+        for (j = 0; j < add_count; j++)
+            v = _mm_add_epi16(v, _mm_loadu_si128((const __m128i *)(add[j] + i)));
+        for (j = 0; j < sub_count; j++)
+            v = _mm_sub_epi16(v, _mm_loadu_si128((const __m128i *)(sub[j] + i)));
+        _mm_storeu_si128((__m128i *)(accumulator + i), v);
+    }
+}
+
+static SSSE3_TARGET int nnue_output_ssse3(const short *us, const short *them, const signed char *weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i top = _mm_set1_epi16(NNUE_QA);
+    const __m128i one = _mm_set1_epi16(1);
+    const short *accumulator[2] = { us, them };
+    __m128i a, b, x, sum = zero;
+    int i, side;
+
+    for (side = 0; side < 2; side++) {
+        for (i = 0; i < NNUE_HIDDEN; i += 16) {
+            a = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *)(accumulator[side] + i)), zero), top);
+            b = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *)(accumulator[side] + i + 8)), zero), top);
+            x = _mm_maddubs_epi16(_mm_packus_epi16(a, b), _mm_loadu_si128((const __m128i *)(weight + side * NNUE_HIDDEN + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(x, one));
+        }
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+#endif
+
+static void nnue_update(short *accumulator, const short **add, int add_count, const short **sub, int sub_count)
+{
+#if defined(USE_NNUE_SIMD)
+    if (nnue_kernel == NNUE_AVX2)
+        nnue_update_avx2(accumulator, add, add_count, sub, sub_count);
+    else if (nnue_kernel == NNUE_SSSE3)
+        nnue_update_ssse3(accumulator, add, add_count, sub, sub_count);
+    else
+#endif
+        nnue_update_scalar(accumulator, add, add_count, sub, sub_count);
+}
+
+static int nnue_output(const short *us, const short *them, const signed char *weight)
+{
+#if defined(USE_NNUE_SIMD)
+    if (nnue_kernel == NNUE_AVX2)
+        return nnue_output_avx2(us, them, weight);
+    if (nnue_kernel == NNUE_SSSE3)
+        return nnue_output_ssse3(us, them, weight);
+#endif
+    return nnue_output_scalar(us, them, weight);
+}
+
+//-- The best kernel this CPU can run
+static t_nnue_kernel nnue_best_kernel()
+{
+#if defined(USE_NNUE_SIMD)
+    if (__builtin_cpu_supports("avx2"))
+        return NNUE_AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return NNUE_SSSE3;
+#endif
+    return NNUE_SCALAR;
+}
+
+static const char *nnue_kernel_name(t_nnue_kernel kernel)
+{
+    return (kernel == NNUE_AVX2) ? "AVX2" : (kernel == NNUE_SSSE3) ? "SSSE3" : "scalar";
+}
+
+//===========================================================//
+// The accumulators
+//===========================================================//
+void nnue_refresh(struct t_board *board)
+{
+    const short *add[NNUE_MAX_COLUMNS];
+    t_chess_color view;
+    t_bitboard b;
+    int piece, n;
+
+    for (view = WHITE; view <= BLACK; view++) {
+        memcpy(board->nnue_accumulator[view], nnue.network->feature_bias, sizeof(board->nnue_accumulator[view]));
+        n = 0;
+        for (piece = 0; piece < 15; piece++) {
+            if (PIECETYPE(piece) < KNIGHT || PIECETYPE(piece) > KING)
+                continue;
+            b = board->piecelist[piece];
+            while (b && n < NNUE_MAX_COLUMNS)
+                add[n++] = nnue.network->feature_weight[nnue_feature(view, piece, bitscan_reset(&b))];
+        }
+        nnue_update(board->nnue_accumulator[view], add, n, NULL, 0);
+    }
+    board->nnue_version = nnue.version;
+}
+
+//-- The columns which change with a move by the side to move (taken back if "undo")
+static void nnue_move(struct t_board *board, struct t_move_record *move, BOOL undo)
+{
+    const short *add[2], *sub[2];
+    t_chess_color color = board->to_move;
+    t_chess_piece added_piece[2], removed_piece[2];
+    t_chess_square added_square[2], removed_square[2];
+    struct t_castle_record *castle_move;
+    t_chess_color view;
+    int added = 0, removed = 0, i;
+
+    removed_piece[removed] = move->piece;
+    removed_square[removed++] = move->from_square;
+    added_piece[added] = (move->promote_to != BLANK) ? move->promote_to : move->piece;
+    added_square[added++] = move->to_square;
+
+    if (move->move_type == MOVE_CASTLE) {
+        castle_move = &castle[move->index];
+        removed_piece[removed] = castle_move->rook_piece;
+        removed_square[removed++] = castle_move->rook_from;
+        added_piece[added] = castle_move->rook_piece;
+        added_square[added++] = castle_move->rook_to;
+    }
+    else if (move->captured != BLANK) {
+        removed_piece[removed] = move->captured;
+        removed_square[removed++] = (move->move_type == MOVE_PxP_EP) ? (move->to_square - 8) + 16 * color : move->to_square;
+    }
+
+    for (view = WHITE; view <= BLACK; view++) {
+        for (i = 0; i < added; i++)
+            add[i] = nnue.network->feature_weight[nnue_feature(view, added_piece[i], added_square[i])];
+        for (i = 0; i < removed; i++)
+            sub[i] = nnue.network->feature_weight[nnue_feature(view, removed_piece[i], removed_square[i])];
+        if (undo)
+            nnue_update(board->nnue_accumulator[view], sub, removed, add, added);
+        else
+            nnue_update(board->nnue_accumulator[view], add, added, sub, removed);
+    }
+}
+
+//-- Called before the move is made
+void nnue_make_move(struct t_board *board, struct t_move_record *move)
+{
+    nnue_move(board, move, FALSE);
+}
+
+//-- Called once the side to move is back
+void nnue_unmake_move(struct t_board *board, struct t_move_record *move)
+{
+    nnue_move(board, move, TRUE);
+}
+
+t_chess_value nnue_evaluate(struct t_board *board, struct t_chess_eval *eval)
+{
+    t_chess_color color = board->to_move;
+    long long output;
+
+    init_eval(eval);
+
+    if (board->nnue_version != nnue.version)
+        nnue_refresh(board);
+
+    output = nnue_output(board->nnue_accumulator[color], board->nnue_accumulator[OPPONENT(color)], nnue.network->output_weight);
+    eval->static_score = (t_chess_value)((output + nnue.network->output_bias) * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+    return eval->static_score;
+}
+
+//===========================================================//
+// Loading the network and the UCI options
+//===========================================================//
+void init_nnue()
+{
+    FILE *f;
+
+    nnue.loaded = FALSE;
+    nnue.use = FALSE;
+    nnue.active = FALSE;
+    nnue.version = 1;
+    nnue.filename[0] = '\0';
+    nnue.network = (struct t_nnue_network *)malloc(sizeof(struct t_nnue_network));
+    nnue_kernel = nnue_best_kernel();
+
+    //-- The default network, if there is one
+    if ((f = fopen(NNUE_DEFAULT_FILE, "rb")) != NULL) {
+        fclose(f);
+        load_nnue(NNUE_DEFAULT_FILE);
+    }
+}
+
+void destroy_nnue()
+{
+    free(nnue.network);
+    nnue.network = NULL;
+    nnue.loaded = FALSE;
+    nnue.active = FALSE;
+}
+
+BOOL load_nnue(const char *filename)
+{
+    static char s[1024];
+    struct t_nnue_header header[1];
+    struct t_nnue_network *network;
+    FILE *f;
+    BOOL ok;
+
+    if (nnue.network == NULL)
+        return FALSE;
+    if ((f = fopen(filename, "rb")) == NULL) {
+        snprintf(s, sizeof(s), "NNUE: unable to open %s", filename);
+        send_info(s);
+        return FALSE;
+    }
+
+    //-- Read into a new network, so a bad file leaves the old one alone
+    network = (struct t_nnue_network *)malloc(sizeof(struct t_nnue_network));
+    ok = (network != NULL && fread(header, sizeof(struct t_nnue_header), 1, f) == 1
+        && !strncmp(header->magic, NNUE_MAGIC, sizeof(header->magic)) && header->version == NNUE_VERSION
+        && header->features == NNUE_FEATURES && header->hidden == NNUE_HIDDEN
+        && fread(network->feature_weight, sizeof(network->feature_weight), 1, f) == 1
+        && fread(network->feature_bias, sizeof(network->feature_bias), 1, f) == 1
+        && fread(network->output_weight, sizeof(network->output_weight), 1, f) == 1
+        && fread(&network->output_bias, sizeof(network->output_bias), 1, f) == 1);
+    fclose(f);
+
+    if (!ok) {
+        snprintf(s, sizeof(s), "NNUE: %s isn't a %d x %d network (version %d)", filename, NNUE_FEATURES, NNUE_HIDDEN, NNUE_VERSION);
+        send_info(s);
+        free(network);
+        return FALSE;
+    }
+
+    memcpy(nnue.network, network, sizeof(struct t_nnue_network));
+    free(network);
+    strncpy(nnue.filename, filename, sizeof(nnue.filename) - 1);
+    nnue.loaded = TRUE;
+    nnue.active = nnue.use;
+    nnue.version++;
+
+    snprintf(s, sizeof(s), "NNUE: loaded %s (%s)", filename, nnue_kernel_name(nnue_kernel));
+    send_info(s);
+    return TRUE;
+}
+
+void set_nnue(BOOL use)
+{
+    nnue.use = use;
+    if (use && !nnue.loaded)
+        send_info("NNUE: no network has been loaded, so the evaluation is unchanged");
+
+    //-- The accumulators weren't kept up while it was off
+    if (nnue.loaded && use && !nnue.active)
+        nnue.version++;
+    nnue.active = (use && nnue.loaded);
+}
+
+//===========================================================//
+// Timing and checking
+//===========================================================//
+
+//-- Does the accumulator match one worked out from scratch?
+static BOOL nnue_check(struct t_board *board)
+{
+    static short accumulator[2][NNUE_HIDDEN];
+
+    memcpy(accumulator, board->nnue_accumulator, sizeof(accumulator));
+    nnue_refresh(board);
+    return !memcmp(accumulator, board->nnue_accumulator, sizeof(accumulator));
+}
+
+//-- "nnue <file> [network f] [limit n] [scalar | ssse3] [verify]"
+BOOL nnue_test(char *command)
+{
+    static char options[1024];
+    static char line[1024];
+    static char fen[256];
+    static char s[1024];
+    static struct t_board board[1];
+    struct t_move_list moves[1];
+    struct t_undo undo[1];
+    t_chess_value score, reference;
+    unsigned long long start, classic_time = 0, nnue_time = 0;
+    t_nnue_kernel kernel = nnue_best_kernel();
+    t_nnue_kernel k;
+    BOOL active = nnue.active;
+    char *word[16];
+    char *filename = NULL;
+    int i, n, count = 0, evaluations = 0, mismatches = 0;
+    int limit = 0;
+    BOOL verify = FALSE;
+    FILE *f;
+
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 16);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "network") && i < n - 1)
+            load_nnue(word[++i]);
+        else if (!strcmp(word[i], "limit") && i < n - 1)
+            limit = atoi(word[++i]);
+        else if (!strcmp(word[i], "scalar"))
+            kernel = NNUE_SCALAR;
+        else if (!strcmp(word[i], "ssse3"))
+            kernel = min(kernel, NNUE_SSSE3);
+        else if (!strcmp(word[i], "verify"))
+            verify = TRUE;
+        else if (filename == NULL)
+            filename = word[i];
+    }
+    if (filename == NULL) {
+        send_info("NNUE: nnue <file> [network f] [limit n] [scalar | ssse3] [verify]");
+        return FALSE;
+    }
+    if (!nnue.loaded) {
+        send_info("NNUE: no network has been loaded");
+        return FALSE;
+    }
+    if ((f = fopen(filename, "r")) == NULL) {
+        snprintf(s, sizeof(s), "NNUE: unable to open %s", filename);
+        send_info(s);
+        return FALSE;
+    }
+
+    uci_wait_for_search();
+    init_board(board);
+    nnue_kernel = kernel;
+
+    while ((limit == 0 || count < limit) && fgets(line, sizeof(line), f) != NULL) {
+        n = split_words(line, word, 4);
+        if (!is_valid_fen(word, n))
+            continue;
+        snprintf(fen, sizeof(fen), "%s %s %s %s", word[0], word[1], word[2], word[3]);
+        set_fen(board, fen);
+        if (is_in_check(board, OPPONENT(board->to_move)))
+            continue;
+        count++;
+        generate_legal_moves(board, moves);
+
+        //-- The hand-crafted evaluation after each move...
+        nnue.active = FALSE;
+        start = time_now_ns();
+        for (i = 0; i < moves->count; i++) {
+            make_move(board, moves->pinned_pieces, moves->move[i], undo);
+            evaluate(board, board->pv_data[1].eval);
+            unmake_move(board, undo);
+        }
+        classic_time += time_now_ns() - start;
+
+        //-- ...and the network's, with the accumulator updated as the moves are made
+        nnue.active = TRUE;
+        nnue_refresh(board);
+        start = time_now_ns();
+        for (i = 0; i < moves->count; i++) {
+            make_move(board, moves->pinned_pieces, moves->move[i], undo);
+            nnue_evaluate(board, board->pv_data[1].eval);
+            unmake_move(board, undo);
+        }
+        nnue_time += time_now_ns() - start;
+        evaluations += moves->count;
+
+        if (!verify)
+            continue;
+
+        //-- The accumulators must match ones from scratch, and every kernel must give the plain C score
+        for (i = 0; i < moves->count; i++) {
+            make_move(board, moves->pinned_pieces, moves->move[i], undo);
+            BOOL updated = nnue_check(board);
+            nnue_kernel = NNUE_SCALAR;
+            reference = nnue_evaluate(board, board->pv_data[1].eval);
+            for (k = NNUE_SSSE3; k <= kernel; k = (t_nnue_kernel)(k + 1)) {
+                nnue_kernel = k;
+                score = nnue_evaluate(board, board->pv_data[1].eval);
+                if (score != reference)
+                    updated = FALSE;
+            }
+            nnue_kernel = kernel;
+            unmake_move(board, undo);
+            if (!nnue_check(board))
+                updated = FALSE;
+
+            if (!updated && mismatches++ < 10) {
+                snprintf(s, sizeof(s), "NNUE: %s after %s doesn't match", fen, move_as_str(moves->move[i]));
+                send_info(s);
+            }
+        }
+    }
+    fclose(f);
+
+    snprintf(s, sizeof(s), "NNUE: %d positions, %d moves, hand-crafted %.0f per second, %s network %.0f per second (%.2fx)",
+        count, evaluations, evaluations * 1e9 / (classic_time + 1), nnue_kernel_name(kernel), evaluations * 1e9 / (nnue_time + 1),
+        (double)classic_time / (nnue_time + 1));
+    send_info(s);
+    if (verify) {
+        snprintf(s, sizeof(s), "NNUE: %d of %d moves don't match", mismatches, evaluations);
+        send_info(s);
+    }
+
+    nnue_kernel = nnue_best_kernel();
+    nnue.active = active;
+    nnue.version++;
+    return mismatches == 0 && count > 0;
+}
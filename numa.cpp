@@ -0,0 +1,274 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// NUMA Support
+//
+// On multi-socket Linux machines search threads can be pinned
+// to cores (round robin over the nodes), the main hash table
+// can be interleaved over all nodes or bound to the node of
+// the main search thread, and each thread gets its own pawn
+// hash and a node-local copy of the material hash.  Everywhere
+// else (and on single node machines) this is all a no-op.
+//===========================================================//
+
+#if defined(__linux__)
+
+#ifndef MPOL_BIND
+#define MPOL_BIND							2
+#define MPOL_INTERLEAVE						3
+#endif
+
+static pthread_mutex_t numa_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void read_cpu_list(char *s, int node)
+{
+	int first, last, n;
+
+	while (sscanf(s, "%d%n", &first, &n) == 1) {
+		s += n;
+		last = first;
+		if (*s == '-' && sscanf(s + 1, "%d%n", &last, &n) == 1)
+			s += n + 1;
+		for (int cpu = first; cpu <= last && cpu < NUMA_MAX_CPUS; cpu++) {
+			if (numa.cpu_node[cpu] < 0) {
+				numa.cpu_node[cpu] = node;
+				numa.node_cpu_count[node]++;
+				numa.cpu_count++;
+			}
+		}
+		if (*s == ',')
+			s++;
+	}
+}
+
+void init_numa()
+{
+	char filename[FILENAME_MAX];
+	char s[4096];
+	FILE *f;
+	int node;
+
+	for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++)
+		numa.cpu_node[cpu] = -1;
+
+	numa.node_count = 0;
+	numa.cpu_count = 0;
+
+	//-- Read the topology from sysfs
+	for (node = 0; node < NUMA_MAX_NODES; node++) {
+		numa.node_cpu_count[node] = 0;
+		sprintf(filename, "/sys/devices/system/node/node%d/cpulist", node);
+		if ((f = fopen(filename, "r")) == NULL)
+			break;
+		if (fgets(s, sizeof(s), f) != NULL)
+			read_cpu_list(s, node);
+		fclose(f);
+		numa.node_count++;
+	}
+
+	//-- No NUMA information (e.g. a kernel without NUMA), so one node with all of the processors
+	if (numa.node_count == 0 || numa.cpu_count == 0) {
+		numa.node_count = 1;
+		numa.cpu_count = 0;
+		numa.node_cpu_count[0] = 0;
+		for (int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN) && cpu < NUMA_MAX_CPUS; cpu++) {
+			numa.cpu_node[cpu] = 0;
+			numa.node_cpu_count[0]++;
+			numa.cpu_count++;
+		}
+	}
+}
+
+int numa_bind_thread(int thread_index)
+{
+	cpu_set_t cpu_set;
+	int node = thread_index % numa.node_count;
+	int n = (thread_index / numa.node_count) % max(1, numa.node_cpu_count[node]);
+	int cpu;
+
+	//-- Find the n-th processor on the node
+	for (cpu = 0; cpu < NUMA_MAX_CPUS; cpu++) {
+		if (numa.cpu_node[cpu] == node && n-- == 0)
+			break;
+	}
+	if (cpu == NUMA_MAX_CPUS)
+		return 0;
+
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0)
+		return 0;
+
+	return node;
+}
+
+void *numa_alloc(size_t size)
+{
+	unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long)) + 1];
+	void *p;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	//-- Set the memory policy before the pages are touched
+	if (numa.node_count > 1 && numa.hash_policy != NUMA_HASH_DEFAULT) {
+		memset(mask, 0, sizeof(mask));
+		if (numa.hash_policy == NUMA_HASH_INTERLEAVE) {
+			for (int node = 0; node < numa.node_count; node++)
+				mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+			syscall(SYS_mbind, p, size, MPOL_INTERLEAVE, mask, NUMA_MAX_NODES + 1, 0);
+		}
+		else {
+			//-- The main search thread is always on the first node
+			mask[0] = 1;
+			syscall(SYS_mbind, p, size, MPOL_BIND, mask, NUMA_MAX_NODES + 1, 0);
+		}
+	}
+
+	return p;
+}
+
+void numa_free(void *p, size_t size)
+{
+	if (p != NULL)
+		munmap(p, size);
+}
+
+static struct t_material_hash_record *numa_material_hash(int node)
+{
+	size_t size = (material_hash_mask + 1) * sizeof(struct t_material_hash_record);
+
+	if (node == 0 || numa.node_count <= 1 || !numa.bind_threads)
+		return numa.material_hash[0];
+
+	//-- The copy is made by a thread already running on the node, so the pages end up there
+	pthread_mutex_lock(&numa_mutex);
+	if (numa.material_hash[node] == NULL) {
+		numa.material_hash[node] = (struct t_material_hash_record *)malloc(size);
+		memcpy(numa.material_hash[node], numa.material_hash[0], size);
+	}
+	pthread_mutex_unlock(&numa_mutex);
+
+	return numa.material_hash[node];
+}
+
+#else
+
+void init_numa()
+{
+	numa.node_count = 1;
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	numa.cpu_count = info.dwNumberOfProcessors;
+#else
+	numa.cpu_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	numa.node_cpu_count[0] = numa.cpu_count;
+}
+
+int numa_bind_thread(int thread_index)
+{
+	return 0;
+}
+
+void *numa_alloc(size_t size)
+{
+	return malloc(size);
+}
+
+void numa_free(void *p, size_t size)
+{
+	free(p);
+}
+
+static struct t_material_hash_record *numa_material_hash(int node)
+{
+	return numa.material_hash[0];
+}
+
+#endif
+
+void numa_init_thread(int thread_index)
+{
+	int node = 0;
+
+	if (numa.bind_threads)
+		node = numa_bind_thread(thread_index);
+
+	//-- Thread local tables, allocated once the thread is on its node
+	material_hash = numa_material_hash(node);
+	destroy_pawn_hash();
+	init_pawn_hash();
+}
+
+//-- Before the thread ends, its own tables are given back
+void numa_exit_thread()
+{
+	destroy_pawn_hash();
+}
+
+void numa_set_hash_policy(t_numa_hash_policy policy)
+{
+	if (numa.hash_policy == policy)
+		return;
+
+	numa.hash_policy = policy;
+
+	//-- Reallocate the hash table with the new policy
+	destroy_hash();
+	hash_table = NULL;
+	set_hash(uci.options.hash_table_size);
+}
+
+void numa_report()
+{
+	static char s[1024];
+	static const char *policy[3] = { "default", "interleaved", "local" };
+	int n;
+
+	n = sprintf(s, "NUMA: %d node%s, %d cpu%s", numa.node_count, numa.node_count == 1 ? "" : "s", numa.cpu_count, numa.cpu_count == 1 ? "" : "s");
+	if (numa.node_count > 1) {
+		for (int node = 0; node < numa.node_count && n < 900; node++)
+			n += sprintf(s + n, ", node %d = %d cpus", node, numa.node_cpu_count[node]);
+	}
+	sprintf(s + n, ", threads %s, hash %s", numa.bind_threads ? "pinned" : "not pinned", policy[numa.hash_policy]);
+	send_info(s);
+}
+
+void destroy_numa()
+{
+	for (int node = 1; node < NUMA_MAX_NODES; node++) {
+		free(numa.material_hash[node]);
+		numa.material_hash[node] = NULL;
+	}
+}
@@ -8,6 +8,7 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
@@ -18,6 +19,14 @@
 #include <shlwapi.h>
 #else
 #include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <mach-o/dyld.h>
 #endif
 
 #include <iostream>
@@ -26,104 +35,67 @@
 #include "data.h"
 #include "procs.h"
 
+//===========================================================//
+// Polyglot Opening Book
+//
+// The book is mapped into memory (read only and shared, so
+// any number of engines can use the same copy of a large book
+// in the page cache) and the binary search works directly on
+// the 16 byte big-endian entries.
+//===========================================================//
 
-#if defined(__arm__) || defined(__linux__) || defined(__APPLE__)
-
-void close_book()
-{
-
-}
-
-void set_own_book(BOOL value)
-{
-
-}
-
-void set_opening_book(char *book)
-{
-
-
-}
-
-int book_count()
-{
-
-}
-
-char *book_string()
-{
-
-
-}
-
-unsigned long long read_integer(FILE *file, int size)
-{
-
-
-}
-
-void read_book_move(int index, struct t_book_move *book_move)
-{
-
-}
-
-struct t_move_record *decode_move(struct t_board *board, unsigned int move)
-{
-
-}
-
-t_move_record *probe_book(struct t_board *board)
-{
-
-
-}
-
-int book_move_count(struct t_board *board) {
-
-
-}
-
-void fill_opening_move_list(struct t_board *board, struct t_move_list *move_list) {
-
-
-}
+#if defined(_WIN32)
 
-#else
+static HANDLE book_file = INVALID_HANDLE_VALUE;
+static HANDLE book_mapping = NULL;
 
-void close_book()
+//-- The folder containing the engine (with a trailing "\")
+static void book_directory(char *path)
 {
-    if (uci.opening_book.f != NULL)
-        fclose(uci.opening_book.f);
+    GetModuleFileName(0, path, 2048);
+    PathRemoveFileSpec(path);
+    PathAddBackslash(path);
 }
 
-void set_own_book(BOOL value)
+static void unmap_book()
 {
-    uci.opening_book.use_own_book = value;
+    if (uci.opening_book.data != NULL)
+        UnmapViewOfFile(uci.opening_book.data);
+    if (book_mapping != NULL)
+        CloseHandle(book_mapping);
+    if (book_file != INVALID_HANDLE_VALUE)
+        CloseHandle(book_file);
+
+    uci.opening_book.data = NULL;
+    uci.opening_book.book_size = 0;
+    book_mapping = NULL;
+    book_file = INVALID_HANDLE_VALUE;
 }
 
-void set_opening_book(char *book)
+static BOOL map_book(char *filename)
 {
-    TCHAR file_path[2048] = { 0 };
-    TCHAR file_to_open[2048] = { 0 };
-
-    GetModuleFileName(0, file_path, 2048);
-    PathRemoveFileSpec(file_path);
-    PathAddBackslash(file_path);
-    strcpy(file_to_open, file_path);
+    LARGE_INTEGER size;
 
-    strncpy(uci.opening_book.filename, book, sizeof uci.opening_book.filename);
-    char *discarded_token = strtok(uci.opening_book.filename, "\n");
+    book_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (book_file == INVALID_HANDLE_VALUE)
+        return FALSE;
 
-    if (uci.opening_book.f != NULL) {
-        fclose(uci.opening_book.f);
+    if (!GetFileSizeEx(book_file, &size) || size.QuadPart < 16) {
+        unmap_book();
+        return FALSE;
     }
 
-    strcat(file_to_open, uci.opening_book.filename);
+    book_mapping = CreateFileMapping(book_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (book_mapping != NULL)
+        uci.opening_book.data = (unsigned char *)MapViewOfFile(book_mapping, FILE_MAP_READ, 0, 0, 0);
 
-    uci.opening_book.f = fopen(file_to_open, "rb");
-    fseek(uci.opening_book.f, -16, SEEK_END);
-    uci.opening_book.book_size = ftell(uci.opening_book.f) / 16;
+    if (uci.opening_book.data == NULL) {
+        unmap_book();
+        return FALSE;
+    }
 
+    uci.opening_book.book_size = (int)(size.QuadPart / 16);
+    return TRUE;
 }
 
 int book_count()
@@ -132,9 +104,7 @@ int book_count()
 
     TCHAR file_path[2048] = { 0 };
 
-    GetModuleFileName(0, file_path, 2048);
-    PathRemoveFileSpec(file_path);
-    PathAddBackslash(file_path);
+    book_directory(file_path);
 
     CHAR szSearch[2048] = { 0 };
 
@@ -165,9 +135,7 @@ char *book_string()
 
     TCHAR file_path[2048] = { 0 };
 
-    GetModuleFileName(0, file_path, 2048);
-    PathRemoveFileSpec(file_path);
-    PathAddBackslash(file_path);
+    book_directory(file_path);
 
     CHAR szSearch[2048] = { 0 };
 
@@ -190,7 +158,7 @@ char *book_string()
         size.LowPart = FindFileData.nFileSizeLow;
 
         if (size.QuadPart > biggest.QuadPart) {
-            biggest.QuadPart = FindFileData.nFileSizeHigh;
+            biggest.QuadPart = size.QuadPart;
             strcpy(d, FindFileData.cFileName);
         }
 
@@ -201,7 +169,7 @@ char *book_string()
     biggest.QuadPart = 0;
 
     strcpy(szSearch, file_path);
-    strcpy(szSearch, "Maverick*.bin");
+    strcat(szSearch, "Maverick*.bin");
     hFind = FindFirstFileA(szSearch, &FindFileData);
     if (hFind != INVALID_HANDLE_VALUE) {
         do {
@@ -209,7 +177,7 @@ char *book_string()
             size.LowPart = FindFileData.nFileSizeLow;
 
             if (size.QuadPart > biggest.QuadPart) {
-                biggest.QuadPart = FindFileData.nFileSizeHigh;
+                biggest.QuadPart = size.QuadPart;
                 strcpy(d, FindFileData.cFileName);
             }
 
@@ -221,42 +189,214 @@ char *book_string()
     strcat(b, d);
     strcat(b, s);
 
-    strcpy(uci.opening_book.filename, d);
-    uci.opening_book.f = fopen(uci.opening_book.filename, "rb");
-    fseek(uci.opening_book.f, -16, SEEK_END);
-    uci.opening_book.book_size = ftell(uci.opening_book.f) / 16;
+    set_opening_book(d);
+
+    return b;
+
+}
+
+#else
+
+//-- The folder containing the engine (with a trailing "/")
+static void book_directory(char *path)
+{
+    char exe[FILENAME_MAX] = { 0 };
+    char *p;
+
+#if defined(__linux__)
+    ssize_t n = readlink("/proc/self/exe", exe, FILENAME_MAX - 1);
+    if (n > 0)
+        exe[n] = '\0';
+    else
+        snprintf(exe, sizeof(exe), "%s", engine_path);
+#elif defined(__APPLE__) && defined(__MACH__)
+    uint32_t size = FILENAME_MAX;
+    if (_NSGetExecutablePath(exe, &size) != 0)
+        snprintf(exe, sizeof(exe), "%s", engine_path);
+#else
+    snprintf(exe, sizeof(exe), "%s", engine_path);
+#endif
+
+    if ((p = strrchr(exe, '/')) != NULL) {
+        p[1] = '\0';
+        strcpy(path, exe);
+    }
+    else
+        strcpy(path, "./");
+}
+
+static void unmap_book()
+{
+    if (uci.opening_book.data != NULL)
+        munmap((void *)uci.opening_book.data, (size_t)uci.opening_book.book_size * 16);
+
+    uci.opening_book.data = NULL;
+    uci.opening_book.book_size = 0;
+}
+
+static BOOL map_book(char *filename)
+{
+    struct stat info;
+    void *p;
+    int fd;
+
+    if ((fd = open(filename, O_RDONLY)) < 0)
+        return FALSE;
+
+    if (fstat(fd, &info) != 0 || info.st_size < 16) {
+        close(fd);
+        return FALSE;
+    }
+
+    //-- Shared and read only, so every engine on the machine uses the same pages
+    p = mmap(NULL, (size_t)(info.st_size / 16) * 16, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return FALSE;
+
+    madvise(p, (size_t)(info.st_size / 16) * 16, MADV_RANDOM);
+
+    uci.opening_book.data = (unsigned char *)p;
+    uci.opening_book.book_size = (int)(info.st_size / 16);
+    return TRUE;
+}
+
+static BOOL is_book_file(char *name)
+{
+    size_t n = strlen(name);
+    return n > 4 && !strcmp(name + n - 4, ".bin");
+}
+
+int book_count()
+{
+    char path[FILENAME_MAX];
+    struct dirent *entry;
+    DIR *dir;
+    int count = 0;
+
+    book_directory(path);
+    if ((dir = opendir(path)) == NULL)
+        return 0;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (is_book_file(entry->d_name))
+            count++;
+    }
+    closedir(dir);
+
+    return count;
+}
+
+char *book_string()
+{
+    static char s[1024];
+    static char d[FILENAME_MAX];
+    static char b[2048];
+
+    char path[FILENAME_MAX];
+    char filename[2 * FILENAME_MAX];
+    struct dirent *entry;
+    struct stat info;
+    DIR *dir;
+    off_t biggest = -1;
+    BOOL maverick = FALSE;
+    BOOL is_maverick;
+
+    s[0] = '\0';
+    d[0] = '\0';
+
+    book_directory(path);
+    if ((dir = opendir(path)) == NULL)
+        return s;
+
+    //-- List all of the books, picking the biggest (...and giving preference to Maverick's own books)
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_book_file(entry->d_name))
+            continue;
+
+        if (strlen(s) + strlen(entry->d_name) + 6 < sizeof(s)) {
+            strcat(s, " var ");
+            strcat(s, entry->d_name);
+        }
+
+        sprintf(filename, "%s%s", path, entry->d_name);
+        if (stat(filename, &info) != 0)
+            continue;
+
+        is_maverick = !strncmp(entry->d_name, "Maverick", 8);
+        if ((is_maverick && !maverick) || (is_maverick == maverick && info.st_size > biggest)) {
+            biggest = info.st_size;
+            maverick = is_maverick;
+            strcpy(d, entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    strcpy(b, "option name Opening Book type combo default ");
+    strcat(b, d);
+    strcat(b, s);
+
+    set_opening_book(d);
 
     return b;
+}
+
+#endif
+
+void close_book()
+{
+    unmap_book();
+}
+
+void set_own_book(BOOL value)
+{
+    uci.opening_book.use_own_book = value;
+}
+
+void set_opening_book(char *book)
+{
+    char file_to_open[2048 + FILENAME_MAX] = { 0 };
+
+    strncpy(uci.opening_book.filename, book, sizeof uci.opening_book.filename - 1);
+    strtok(uci.opening_book.filename, "\n");
+
+    unmap_book();
+
+    //-- A book name is looked for next to the engine, a path is used as it is
+    if (strchr(uci.opening_book.filename, '/') == NULL && strchr(uci.opening_book.filename, '\\') == NULL)
+        book_directory(file_to_open);
+    strcat(file_to_open, uci.opening_book.filename);
 
+    if (!map_book(file_to_open)) {
+        static char s[2048 + FILENAME_MAX + 64];
+        sprintf(s, "Unable to open the opening book %s", file_to_open);
+        send_info(s);
+    }
 }
 
-unsigned long long read_integer(FILE *file, int size)
+unsigned long long read_integer(const unsigned char *p, int size)
 {
 
     unsigned long long n;
     int i;
-    int b;
 
     n = 0;
 
     for (i = 0; i < size; i++)
-    {
-        b = fgetc(file);
-        n = (n << 8) | b;
-    }
+        n = (n << 8) | p[i];
 
     return n;
 }
 
 void read_book_move(int index, struct t_book_move *book_move)
 {
-    fseek(uci.opening_book.f, index * 16, SEEK_SET);
+    const unsigned char *p = uci.opening_book.data + (size_t)index * 16;
 
-    book_move->key = read_integer(uci.opening_book.f, 8);
-    book_move->move = read_integer(uci.opening_book.f, 2);
-    book_move->weight = read_integer(uci.opening_book.f, 2);
-    book_move->n = read_integer(uci.opening_book.f, 2);
-    book_move->learn = read_integer(uci.opening_book.f, 2);
+    book_move->key = read_integer(p, 8);
+    book_move->move = (int)read_integer(p + 8, 2);
+    book_move->weight = (int)read_integer(p + 10, 2);
+    book_move->n = (int)read_integer(p + 12, 2);
+    book_move->learn = (int)read_integer(p + 14, 2);
 }
 
 struct t_move_record *decode_move(struct t_board *board, unsigned int move)
@@ -283,22 +423,12 @@ struct t_move_record *decode_move(struct t_board *board, unsigned int move)
         return move_directory[from_square][to_square][piece] + captured;
 }
 
-t_move_record *probe_book(struct t_board *board)
+//-- Index of the first entry for the key (or -1 if it's not in the book)
+static int book_first_entry(t_hash key)
 {
-    //-- The Key we're looking for!
-    t_hash key = board->hash;
-
-    //-- Used to get the data from the file
+    //-- Used to get the data from the book
     struct t_book_move		book_move[1];
 
-    //-- Not open?
-    if (uci.opening_book.f == NULL)
-        return NULL;
-
-    //-- List of possible moves
-    struct t_move_list	moves[1];
-    moves->count = 0;
-
     //-- First entry
     int first = 0;
 
@@ -320,11 +450,37 @@ t_move_record *probe_book(struct t_board *board)
     }
 
     assert(first == last);
+    if (first >= uci.opening_book.book_size)
+        return -1;
+
     read_book_move(first, book_move);
+    if (book_move->key != key)
+        return -1;
+
+    return first;
+}
+
+t_move_record *probe_book(struct t_board *board)
+{
+    //-- The Key we're looking for!
+    t_hash key = board->hash;
+
+    //-- Used to get the data from the book
+    struct t_book_move		book_move[1];
+
+    //-- Not open?
+    if (uci.opening_book.data == NULL)
+        return NULL;
+
+    //-- List of possible moves
+    struct t_move_list	moves[1];
+    moves->count = 0;
 
     //-- return NULL value if we cannot find the move
-    if (book_move->key != key)
+    int first = book_first_entry(key);
+    if (first < 0)
         return NULL;
+    read_book_move(first, book_move);
 
     //-- local storage
     struct t_move_record *move;
@@ -365,9 +521,13 @@ t_move_record *probe_book(struct t_board *board)
     } while (book_move->key == key && first + i < uci.opening_book.book_size);
     moves->count = i;
 
-	//-- Normalize the scores
-	for (i = 0; i < moves->count; i++)
-		moves->value[i] = moves->value[i] * RAND_MAX / sum;
+    //-- No move with any weight
+    if (sum == 0)
+        return NULL;
+
+    //-- Normalize the scores
+    for (i = 0; i < moves->count; i++)
+        moves->value[i] = moves->value[i] * RAND_MAX / sum;
 
     //-- Generate random move
     int random = rand();
@@ -389,39 +549,18 @@ int book_move_count(struct t_board *board) {
     //-- The Key we're looking for!
     t_hash key = board->hash;
 
-    //-- Used to get the data from the file
+    //-- Used to get the data from the book
     struct t_book_move		book_move[1];
 
     //-- Not open?
-    if (uci.opening_book.f == NULL)
+    if (uci.opening_book.data == NULL)
         return 0;
 
-    //-- First entry
-    int first = 0;
-
-    //-- Last entry
-    int last = uci.opening_book.book_size;
-
-    //-- Binary search (which cleverly finds the lowest entry with the same key)
-    while (first < last) {
-
-        int middle = (first + last) / 2;
-        read_book_move(middle, book_move);
-
-        if (key <= book_move->key) {
-            last = middle;
-        }
-        else {
-            first = middle + 1;
-        }
-    }
-
-    assert(first == last);
-    read_book_move(first, book_move);
-
     //-- return 0 value if we cannot find the move
-    if (book_move->key != key)
+    int first = book_first_entry(key);
+    if (first < 0)
         return 0;
+    read_book_move(first, book_move);
 
     //-- Count all suitable moves to the list
     int i = 0;
@@ -440,43 +579,22 @@ void fill_opening_move_list(struct t_board *board, struct t_move_list *move_list
     //-- The Key we're looking for!
     t_hash key = board->hash;
 
-    //-- Used to get the data from the file
+    //-- Used to get the data from the book
     struct t_book_move		book_move[1];
 
     //-- Not open?
-    if (uci.opening_book.f == NULL)
+    if (uci.opening_book.data == NULL)
         return;
 
     //-- List of possible moves
     struct t_move_list	moves[1];
     moves->count = 0;
 
-    //-- First entry
-    int first = 0;
-
-    //-- Last entry
-    int last = uci.opening_book.book_size;
-
-    //-- Binary search (which cleverly finds the lowest entry with the same key)
-    while (first < last) {
-
-        int middle = (first + last) / 2;
-        read_book_move(middle, book_move);
-
-        if (key <= book_move->key) {
-            last = middle;
-        }
-        else {
-            first = middle + 1;
-        }
-    }
-
-    assert(first == last);
-    read_book_move(first, book_move);
-
     //-- return NULL value if we cannot find the move
-    if (book_move->key != key)
+    int first = book_first_entry(key);
+    if (first < 0)
         return;
+    read_book_move(first, book_move);
 
     //-- local storage
     struct t_move_record *move;
@@ -495,8 +613,10 @@ void fill_opening_move_list(struct t_board *board, struct t_move_list *move_list
     } while (book_move->key == key && first + i < uci.opening_book.book_size);
     moves->count = i;
 
-
     move_list->count = 0;
+    if (sum == 0)
+        return;
+
     int n = 0;
     do {
 
@@ -520,5 +640,3 @@ void fill_opening_move_list(struct t_board *board, struct t_move_list *move_list
     } while (move_list->count * 4 < moves->count * 3 && n < moves->count * 5);
 
 }
-
-#endif
\ No newline at end of file
@@ -0,0 +1,214 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Output Queue
+//
+// Everything sent to the GUI (and the debug log) goes through
+// a ring buffer which is drained by a writer thread, so the
+// search only ever copies a preformatted line.  Each entry is
+// a type character, the text and a "\n".
+//===========================================================//
+
+#define OUTPUT_STDOUT						'S'
+#define OUTPUT_STDOUT_AND_LOG				'B'
+#define OUTPUT_LOG_SENT						'L'
+#define OUTPUT_LOG_RECEIVED					'R'
+
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+static size_t output_head;
+static size_t output_tail;
+
+static t_mutex output_mutex;
+static t_condition output_condition;
+static t_thread output_thread;
+static BOOL output_running;
+static BOOL output_quit;
+
+static FILE *log_file;
+
+static void write_log_line(char type, char *s, size_t length)
+{
+    if (log_file == NULL && (log_file = fopen(LOG_FILENAME, "a")) == NULL)
+        return;
+
+    fputs((type == OUTPUT_LOG_RECEIVED) ? "Received >> " : "Sent     >> ", log_file);
+    fwrite(s, 1, length, log_file);
+    fputc('\n', log_file);
+}
+
+//-- Write a batch of entries (called without the lock held)
+static void write_output(char *s, size_t length)
+{
+    static char out[OUTPUT_BUFFER_SIZE];
+    size_t i, j, n = 0;
+    BOOL logged = FALSE;
+
+    for (i = 0; i < length; i = j + 1) {
+        for (j = i + 1; j < length && s[j] != '\n'; j++);
+
+        if (s[i] == OUTPUT_STDOUT || s[i] == OUTPUT_STDOUT_AND_LOG) {
+            memcpy(out + n, s + i + 1, j - i);
+            n += j - i;
+        }
+        if (s[i] != OUTPUT_STDOUT) {
+            write_log_line(s[i], s + i + 1, j - i - 1);
+            logged = TRUE;
+        }
+    }
+
+    //-- One write for the whole batch
+    if (n > 0) {
+        fwrite(out, 1, n, stdout);
+        fflush(stdout);
+    }
+    if (logged && log_file != NULL)
+        fflush(log_file);
+}
+
+static unsigned __stdcall output_loop(void* pArguments)
+{
+    static char s[OUTPUT_BUFFER_SIZE];
+    size_t n, start;
+
+    mutex_lock(&output_mutex);
+    while (TRUE) {
+
+        while (output_head == output_tail && !output_quit)
+            condition_wait(&output_condition, &output_mutex);
+
+        if (output_head == output_tail)
+            break;
+
+        //-- Take everything queued so far
+        n = output_head - output_tail;
+        start = output_tail & (OUTPUT_BUFFER_SIZE - 1);
+        if (start + n <= OUTPUT_BUFFER_SIZE)
+            memcpy(s, output_buffer + start, n);
+        else {
+            memcpy(s, output_buffer + start, OUTPUT_BUFFER_SIZE - start);
+            memcpy(s + OUTPUT_BUFFER_SIZE - start, output_buffer, n - (OUTPUT_BUFFER_SIZE - start));
+        }
+        mutex_unlock(&output_mutex);
+
+        write_output(s, n);
+
+        //-- Only free the space once it's written, so flush_output() knows it's gone
+        mutex_lock(&output_mutex);
+        output_tail += n;
+        condition_broadcast(&output_condition);
+    }
+    mutex_unlock(&output_mutex);
+
+    return(0);
+}
+
+static void queue_output(char type, char *s)
+{
+    size_t length = strlen(s);
+    size_t n, i;
+
+    if (length > UCI_BUFFER_SIZE)
+        length = UCI_BUFFER_SIZE;
+    n = length + 2;
+
+    //-- No writer thread (yet, or any more) so write it straight away
+    if (!output_running) {
+        char t[UCI_BUFFER_SIZE + 2];
+        t[0] = type;
+        memcpy(t + 1, s, length);
+        t[length + 1] = '\n';
+        write_output(t, n);
+        return;
+    }
+
+    mutex_lock(&output_mutex);
+
+    //-- Wait for room (the GUI isn't reading fast enough)
+    while (OUTPUT_BUFFER_SIZE - (output_head - output_tail) < n)
+        condition_wait(&output_condition, &output_mutex);
+
+    output_buffer[output_head++ & (OUTPUT_BUFFER_SIZE - 1)] = type;
+    for (i = 0; i < length; i++)
+        output_buffer[output_head++ & (OUTPUT_BUFFER_SIZE - 1)] = s[i];
+    output_buffer[output_head++ & (OUTPUT_BUFFER_SIZE - 1)] = '\n';
+
+    condition_broadcast(&output_condition);
+    mutex_unlock(&output_mutex);
+}
+
+void init_output()
+{
+    mutex_init(&output_mutex);
+    condition_init(&output_condition);
+
+    output_head = 0;
+    output_tail = 0;
+    output_quit = FALSE;
+    output_running = TRUE;
+    thread_create(&output_thread, output_loop, NULL);
+}
+
+void send_command(char *t)
+{
+    size_t i = strlen(t);
+    if (i > 0)
+    {
+        if (t[i-1] == '\n')
+            t[i-1] = '\0';
+        queue_output(uci.debug ? OUTPUT_STDOUT_AND_LOG : OUTPUT_STDOUT, t);
+    }
+}
+
+void write_log(char *s, BOOL send)
+{
+    queue_output(send ? OUTPUT_LOG_SENT : OUTPUT_LOG_RECEIVED, s);
+}
+
+//-- Wait until everything queued has been written
+void flush_output()
+{
+    if (!output_running)
+        return;
+
+    mutex_lock(&output_mutex);
+    while (output_head != output_tail)
+        condition_wait(&output_condition, &output_mutex);
+    mutex_unlock(&output_mutex);
+}
+
+void destroy_output()
+{
+    if (output_running) {
+        mutex_lock(&output_mutex);
+        output_quit = TRUE;
+        condition_broadcast(&output_condition);
+        mutex_unlock(&output_mutex);
+
+        thread_join(output_thread);
+        output_running = FALSE;
+    }
+
+    if (log_file != NULL) {
+        fclose(log_file);
+        log_file = NULL;
+    }
+}
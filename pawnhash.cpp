@@ -16,6 +16,7 @@
 #include "data.h"
 #include "procs.h"
 #include "bittwiddle.h"
+#include "profile.h"
 
 #ifndef min
 #define max(a,b) (((a) > (b)) ? (a) : (b))
@@ -24,6 +25,8 @@
 
 struct t_pawn_hash_record *lookup_pawn_hash(struct t_board *board, struct t_chess_eval *eval)
 {
+    PROFILE(profile_pawn_hash);
+
     t_chess_color color;
 
     // Look-up in pawn hash table
@@ -130,7 +133,7 @@ struct t_pawn_hash_record *lookup_pawn_hash(struct t_board *board, struct t_ches
         pawn_record->backward[color] = b;
         pawn_record->weak[color] = b;
 
-        int penalty = popcount(b) * MG_BACKWARD_PAWN * (1 - color * 2);
+        int penalty = popcount(b) * backward_pawn * (1 - color * 2);
 
         middlegame += penalty;
         endgame += penalty;
@@ -275,15 +278,18 @@ void init_pawn_hash()
 
 void destroy_pawn_hash()
 {
-    if (uci.engine_initialized)
+    if (uci.engine_initialized) {
         free(pawn_hash);
+        pawn_hash = NULL;
+    }
 }
 
 void set_pawn_hash(unsigned int size)
 {
     t_hash i;
 
-    if (uci.options.pawn_hash_table_size == size) return;
+    //-- Each thread has its own table (allocated the first time round)
+    if (uci.options.pawn_hash_table_size == size && pawn_hash != NULL) return;
 
     i = 1;
     while ((i << 1) * sizeof(struct t_pawn_hash_record) <= size * 1024 * 1024)
@@ -293,33 +299,19 @@ void set_pawn_hash(unsigned int size)
     pawn_hash = (struct t_pawn_hash_record*)malloc(i * sizeof(struct t_pawn_hash_record));
     assert(pawn_hash);
     pawn_hash_mask = i - 1;
-    for (i = 0; i <= pawn_hash_mask; i++) {
-        pawn_hash[i].key = 0;
-        pawn_hash[i].endgame = 0;
-        pawn_hash[i].middlegame = 0;
-        pawn_hash[i].open_file = 0;
-        for (t_chess_color c = WHITE; c <= BLACK; c++) {
-            pawn_hash[i].backward[c] = 0;
-            pawn_hash[i].blocked[c] = 0;
-            pawn_hash[i].forward_squares[c] = 0;
-            pawn_hash[i].backward_squares[c] = 0;
-            pawn_hash[i].isolated[c] = 0;
-            pawn_hash[i].passed[c] = 0;
-			pawn_hash[i].unstopable[c] = 0;
-            pawn_hash[i].candidate_passed[c] = 0;
-            pawn_hash[i].potential_outpost[c] = 0;
-            pawn_hash[i].double_pawns[c] = 0;
-            pawn_hash[i].semi_open_double_pawns[c] = 0;
-            pawn_hash[i].attacks[c] = 0;
-            pawn_hash[i].weak[c] = 0;
-            pawn_hash[i].semi_open_file[c] = 0;
-            pawn_hash[i].pawn_count[c] = 0;
-            pawn_hash[i].king_pressure[c] = 0;
-        }
-    }
+    clear_pawn_hash();
     uci.options.pawn_hash_table_size = size;
 }
 
+//-- Empties this thread's table, which also brings it up to date with the evaluation parameters
+void clear_pawn_hash()
+{
+    if (pawn_hash == NULL)
+        return;
+    memset(pawn_hash, 0, (size_t)(pawn_hash_mask + 1) * sizeof(struct t_pawn_hash_record));
+    pawn_hash_version = eval_params_version;
+}
+
 t_hash calc_pawn_hash(struct t_board *board) {
 
     t_hash zobrist = 0;
@@ -408,18 +400,18 @@ void eval_pawn_shelter(struct t_board *board, struct t_pawn_hash_record *pawn_re
 
                 //-- Bonus if pawn shield is in tact
                 if ((board->pieces[color][PAWN] & intact_pawns[color][castle_side]) == intact_pawns[color][castle_side]) {
-                    middlegame += MG_INTACT_PAWN_SHIELD;
+                    middlegame += intact_pawn_shield;
                 }
 
                 //-- Panalty if there isn't a decent pawn shield
                 else if (!(board->pieces[color][PAWN] & wrecked_pawns[color][castle_side])) {
-                    middlegame += MG_PAWN_SHIELD_WRECKED;
+                    middlegame += pawn_shield_wrecked;
                     pawn_record->king_pressure[color] += 50;
                 }
 
                 //-- See if opponent has a F6 wedge
                 if (board->pieces[opponent][PAWN] & pawn_wedge_mask[opponent][castle_side]) {
-                    middlegame -= MG_F6_PAWN_WEDGE;
+                    middlegame -= f6_pawn_wedge;
                     pawn_record->king_pressure[color] += 50;
                 }
             }
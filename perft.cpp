@@ -6,6 +6,7 @@
 //===========================================================//
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
@@ -15,10 +16,87 @@
 #include "procs.h"
 #include "bittwiddle.h"
 
+//===========================================================//
+// Perft Cache
+//
+// Subtree counts keyed by the hash and the remaining depth.
+// It's separate from the search hash table and is only used
+// when a size has been set (e.g. "perft 7 hash 256").
+//===========================================================//
+
+static struct t_perft_cache_record *perft_cache = NULL;
+static size_t perft_cache_size = 0;
+static size_t perft_cache_mask;
+
+void set_perft_cache(unsigned int size)
+{
+    size_t i;
+
+    if (perft_cache != NULL)
+        numa_free(perft_cache, perft_cache_size * sizeof(struct t_perft_cache_record));
+    perft_cache = NULL;
+    perft_cache_size = 0;
+
+    if (size == 0)
+        return;
+
+    i = PERFT_CACHE_BUCKET;
+    while (i * 2 * sizeof(struct t_perft_cache_record) <= (size_t)size * 1024 * 1024)
+        i <<= 1;
+
+    perft_cache = (struct t_perft_cache_record *)numa_alloc(i * sizeof(struct t_perft_cache_record));
+    if (perft_cache == NULL)
+        return;
+    perft_cache_size = i;
+    perft_cache_mask = i - PERFT_CACHE_BUCKET;
+    clear_perft_cache();
+}
+
+void clear_perft_cache()
+{
+    if (perft_cache != NULL)
+        memset(perft_cache, 0, perft_cache_size * sizeof(struct t_perft_cache_record));
+}
+
+//-- Each depth gets its own slot for the same position
+static inline struct t_perft_cache_record *perft_cache_bucket(t_hash hash, int depth)
+{
+    return &perft_cache[(hash ^ ((t_hash)depth * 0x9E3779B97F4A7C15ULL)) & perft_cache_mask];
+}
+
+static BOOL perft_cache_probe(t_hash hash, int depth, t_nodes *nodes)
+{
+    struct t_perft_cache_record *record = perft_cache_bucket(hash, depth);
+    t_hash data;
+    int i;
+
+    for (i = 0; i < PERFT_CACHE_BUCKET; i++, record++) {
+        data = record->data;
+        if ((record->check ^ data) == hash && (int)(data & 255) == depth) {
+            *nodes = data >> 8;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//-- The first slot keeps the bigger subtree, the second is always replaced
+static void perft_cache_store(t_hash hash, int depth, t_nodes nodes)
+{
+    struct t_perft_cache_record *record = perft_cache_bucket(hash, depth);
+    t_hash data = (nodes << 8) | (t_hash)depth;
+
+    if ((record->data >> 8) > nodes)
+        record++;
+    record->data = data;
+    record->check = hash ^ data;
+}
+
 t_nodes perft(struct t_board *board, int depth) {
 
     struct t_move_list move_list[1];
     struct t_undo undo[1];
+    char s[256];
 
     t_nodes total_nodes = 0;
     t_nodes move_nodes = 0;
@@ -27,6 +105,8 @@ t_nodes perft(struct t_board *board, int depth) {
 
     int i;
 
+    clear_perft_cache();
+
     if (board->in_check)
         generate_evade_check(board, move_list);
     else
@@ -37,8 +117,8 @@ t_nodes perft(struct t_board *board, int depth) {
             move_nodes = 0;
             if (depth > 1)
                 move_nodes += do_perft(board, depth - 1);
-            printf(move_as_str(move_list->move[i]));
-            printf(" = %llu\n", move_nodes);
+            sprintf(s, "%s = %llu", move_as_str(move_list->move[i]), (unsigned long long) move_nodes);
+            send_command(s);
             unmake_move(board, undo);
             total_nodes += move_nodes;
         }
@@ -47,9 +127,10 @@ t_nodes perft(struct t_board *board, int depth) {
     unsigned long finish = time_now();
 
     if (finish == start)
-        printf(INFO_STRING_PERFT_NODES, total_nodes);
+        sprintf(s, INFO_STRING_PERFT_NODES, total_nodes);
     else
-        printf(INFO_STRING_PERFT_SPEED, (unsigned long long) total_nodes, (int) finish - start, 1000 * total_nodes / (finish - start));
+        sprintf(s, INFO_STRING_PERFT_SPEED, (unsigned long long) total_nodes, (int) (finish - start), 1000 * total_nodes / (finish - start));
+    send_command(s);
 
     return total_nodes;
 }
@@ -66,6 +147,9 @@ t_nodes do_perft(struct t_board *board, int depth)
     int i;
 
     assert(integrity(board));
+    if (perft_cache != NULL && depth > 1 && perft_cache_probe(board->hash, depth, &nodes))
+        return nodes;
+
     if (board->in_check) {
         generate_evade_check(board, move_list);
         if (depth == 1) return move_list->count;
@@ -100,7 +184,160 @@ t_nodes do_perft(struct t_board *board, int depth)
             assert(integrity(board));
     }
 
+    if (perft_cache != NULL && depth > 1)
+        perft_cache_store(board->hash, depth, nodes);
+
     return nodes;
 
 }
 
+
+//===========================================================//
+// Parallel Perft
+//
+// The moves at the root (or the root move / reply pairs when
+// the depth is three or more, which balances the load far
+// better) are shared out between the threads.  Each thread
+// plays its moves on its own copy of the board.
+//===========================================================//
+
+static struct t_board *perft_board;
+static int perft_depth;
+static struct t_perft_work *perft_work;
+static int perft_work_count;
+static std::atomic<int> perft_next_work;
+
+static unsigned __stdcall perft_worker(void* pArguments)
+{
+    struct t_board *board = (struct t_board *)malloc(sizeof(struct t_board));
+    struct t_undo undo[2];
+    struct t_perft_work *work;
+    int i;
+
+    init_board(board);
+    copy_board(board, perft_board);
+
+    while ((i = perft_next_work++) < perft_work_count) {
+        work = &perft_work[i];
+
+        make_move(board, work->pinned, work->move, &undo[0]);
+        if (work->reply == NULL)
+            work->nodes = (perft_depth > 1) ? do_perft(board, perft_depth - 1) : 1;
+        else {
+            make_move(board, work->reply_pinned, work->reply, &undo[1]);
+            work->nodes = (perft_depth > 2) ? do_perft(board, perft_depth - 2) : 1;
+            unmake_move(board, &undo[1]);
+        }
+        unmake_move(board, &undo[0]);
+    }
+
+    free(board);
+    return(0);
+}
+
+t_nodes parallel_perft(struct t_board *board, int depth, int threads, BOOL divide) {
+
+    struct t_move_list move_list[1];
+    struct t_move_list reply_list[1];
+    struct t_undo undo[2];
+    struct t_move_record *root_move[256];
+    t_nodes root_nodes[256];
+    t_thread thread[NUMA_MAX_CPUS];
+    char s[256];
+
+    t_nodes total_nodes = 0;
+    int root_count = 0;
+    int i, j;
+
+    //-- perft() always prints the divide, so a quiet single thread still goes through the work list
+    threads = max(1, min(threads, NUMA_MAX_CPUS));
+    if ((threads == 1 && divide) || depth < 1)
+        return perft(board, depth);
+
+    unsigned long start = time_now();
+
+    perft_work = (struct t_perft_work *)malloc(PERFT_MAX_WORK * sizeof(struct t_perft_work));
+    if (perft_work == NULL)
+        return perft(board, depth);
+    perft_work_count = 0;
+    clear_perft_cache();
+
+    //-- Build the list of work (in the same order as perft)
+    if (board->in_check)
+        generate_evade_check(board, move_list);
+    else
+        generate_moves(board, move_list);
+
+    for (i = move_list->count - 1; i >= 0; i--) {
+        if (make_move(board, move_list->pinned_pieces, move_list->move[i], &undo[0])) {
+            root_move[root_count] = move_list->move[i];
+            root_nodes[root_count] = 0;
+
+            reply_list->count = 0;
+            if (depth >= 3) {
+                if (board->in_check)
+                    generate_evade_check(board, reply_list);
+                else
+                    generate_moves(board, reply_list);
+            }
+
+            //-- Split on the replies while there's still room for the rest of the root moves
+            if (depth < 3 || perft_work_count + reply_list->count + i > PERFT_MAX_WORK) {
+                perft_work[perft_work_count].root = root_count;
+                perft_work[perft_work_count].move = move_list->move[i];
+                perft_work[perft_work_count].pinned = move_list->pinned_pieces;
+                perft_work[perft_work_count].reply = NULL;
+                perft_work[perft_work_count++].nodes = 0;
+            }
+            else {
+                for (j = reply_list->count - 1; j >= 0; j--) {
+                    if (make_move(board, reply_list->pinned_pieces, reply_list->move[j], &undo[1])) {
+                        unmake_move(board, &undo[1]);
+                        perft_work[perft_work_count].root = root_count;
+                        perft_work[perft_work_count].move = move_list->move[i];
+                        perft_work[perft_work_count].pinned = move_list->pinned_pieces;
+                        perft_work[perft_work_count].reply = reply_list->move[j];
+                        perft_work[perft_work_count].reply_pinned = reply_list->pinned_pieces;
+                        perft_work[perft_work_count++].nodes = 0;
+                    }
+                }
+            }
+            unmake_move(board, &undo[0]);
+            root_count++;
+        }
+    }
+
+    //-- Share it out
+    perft_board = board;
+    perft_depth = depth;
+    perft_next_work = 0;
+
+    threads = min(threads, max(1, perft_work_count));
+    for (i = 0; i < threads; i++)
+        thread_create(&thread[i], perft_worker, NULL);
+    for (i = 0; i < threads; i++)
+        thread_join(thread[i]);
+
+    for (i = 0; i < perft_work_count; i++)
+        root_nodes[perft_work[i].root] += perft_work[i].nodes;
+    free(perft_work);
+
+    //-- Divide output
+    for (i = 0; i < root_count; i++) {
+        if (divide) {
+            sprintf(s, "%s = %llu", move_as_str(root_move[i]), (unsigned long long) root_nodes[i]);
+            send_command(s);
+        }
+        total_nodes += root_nodes[i];
+    }
+
+    unsigned long finish = time_now();
+
+    if (finish == start)
+        sprintf(s, INFO_STRING_PERFT_NODES, total_nodes);
+    else
+        sprintf(s, INFO_STRING_PERFT_SPEED, (unsigned long long) total_nodes, (int) (finish - start), 1000 * total_nodes / (finish - start));
+    send_command(s);
+
+    return total_nodes;
+}
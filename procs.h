@@ -9,10 +9,10 @@
 void create_uci_engine_thread();
 void listen_for_uci_input();
 unsigned __stdcall engine_loop(void* pArguments);
+unsigned __stdcall timer_loop(void* pArguments);
 void uci_set_author();
 void uci_set_mode();
 void uci_isready();
-void send_command(char *t);
 BOOL is_search_complete(struct t_board *board, int score, int ply, struct t_move_list *move_list);
 void uci_go(char *s);
 void set_uci_level(char *s, t_chess_color color);
@@ -29,23 +29,49 @@ void do_uci_depth();
 void do_uci_fail_high(struct t_board *board, int score, int depth);
 void do_uci_fail_low(struct t_board *board, int score, int depth);
 void uci_ponderhit();
-void uci_check_status(struct t_board *board, int ply);
 void uci_setoption(char *s);
 void uci_current_line(struct t_board *board);
 void do_uci_show_stats();
-void send_info(char *s);
+void send_info(const char *s);
 void uci_new_game(struct t_board *board);
 void uci_set_predicted_hash(struct t_board *board);
 void init_engine(struct t_board *board);
 void uci_send_state(char *c);
 void uci_set_debug(char *s);
+void uci_set_perft_cache(char *s);
+void uci_perft(char *s);
+void uci_set_engine_state(t_uci_engine_state state);
+void uci_wait_for_search();
+void uci_wait_for_stop();
+void uci_quit();
+
+// output.cpp
+void init_output();
+void send_command(char *t);
+void write_log(char *s, BOOL send);
+void flush_output();
+void destroy_output();
+
+// threads.cpp
+void mutex_init(t_mutex *mutex);
+void mutex_lock(t_mutex *mutex);
+void mutex_unlock(t_mutex *mutex);
+void condition_init(t_condition *condition);
+void condition_wait(t_condition *condition, t_mutex *mutex);
+void condition_timed_wait(t_condition *condition, t_mutex *mutex, long milliseconds);
+void condition_broadcast(t_condition *condition);
+void thread_create(t_thread *thread, unsigned (__stdcall *function)(void *), void *argument);
+void thread_join(t_thread thread);
 
 // utils.c
 unsigned long time_now();
+unsigned long long time_now_ns();
 int index_of(char *substr, char *s);
+BOOL is_number(char *s);
 int number_index(int index, char *s);
 char *word_index(int index, char *s);
 int word_count(char *s);
+int split_words(char *s, char *word[], int max_words);
 t_hash rand64();
 void qsort_moves(struct t_move_list *move_list, int first, int last);
 char *leftstr(char *s, int index);
@@ -59,6 +85,7 @@ BOOL is_in_check(struct t_board *board, t_chess_color color);
 //BOOL is_in_check_after_move(struct t_board *board, struct t_move_record *move);
 BOOL is_square_attacked(struct t_board *board, t_chess_square square, t_chess_color color);
 void init_board(struct t_board *board);
+void copy_board(struct t_board *to, struct t_board *from);
 void add_piece(struct t_board *board, t_chess_piece piece, t_chess_square target_square);
 void clear_board(struct t_board *board);
 void new_game(struct t_board *board);
@@ -82,8 +109,9 @@ void clear_history();
 void init_960_castling(struct t_board *board, t_chess_square king_square, t_chess_square rook_square);
 
 // fen.c
-void set_fen(struct t_board *board, char *epd);
+void set_fen(struct t_board *board, const char *epd);
 char *get_fen(struct t_board *board);
+BOOL is_valid_fen(char *word[], int n);
 
 //--bitboard.c
 void init_bitboards();
@@ -103,6 +131,7 @@ void init_hash();
 void destroy_hash();
 void set_hash(unsigned int size);
 void poke(t_hash hash_key, t_chess_value score, int ply, int depth, t_hash_bound bound, struct t_move_record *move);
+void poke_record(t_hash hash_key, t_chess_value score, int depth, t_hash_bound bound, struct t_move_record *move);
 void poke_draw(t_hash hash_key);
 struct t_hash_record *probe(t_hash hash_key);
 void clear_hash();
@@ -112,6 +141,7 @@ t_chess_value get_hash_score(struct t_hash_record *hash_record, int ply);
 void set_pawn_hash(unsigned int size);
 void init_pawn_hash();
 void destroy_pawn_hash();
+void clear_pawn_hash();
 struct t_pawn_hash_record *lookup_pawn_hash(struct t_board *board, struct t_chess_eval *eval);
 t_hash calc_pawn_hash(struct t_board *board);
 void eval_pawn_shelter(struct t_board *board, struct t_pawn_hash_record *pawn_record);
@@ -123,6 +153,124 @@ void evaluate_king_pawn_endgame(struct t_board *board, struct t_pawn_hash_record
 BOOL see(struct t_board *board, struct t_move_record *move, t_chess_value threshold);
 BOOL see_safe(struct t_board *board, t_chess_square to_square, t_chess_value threshold);
 
+//-- Cluster Search (cluster.cpp)
+void cluster_set_workers(int n);
+void cluster_set_port(int port);
+void cluster_set_address(char *address);
+void cluster_set_position(char *s);
+void cluster_broadcast(char *s);
+void cluster_new_search(struct t_board *board);
+void cluster_search_root(struct t_board *board, struct t_move_list *move_list, int first, int depth, t_chess_value *best_score);
+void cluster_share_hash(t_hash hash_key, t_chess_value score, int depth, t_hash_bound bound, struct t_move_record *move);
+void cluster_worker(char *host, char *port);
+void cluster_shutdown();
+
+//-- NUMA (numa.cpp)
+void init_numa();
+int numa_bind_thread(int thread_index);
+void numa_init_thread(int thread_index);
+void numa_exit_thread();
+void *numa_alloc(size_t size);
+void numa_free(void *p, size_t size);
+void numa_set_hash_policy(t_numa_hash_policy policy);
+void numa_report();
+void destroy_numa();
+
+//-- Search Statistics (stats.cpp, only with USE_SEARCH_STATS)
+void clear_search_stats();
+void search_stats_iteration();
+t_move_stage search_stats_move_stage(struct t_pv_data *pv, struct t_move_list *moves, BOOL in_check);
+void report_search_stats();
+
+//-- Hot Path Profiler (profile.cpp, only with USE_PROFILER)
+void profile_search_start();
+void profile_search_end();
+void profile_bench_start();
+void profile_bench_end();
+void report_profile();
+
+//-- Search Trace (trace.cpp, the recorder only with USE_SEARCH_TRACE)
+void uci_trace(char *command);
+BOOL analyze_trace(char *command);
+unsigned short trace_move_code(struct t_move_record *move);
+unsigned short trace_string_code(const char *s);
+char *trace_code_string(unsigned short code);
+void trace_search_start();
+void trace_search_end();
+void trace_enter(struct t_trace_frame *frame, struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta);
+void trace_exit(struct t_trace_frame *frame, struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, t_chess_value score);
+void trace_prune(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, t_chess_value score, t_prune_reason reason, struct t_move_record *move);
+
+//-- Bench (bench.cpp)
+BOOL bench(char *command);
+
+//-- Micro-benchmarks (microbench.cpp)
+BOOL micro_bench(char *command);
+
+//-- Book Builder (bookbuilder.cpp)
+BOOL make_book(int argc, char *argv[]);
+struct t_move_record *parse_san(struct t_board *board, struct t_move_list *moves, char *token);
+char *move_as_san(struct t_board *board, struct t_move_list *moves, struct t_move_record *move, char *s);
+BOOL read_pgn_tag(const char *line, const char *name, char *value, size_t size);
+
+//-- Batch Evaluation (batch.cpp)
+BOOL batch_evaluate(char *command, BOOL allow_stdin);
+
+//-- Engine Processes (engine.cpp)
+BOOL engine_start(struct t_engine_process *e, const char *arguments[], BOOL read_output);
+void engine_stop(struct t_engine_process *e, BOOL quit);
+BOOL engine_send(struct t_engine_process *e, const char *s);
+BOOL engine_read(struct t_engine_process *e);
+BOOL engine_next_line(struct t_engine_process *e, char *line);
+BOOL engine_wait_line(struct t_engine_process *e, char *line);
+
+//-- EPD Test Suites (suite.cpp)
+BOOL run_test_suite(char *command);
+
+//-- Datagen (datagen.cpp)
+BOOL datagen(char *command);
+BOOL open_datagen_reader(struct t_datagen_reader *reader, char *filename);
+BOOL read_datagen_record(struct t_datagen_reader *reader, struct t_datagen_record *record);
+void close_datagen_reader(struct t_datagen_reader *reader);
+void datagen_record_fen(struct t_datagen_record *record, char *fen);
+void pack_position(struct t_board *board, struct t_datagen_record *record);
+void unpack_position(struct t_board *board, struct t_datagen_record *record);
+BOOL datagen_dump(char *command);
+
+//-- Evaluation Parameters (evalparams.cpp)
+struct t_eval_param *find_eval_param(char *name);
+void apply_eval_params();
+BOOL load_eval_params(char *filename);
+BOOL save_eval_params(char *filename);
+void uci_eval_params(char *command);
+
+//-- Texel Tuning (tune.cpp)
+BOOL tune_eval(char *command);
+
+//-- Search Parameters (searchparams.cpp)
+struct t_search_param *find_search_param(char *name);
+void set_search_param(struct t_search_param *p, int value);
+void uci_search_param_options();
+BOOL uci_set_search_param(char *command);
+void write_search_params(FILE *f);
+BOOL save_search_params(char *filename);
+BOOL load_search_params(char *filename);
+void uci_search_params(char *command);
+
+//-- PGN Annotation (annotate.cpp)
+BOOL annotate_pgn(char *command);
+
+//-- NNUE Evaluation (nnue.cpp)
+void init_nnue();
+void destroy_nnue();
+BOOL load_nnue(const char *filename);
+void set_nnue(BOOL use);
+void nnue_refresh(struct t_board *board);
+void nnue_make_move(struct t_board *board, struct t_move_record *move);
+void nnue_unmake_move(struct t_board *board, struct t_move_record *move);
+t_chess_value nnue_evaluate(struct t_board *board, struct t_chess_eval *eval);
+BOOL nnue_test(char *command);
+
 //-- Root Search (root.c)
 void root_search(struct t_board *board);
 
@@ -132,6 +280,9 @@ t_chess_value qsearch_plus(struct t_board *board, int ply, int depth, t_chess_va
 t_chess_value qsearch(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta);
 t_chess_value alphabeta_tip(struct t_board *board, int ply, int depth, t_chess_value alpha, BOOL *fail_low);
 t_chess_value is_it_checkmate(struct t_board *board, int ply);
+t_chess_value fixed_search(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta);
+t_chess_value fixed_qsearch(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, BOOL checks);
+void clear_killers(struct t_board *board);
 
 //-- Futility
 BOOL is_futile(struct t_pv_data *pv, struct t_pv_data *next_pv, int depth, t_chess_value alpha, t_chess_value beta);
@@ -247,13 +398,14 @@ BOOL fill_material_hash();
 void init_material_hash();
 void destroy_material_hash();
 t_hash calc_material_hash(struct t_board *board);
+BOOL init_kpk_bitbase();
+BOOL kpk_probe(t_chess_color to_move, t_chess_square strong_king, t_chess_square weak_king, t_chess_square pawn);
 
 //--Write to Disc
 void write_board(struct t_board *board, char filename[1024]);
 void write_move_list(struct t_move_list *move_list, char filename[1024]);
 void write_path(struct t_board *board, int ply, char filename[1024]);
 void write_tree(struct t_board *board, struct t_move_record *move, BOOL append, char filename[1024]);
-void write_log(char *s, char *filename, BOOL append, BOOL send);
 
 //--Test Routines
 void test_procedure();
@@ -265,6 +417,7 @@ BOOL test_make_unmake();
 BOOL test_perft();
 BOOL test_hash();
 BOOL test_eval();
+BOOL test_kpk();
 BOOL test_capture_gen();
 BOOL test_check_gen();
 BOOL test_alt_move_gen();
@@ -275,11 +428,14 @@ BOOL test_book();
 BOOL test_hash_table();
 BOOL test_ep_capture();
 BOOL test_perft960();
-void test_bench();
+BOOL test_trace_moves();
 
 //--Perft
 t_nodes perft(struct t_board *board, int depth);
 t_nodes do_perft(struct t_board *board, int depth);
+t_nodes parallel_perft(struct t_board *board, int depth, int threads, BOOL divide);
+void set_perft_cache(unsigned int size);
+void clear_perft_cache();
 
 //-- Opening Book (openingbook.c)
 int book_count();
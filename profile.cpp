@@ -0,0 +1,118 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+#include "profile.h"
+
+//===========================================================//
+// Hot Path Profiler
+//
+// Each search starts its thread's counters from zero and adds
+// them to a total at the end, which is reported straight away
+// or, during a bench, once all of the positions are done.
+// Sections are inclusive (e.g. evaluate() includes its pawn
+// hash lookups).
+//===========================================================//
+
+#ifdef USE_PROFILER
+
+THREAD_LOCAL struct t_profile profile;
+
+static struct t_profile profile_total;
+static unsigned long long profile_start;
+static BOOL profile_keep = FALSE;
+
+static const char *profile_name[PROFILE_SECTIONS] = {
+    "evaluate", "generate_moves", "generate_captures", "generate_evade", "make_move",
+    "unmake_move", "see", "probe", "poke", "lookup_pawn_hash"
+};
+
+void profile_search_start()
+{
+    memset(&profile, 0, sizeof(struct t_profile));
+    if (!profile_keep)
+        memset(&profile_total, 0, sizeof(struct t_profile));
+    profile_start = profile_ticks();
+}
+
+void profile_search_end()
+{
+    int i, j;
+
+    profile.elapsed = profile_ticks() - profile_start;
+
+    profile_total.elapsed += profile.elapsed;
+    for (i = 0; i < PROFILE_SECTIONS; i++) {
+        profile_total.calls[i] += profile.calls[i];
+        profile_total.samples[i] += profile.samples[i];
+        profile_total.ticks[i] += profile.ticks[i];
+        for (j = 0; j < PROFILE_BUCKETS; j++)
+            profile_total.histogram[i][j] += profile.histogram[i][j];
+    }
+
+    if (!profile_keep)
+        report_profile();
+}
+
+//-- Add up every search until profile_bench_end()
+void profile_bench_start()
+{
+    memset(&profile_total, 0, sizeof(struct t_profile));
+    profile_keep = TRUE;
+}
+
+void profile_bench_end()
+{
+    profile_keep = FALSE;
+    report_profile();
+}
+
+//-- Upper bound of the histogram bucket holding the given percentile
+static unsigned long long profile_percentile(int section, int percentile)
+{
+    unsigned long long n = 0;
+    int i;
+
+    for (i = 0; i < PROFILE_BUCKETS; i++) {
+        n += profile_total.histogram[section][i];
+        if (100 * n >= percentile * profile_total.samples[section])
+            break;
+    }
+    return 2ULL << i;
+}
+
+void report_profile()
+{
+    static char s[1024];
+    double average, share;
+    int i;
+
+    sprintf(s, "info string Profile (1 in %d calls timed, in " PROFILE_UNIT ")", PROFILE_SAMPLE_RATE);
+    send_command(s);
+    sprintf(s, "info string %-18s %14s %7s %9s %8s %8s %8s", "section", "calls", "share", "average", "p50<", "p90<", "p99<");
+    send_command(s);
+
+    for (i = 0; i < PROFILE_SECTIONS; i++) {
+        if (profile_total.samples[i] == 0)
+            continue;
+
+        //-- Scale the sampled time up to all of the calls
+        average = (double)profile_total.ticks[i] / profile_total.samples[i];
+        share = profile_total.elapsed ? 100.0 * average * profile_total.calls[i] / profile_total.elapsed : 0;
+
+        sprintf(s, "info string %-18s %14llu %6.1f%% %9.1f %8llu %8llu %8llu", profile_name[i], profile_total.calls[i], share, average,
+            profile_percentile(i, 50), profile_percentile(i, 90), profile_percentile(i, 99));
+        send_command(s);
+    }
+}
+
+#endif
@@ -0,0 +1,109 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+//===========================================================//
+// Hot Path Profiler
+//
+// Build with -DUSE_PROFILER to time the hot functions.  One
+// call in PROFILE_SAMPLE_RATE is timed (with the TSC where
+// there is one, otherwise the monotonic clock) and goes into
+// a per-thread log2 histogram.  Without USE_PROFILER the
+// macros expand to nothing.
+//===========================================================//
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#ifdef USE_PROFILER
+#define PROFILE(section)					t_profile_scope profile_scope(section)
+#define PROFILER(x)							x
+#else
+#define PROFILE(section)
+#define PROFILER(x)
+#endif
+
+#ifndef PROFILE_SAMPLE_RATE
+#define PROFILE_SAMPLE_RATE					16
+#endif
+#define PROFILE_BUCKETS						40
+
+enum t_profile_section
+{
+    profile_evaluate,
+    profile_generate_moves,
+    profile_generate_captures,
+    profile_generate_evade_check,
+    profile_make_move,
+    profile_unmake_move,
+    profile_see,
+    profile_probe,
+    profile_poke,
+    profile_pawn_hash
+};
+#define PROFILE_SECTIONS					10
+
+struct t_profile
+{
+    unsigned long long						calls[PROFILE_SECTIONS];
+    unsigned long long						samples[PROFILE_SECTIONS];
+    unsigned long long						ticks[PROFILE_SECTIONS];				// Sampled calls only
+    unsigned long long						histogram[PROFILE_SECTIONS][PROFILE_BUCKETS];
+    unsigned long long						elapsed;								// Ticks spent searching
+    int										countdown[PROFILE_SECTIONS];
+};
+
+#ifdef USE_PROFILER
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define profile_ticks()						__rdtsc()
+#define PROFILE_UNIT						"cycles"
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define profile_ticks()						__rdtsc()
+#define PROFILE_UNIT						"cycles"
+#else
+#define profile_ticks()						time_now_ns()
+#define PROFILE_UNIT						"ns"
+#endif
+
+extern THREAD_LOCAL struct t_profile profile;
+
+struct t_profile_scope
+{
+    t_profile_section						section;
+    unsigned long long						start;
+
+    inline t_profile_scope(t_profile_section s)
+    {
+        section = s;
+        start = 0;
+        profile.calls[s]++;
+        if (--profile.countdown[s] <= 0) {
+            profile.countdown[s] = PROFILE_SAMPLE_RATE;
+            start = profile_ticks();
+        }
+    }
+
+    inline ~t_profile_scope()
+    {
+        if (start) {
+            unsigned long long t = profile_ticks() - start;
+            int bucket = 0;
+
+            profile.samples[section]++;
+            profile.ticks[section] += t;
+            while ((t >>= 1) && bucket < PROFILE_BUCKETS - 1)
+                bucket++;
+            profile.histogram[section][bucket]++;
+        }
+    }
+};
+
+#endif
+
+#endif
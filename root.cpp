@@ -19,6 +19,7 @@
 #include "defs.h"
 #include "data.h"
 #include "procs.h"
+#include "profile.h"
 
 void root_search(struct t_board *board)
 {
@@ -60,20 +61,25 @@ void root_search(struct t_board *board)
 
     cutoffs = 0;
     first_move_cutoffs = 0;
+    SEARCH_STAT(clear_search_stats());
+    PROFILER(profile_search_start());
+    TRACE(trace_search_start());
 
     pv->node_type = node_pv;
 
     search_ply = 0;
     deepest = 0;
-    message_update_count = 0;
     search_start_time = time_now();
-    search_start_draw_stack_count = draw_stack_count;
+    search_start_draw_stack_count = board->draw_stack_count;
+
+    //-- Bring any cluster workers up to date
+    cluster_new_search(board);
 
 	//-- Reset Move Scores
 	reset_move_list_scores(move_list);
 
     //-- Start the thinking!
-    uci.engine_state = UCI_ENGINE_THINKING;
+    uci_set_engine_state(UCI_ENGINE_THINKING);
 
     //-- See if we can play a book move
     if (uci.opening_book.use_own_book && !uci.level.infinite) {
@@ -85,8 +91,7 @@ void root_search(struct t_board *board)
             board->pv_data[0].best_line[0] = move;
             board->pv_data[0].best_line_length = 1;
             send_info("Maverick Book Move!");
-            while (uci.level.ponder && !uci.stop)
-                Sleep(1);
+            uci_wait_for_stop();
             do_uci_bestmove(board);
             return;
         }
@@ -114,6 +119,12 @@ void root_search(struct t_board *board)
         //-- Loop around for each move
         while ((i < move_list->count) && !uci.stop) {
 
+            //-- Once the first move has set the score, let the cluster search the rest
+            if (i > 0 && cluster.worker_count > 0) {
+                cluster_search_root(board, move_list, i, search_ply, &best_score);
+                break;
+            }
+
             //-- Record the nodes at the start of the search
             start_nodes = nodes + qnodes;
 
@@ -199,12 +210,12 @@ void root_search(struct t_board *board)
 
 		//-- Push PV moves into the hash table
 		push_pv(board, best_score);
+		SEARCH_STAT(search_stats_iteration());
 
     } while (!is_search_complete(board, best_score, search_ply, move_list) && !uci.stop);
 
     //-- Snooze while still in ponder mode
-    while (((uci.level.infinite) || (uci.level.ponder)) && !uci.stop)
-        Sleep(1);
+    uci_wait_for_stop();
 
     //-- Send the latest PV
     if (!uci.stop)
@@ -215,6 +226,8 @@ void root_search(struct t_board *board)
     do_uci_send_nodes();
     do_uci_bestmove(board);
     do_uci_show_stats();
+    PROFILER(profile_search_end());
+    TRACE(trace_search_end());
 
 }
 
@@ -32,8 +32,33 @@ inline BOOL can_do_null_move(struct t_board *board, struct t_pv_data *pv, int pl
 		&& piece_count > 3;
 }
 
+//-- With USE_SEARCH_TRACE the search itself is alphabeta_search() and alphabeta() records its enter and exit
+#ifdef USE_SEARCH_TRACE
+#define SEARCH_NODE alphabeta_search
+
+t_chess_value alphabeta_search(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, BOOL early_cutoff, struct t_move_record *exclude_move);
+
 t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, BOOL early_cutoff, struct t_move_record *exclude_move) {
 
+    struct t_trace_frame frame[1];
+    t_chess_value e;
+
+    //-- Quiescent search isn't traced
+    if (depth <= 0 && !board->in_check)
+        return qsearch_plus(board, ply, depth, alpha, beta);
+
+    trace_enter(frame, board, ply, depth, alpha, beta);
+    e = alphabeta_search(board, ply, depth, alpha, beta, early_cutoff, exclude_move);
+    trace_exit(frame, board, ply, depth, alpha, beta, e);
+
+    return e;
+}
+#else
+#define SEARCH_NODE alphabeta
+#endif
+
+t_chess_value SEARCH_NODE(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, BOOL early_cutoff, struct t_move_record *exclude_move) {
+
     //-- Should we call qsearch?
     if (depth <= 0 && !board->in_check)
         return qsearch_plus(board, ply, depth, alpha, beta);
@@ -41,10 +66,6 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
     //-- Increment the nodes
     nodes++;
 
-    //-- see if we need to update stats */
-    if ((nodes & message_update_mask) == 0)
-        uci_check_status(board, ply);
-
     //-- Local Principle Variation variable
     struct t_pv_data *pv = &(board->pv_data[ply]);
 
@@ -93,9 +114,11 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
     //-- Probe Hash
     struct t_move_record *hash_move = NULL;
     struct t_hash_record *hash_record = probe(board->hash);
+    SEARCH_STAT(search_stats.hash_probes[STATS_DEPTH(depth)]++);
 
     //-- Has there been a match?
     if (hash_record != NULL) {
+        SEARCH_STAT(search_stats.hash_hits[STATS_DEPTH(depth)]++);
 
 		//-- Get the score from the hash table
 		t_chess_value hash_score = get_hash_score(hash_record, ply);
@@ -106,6 +129,8 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
             //-- Score in hash table is at least as good as beta
             if (hash_record->bound != HASH_UPPER && hash_score >= beta) {
                 hash_record->age = hash_age;
+                SEARCH_STAT(search_stats.hash_cutoffs[STATS_DEPTH(depth)]++);
+                TRACE(trace_prune(board, ply, depth, alpha, beta, hash_score, prune_hash, NULL));
                 assert(hash_score >= -CHECKMATE && hash_score <= CHECKMATE);
                 return hash_score;
             }
@@ -113,6 +138,8 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
             //-- Score is worse than alpha
             if (hash_record->bound != HASH_LOWER && hash_score <= alpha) {
                 hash_record->age = hash_age;
+                SEARCH_STAT(search_stats.hash_cutoffs[STATS_DEPTH(depth)]++);
+                TRACE(trace_prune(board, ply, depth, alpha, beta, hash_score, prune_hash, NULL));
                 assert(hash_score >= -CHECKMATE && hash_score <= CHECKMATE);
                 return hash_score;
             }
@@ -120,8 +147,10 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
             //-- Score is more accurate
             if (hash_record->bound == HASH_EXACT) {
                 hash_record->age = hash_age;
+                SEARCH_STAT(search_stats.hash_cutoffs[STATS_DEPTH(depth)]++);
                 pv->best_line_length = ply;
                 update_best_line_from_hash(board, ply);
+                TRACE(trace_prune(board, ply, depth, alpha, beta, hash_score, prune_hash, NULL));
                 assert(hash_score >= -CHECKMATE && hash_score <= CHECKMATE);
                 return hash_score;
             }
@@ -144,24 +173,32 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
     //-- Beta pruning
     if (early_cutoff && depth <= 4 && pv->node_type != node_pv && beta < MAX_CHECKMATE && beta > -MAX_CHECKMATE && !board->in_check) {
 
-        int pessimistic_score = pv->eval->static_score - depth * 50 - 100;
+        int pessimistic_score = pv->eval->static_score - depth * beta_prune_depth - beta_prune_margin;
+        SEARCH_STAT(search_stats.beta_prune_tries++);
 
-        if (pessimistic_score >= beta)
+        if (pessimistic_score >= beta) {
+            SEARCH_STAT(search_stats.beta_prune_cutoffs++);
+            TRACE(trace_prune(board, ply, depth, alpha, beta, pessimistic_score, prune_beta, NULL));
             return pessimistic_score;
+        }
     }
 
 	//-- Razoring.
 	t_chess_value e;	
 	if (early_cutoff && (depth <= 4) && pv->node_type != node_pv  && !board->in_check){
 
-		t_chess_value razor_margin = depth * 50 + 50;
-		if (pv->eval->static_score + razor_margin <= alpha){
+		t_chess_value margin = depth * razor_depth + razor_margin;
+		if (pv->eval->static_score + margin <= alpha){
 
-			t_chess_value razor_alpha = alpha - razor_margin;
+			t_chess_value razor_alpha = alpha - margin;
 			e = qsearch_plus(board, ply, depth, razor_alpha, razor_alpha + 1);
+			SEARCH_STAT(search_stats.razor_tries++);
 			
-			if (e <= razor_alpha)
+			if (e <= razor_alpha) {
+				SEARCH_STAT(search_stats.razor_cutoffs++);
+				TRACE(trace_prune(board, ply, depth, alpha, beta, e, prune_razor, NULL));
 				return e;
+			}
 		}
 	}
 		
@@ -175,8 +212,9 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
 
 		//-- Calculate Reduction
 		//int r = (800 + 70 * depth) / 256 + min(3, (pv->eval->static_score - beta) / 128);
-		int r = min(4, 2 + (25 * depth) / 128 + (pv->eval->static_score - beta) / 128);
+		int r = min(null_move_max, null_move_base + (null_move_depth * depth) / 128 + (pv->eval->static_score - beta) / null_move_eval);
 		//int r = 3;
+		SEARCH_STAT(search_stats.null_move_tries++);
 
 		//-- Make the changes on the board
 		make_null_move(board, undo);
@@ -203,6 +241,8 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
 		if (e >= beta) {
 			if (e > MAX_CHECKMATE)
 				e = beta;
+			SEARCH_STAT(search_stats.null_move_cutoffs++);
+			TRACE(trace_prune(board, ply, depth, alpha, beta, e, prune_null_move, NULL));
 			poke(board->hash, e, ply, depth, HASH_LOWER, NULL);
 			return e;
 		}
@@ -284,6 +324,7 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
 	t_chess_color to_move = board->to_move;
 	if (early_cutoff && (depth > 4) && pv->node_type != node_pv && beta < MAX_CHECKMATE && alpha > -MAX_CHECKMATE && !uci.stop) {
         BOOL fail_low;
+        SEARCH_STAT(search_stats.etc_tries++);
         while (simple_make_next_move(board, moves, undo)) {
 
             //-- Calculate Reduction Conservatively i.e. assume minimum reduction
@@ -302,6 +343,8 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
 
             //-- Is it good enough for a cutoff?
             if (e >= beta) {
+                SEARCH_STAT(search_stats.etc_cutoffs++);
+                TRACE(trace_prune(board, ply, depth, alpha, beta, e, prune_etc, moves->current_move));
                 poke(board->hash, e, ply, depth, HASH_LOWER, moves->current_move);
                 assert(e >= -CHECKMATE && e <= CHECKMATE);
                 return e;
@@ -363,6 +406,7 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
 		// Futility Pruning
 		//========================================//
 		if (uci.options.futility_pruning && is_futile(pv, next_pv, depth, a, b)){
+			TRACE(trace_prune(board, ply, depth, a, b, a, prune_futility, pv->current_move));
 			unmake_move(board, undo);
 			continue;
 		}		
@@ -485,91 +529,28 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
 		//-- Candidate for serious reductions
 		else{
 
-			switch (pv->node_type)
-			{
-			case node_cut:
-				pv->reduction = 3;
-				if (pv->current_move->captured)
-					pv->reduction += 1; 
-				break;
-
-			case node_super_cut:
-				pv->reduction = 4;
-				if (pv->current_move->captured)
-					pv->reduction += 1; 
-				break;
-
-			case node_pv:
-				if (pv->legal_moves_played > 2)
-					pv->reduction = 2;
-				else
-					pv->reduction = 1;
-				break;
-
-			case node_lite_all:
-				if (pv->legal_moves_played > 2)
-					pv->reduction = 2;
-				else
-					pv->reduction = 1;
-				
-				if (pv->current_move->captured)
-					pv->reduction += 1;				
-				break;
-
-			case node_super_all:
-				if (current_move->captured){
-					if (pv->legal_moves_played < 4)
-						pv->reduction = 3;
-					else
-						pv->reduction = 4;
-				}
-				else if (!see_safe(board, current_move->to_square, 0)){
-					if (pv->legal_moves_played < 4)
-						pv->reduction = 4;
-					else if (pv->legal_moves_played < 12)
-						pv->reduction = 5;
-					else 
-						pv->reduction = 6;
-				}
-				else if (pv->legal_moves_played < 4)
-					pv->reduction = 2;
-				else if (pv->legal_moves_played < 12)
-					pv->reduction = 3;
-				else
-					pv->reduction = 4;
-				break;
-
-			case node_all:
-				if (current_move->captured){
-					if (pv->legal_moves_played < 4)
-						pv->reduction = 3;
-					else 
-						pv->reduction = 4;
-				}
-				else if (!see_safe(board, current_move->to_square, 0)){
-					if (pv->legal_moves_played < 4)
-						pv->reduction = 4;
-					else 
-						pv->reduction = 5;
-				}
-				else if (pv->legal_moves_played < 4)
-					pv->reduction = 2;
-				else if (pv->legal_moves_played < 18)
-					pv->reduction = 3;
-				else
-					pv->reduction = 4;
-				break;
+			//-- Which band of the node type's table (see lmr_reduction[])
+			int *band_start = lmr_band_start[pv->node_type];
+			int band = (pv->legal_moves_played < band_start[0]) ? 0 : ((pv->legal_moves_played < band_start[1]) ? 1 : 2);
 
-			}
+			//-- SEE only if it makes a difference
+			if (current_move->captured)
+				pv->reduction = lmr_reduction[pv->node_type][lmr_capture][band];
+			else if (lmr_reduction[pv->node_type][lmr_unsafe][band] != lmr_reduction[pv->node_type][lmr_quiet][band] && !see_safe(board, current_move->to_square, 0))
+				pv->reduction = lmr_reduction[pv->node_type][lmr_unsafe][band];
+			else
+				pv->reduction = lmr_reduction[pv->node_type][lmr_quiet][band];
 
 		}
 
         //-- Search the next ply at reduced depth
+        SEARCH_STAT(if (pv->reduction > 1) search_stats.lmr_reductions[pv->node_type]++);
         e = -alphabeta(board, ply + 1, depth - pv->reduction, -b, -a, TRUE, NULL);
 
         //-- Fail high on a super-reduced move?
         if (e > a && pv->reduction > 1) {
             pv->reduction = 1;
+            SEARCH_STAT(search_stats.lmr_researches[pv->node_type]++);
 
             //-- Search again using the full width
             e = -alphabeta(board, ply + 1, depth - 1, -beta, -a, TRUE, NULL);
@@ -583,6 +564,10 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
 
         //-- Is it good enough to cut-off?
         if (e >= beta) {
+            SEARCH_STAT(search_stats.cutoffs_by_index[min(pv->legal_moves_played, STATS_MOVE_INDEXES) - 1]++);
+            SEARCH_STAT(search_stats.cutoffs_by_stage[search_stats_move_stage(pv, moves, in_check)]++);
+            SEARCH_STAT(search_stats.node_outcome[pv->node_type][outcome_cut]++);
+
             if (board->in_check)
                 update_check_killers(pv, depth);
             else
@@ -624,6 +609,9 @@ t_chess_value alphabeta(struct t_board *board, int ply, int depth, t_chess_value
         return 0;
     }
 
+    //-- How did the node turn out?
+    SEARCH_STAT(search_stats.node_outcome[pv->node_type][(best_score > alpha) ? outcome_pv : outcome_all]++);
+
     //-- Update Hash
     if (best_score > alpha)
         poke(board->hash, best_score, ply, depth, HASH_EXACT, pv->best_line[ply]);
@@ -916,6 +904,8 @@ t_chess_value qsearch(struct t_board *board, int ply, int depth, t_chess_value a
     if (ply > deepest) {
         deepest = ply;
         do_uci_depth();
+        if (uci.options.current_line)
+            uci_current_line(board, ply);
     }
 
     //-- Mate Distance Pruning
@@ -1123,3 +1113,213 @@ t_chess_value alphabeta_tip(struct t_board *board, int ply, int depth, t_chess_v
     return +CHESS_INFINITY;
 
 }
+
+//===========================================================//
+// Fixed Depth Search
+//
+// Plain alpha-beta (no hash table and no pruning) down to
+// fixed_qsearch().  Neither writes anything but the board, so
+// any number of threads can use them on their own boards
+// (batch evaluation, datagen, tuning); the move tables'
+// history and refutations are only read.  The thread's
+// fixed_search_nodes are counted here, and past
+// fixed_search_limit (if not zero) the search unwinds with a
+// meaningless score which the caller must throw away.
+//===========================================================//
+t_chess_value fixed_search(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta)
+{
+    struct t_move_list moves[1];
+    struct t_undo undo[1];
+    t_chess_value e, best_score = -CHECKMATE;
+
+    if (depth <= 0 || ply >= MAXPLY - 1)
+        return fixed_qsearch(board, ply, 0, alpha, beta, TRUE);
+
+    fixed_search_nodes++;
+    if (fixed_search_limit && fixed_search_nodes > fixed_search_limit)
+        return 0;
+
+    if (ply > 1 && repetition_draw(board))
+        return 0;
+
+    moves->hash_move = NULL;
+    if (board->in_check) {
+        generate_evade_check(board, moves);
+        order_evade_check(board, moves, ply);
+    }
+    else {
+        generate_moves(board, moves);
+        order_moves(board, moves, ply);
+    }
+
+    board->pv_data[ply].legal_moves_played = 0;
+    while (make_next_best_move(board, moves, undo)) {
+        board->pv_data[ply].legal_moves_played++;
+        board->pv_data[ply].current_move = moves->current_move;
+
+        evaluate(board, board->pv_data[ply + 1].eval);
+        e = -fixed_search(board, ply + 1, depth - 1, -beta, -alpha);
+        unmake_move(board, undo);
+
+        if (e > best_score) {
+            best_score = e;
+            if (e > alpha)
+                alpha = e;
+            if (e >= beta)
+                break;
+        }
+    }
+
+    //-- Checkmate or stalemate
+    if (board->pv_data[ply].legal_moves_played == 0)
+        return board->in_check ? -CHECKMATE + ply : 0;
+
+    return best_score;
+}
+
+//-- qsearch_plus() (with checks) or qsearch(), PV included, without the hash table, killers, refutations or "info depth"
+t_chess_value fixed_qsearch(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, BOOL checks)
+{
+    struct t_pv_data *pv = &(board->pv_data[ply]);
+    struct t_pv_data *next_pv = &(board->pv_data[ply + 1]);
+    struct t_move_list moves[1];
+    struct t_undo undo[1];
+    t_chess_value e, best_score;
+    t_chess_value a = alpha;
+    t_chess_value b = beta;
+    BOOL next_checks;
+
+    if (ply >= MAXPLY || uci.stop)
+        return pv->eval->static_score;
+
+    if (checks && repetition_draw(board)) {
+        pv->best_line_length = ply;
+        return 0;
+    }
+
+    //-- Mate Distance Pruning
+    if (CHECKMATE - ply <= alpha)
+        return alpha;
+    else if (-CHECKMATE + ply >= beta)
+        return beta;
+    else if (checks && !board->in_check && -CHECKMATE + ply + 2 >= beta)
+        return beta;
+
+    pv->legal_moves_played = 0;
+    moves->hash_move = NULL;
+
+    //-- In check: every evasion (checks are kept after a single reply)
+    if (board->in_check) {
+        best_score = -CHECKMATE;
+        generate_evade_check(board, moves);
+        if (moves->count == 0) {
+            pv->best_line_length = ply;
+            return -CHECKMATE + ply;
+        }
+
+        next_checks = checks && moves->count == 1;
+        if (!next_checks)
+            order_evade_check(board, moves, ply);
+
+        while (make_next_best_move(board, moves, undo)) {
+            pv->legal_moves_played++;
+            pv->current_move = moves->current_move;
+            evaluate(board, next_pv->eval);
+
+            //-- qsearch() searches its first evasion with a window one wider
+            e = -fixed_qsearch(board, ply + 1, depth - 1, checks ? -b : -b - 1, -a, next_checks);
+            if (alpha + 1 != beta && e > a && a + 1 == b)
+                e = -fixed_qsearch(board, ply + 1, depth - 1, -beta, -a, next_checks);
+            unmake_move(board, undo);
+
+            if (e >= beta)
+                return e;
+            if (e > best_score) {
+                best_score = e;
+                if (e > a) {
+                    a = e;
+                    update_best_line(board, ply);
+                }
+            }
+            b = a + 1;
+        }
+        return best_score;
+    }
+
+    //-- Stand pat
+    best_score = e = pv->eval->static_score;
+    if (e >= beta)
+        return e;
+    if (e > alpha) {
+        a = e;
+        pv->best_line_length = ply;
+    }
+
+    //-- Captures (only those which don't lose material without the checks)
+    generate_captures(board, moves);
+    order_captures(board, moves);
+    while (checks ? make_next_best_move(board, moves, undo) : make_next_see_positive_move(board, moves, 0, undo)) {
+        pv->legal_moves_played++;
+        pv->current_move = moves->current_move;
+        evaluate(board, next_pv->eval);
+
+        e = -fixed_qsearch(board, ply + 1, depth - 1, -b, -a, FALSE);
+        if (alpha + 1 != beta && e > a && a + 1 == b)
+            e = -fixed_qsearch(board, ply + 1, depth - 1, -beta, -a, FALSE);
+        unmake_move(board, undo);
+
+        if (e >= beta)
+            return e;
+        if (e > best_score) {
+            best_score = e;
+            if (e > a) {
+                a = e;
+                update_best_line(board, ply);
+            }
+        }
+        b = a + 1;
+    }
+
+    if (!checks)
+        return best_score;
+
+    //-- Quiet checks
+    moves->count = 0;
+    generate_quiet_checks(board, moves);
+    order_moves(board, moves, ply);
+    while (make_next_best_move(board, moves, undo)) {
+        pv->legal_moves_played++;
+        pv->current_move = moves->current_move;
+        evaluate(board, next_pv->eval);
+
+        e = -fixed_qsearch(board, ply + 1, depth - 1, -b, -a, TRUE);
+        if (alpha + 1 != beta && e > a && a + 1 == b)
+            e = -fixed_qsearch(board, ply + 1, depth - 1, -beta, -a, TRUE);
+        unmake_move(board, undo);
+
+        if (e >= beta)
+            return e;
+        if (e > best_score) {
+            best_score = e;
+            if (e > a) {
+                a = e;
+                update_best_line(board, ply);
+            }
+        }
+        b = a + 1;
+    }
+
+    return best_score;
+}
+
+//-- Nothing left over from an earlier position or game (e.g. check killers)
+void clear_killers(struct t_board *board)
+{
+    int i;
+
+    for (i = 0; i <= MAXPLY + 1; i++) {
+        board->pv_data[i].killer1 = board->pv_data[i].killer2 = NULL;
+        board->pv_data[i].check_killer1 = board->pv_data[i].check_killer2 = NULL;
+        board->pv_data[i].current_move = NULL;
+    }
+}
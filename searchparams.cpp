@@ -0,0 +1,171 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Search Parameters
+//
+//   setoption name <parameter> value <n>
+//   searchparams [load <file> | save <file> | show [name]]
+//
+// The pruning margins, aspiration windows, null move
+// reduction and late move reductions in search_param[]
+// (data.cpp) are UCI spin options.  A parameter file is just
+// the setoption commands, one to a line.  "show" also gives
+// each one's step, the perturbation an external SPSA tuner
+// should end its run with.
+//===========================================================//
+
+//-- UCI option names aren't case sensitive
+static BOOL same_name(const char *a, const char *b)
+{
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return *a == '\0' && *b == '\0';
+}
+
+struct t_search_param *find_search_param(char *name)
+{
+    struct t_search_param *p;
+
+    for (p = search_param; p->name != NULL; p++)
+        if (same_name(p->name, name))
+            return p;
+    return NULL;
+}
+
+void set_search_param(struct t_search_param *p, int value)
+{
+    *p->value = max(p->min, min(value, p->max));
+}
+
+void uci_search_param_options()
+{
+    static char s[256];
+    struct t_search_param *p;
+
+    for (p = search_param; p->name != NULL; p++) {
+        sprintf(s, "option name %s type spin default %d min %d max %d", p->name, *p->value, p->min, p->max);
+        send_command(s);
+    }
+}
+
+//-- "setoption name <parameter> value <n>" (FALSE if it isn't a search parameter)
+BOOL uci_set_search_param(char *command)
+{
+    static char s[UCI_BUFFER_SIZE];
+    static char name[256];
+    struct t_search_param *p;
+    char *word[64];
+    int i, n, value;
+
+    strncpy(s, command, sizeof(s) - 1);
+    n = split_words(s, word, 64);
+    for (value = 2; value < n; value++)
+        if (same_name(word[value], "value"))
+            break;
+    if (n < 4 || !same_name(word[1], "name") || value >= n - 1)
+        return FALSE;
+
+    name[0] = '\0';
+    for (i = 2; i < value && strlen(name) + strlen(word[i]) + 2 < sizeof(name); i++) {
+        if (i > 2)
+            strcat(name, " ");
+        strcat(name, word[i]);
+    }
+    if ((p = find_search_param(name)) == NULL)
+        return FALSE;
+
+    set_search_param(p, atoi(word[value + 1]));
+    return TRUE;
+}
+
+void write_search_params(FILE *f)
+{
+    struct t_search_param *p;
+
+    for (p = search_param; p->name != NULL; p++)
+        fprintf(f, "setoption name %s value %d\n", p->name, *p->value);
+}
+
+BOOL save_search_params(char *filename)
+{
+    FILE *f;
+
+    if ((f = fopen(filename, "w")) == NULL)
+        return FALSE;
+    fprintf(f, "# Maverick %s search parameters\n", ENGINE_VERSION);
+    write_search_params(f);
+    return fclose(f) == 0;
+}
+
+//-- Lines which aren't search parameters are skipped
+BOOL load_search_params(char *filename)
+{
+    static char line[1024];
+    static char s[1024];
+    int count = 0;
+    FILE *f;
+
+    if ((f = fopen(filename, "r")) == NULL) {
+        snprintf(s, sizeof(s), "Search Params: unable to read %s", filename);
+        send_info(s);
+        return FALSE;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "#\r\n")] = '\0';
+        if (!strncmp(line, "setoption ", 10) && uci_set_search_param(line))
+            count++;
+    }
+    fclose(f);
+
+    snprintf(s, sizeof(s), "Search Params: %d set from %s", count, filename);
+    send_info(s);
+    return TRUE;
+}
+
+void uci_search_params(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    struct t_search_param *p;
+    char *word[4];
+    int n;
+
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 4);
+
+    if (n >= 3 && !strcmp(word[1], "load")) {
+        uci_wait_for_search();
+        load_search_params(word[2]);
+    }
+    else if (n >= 3 && !strcmp(word[1], "save")) {
+        snprintf(s, sizeof(s), save_search_params(word[2]) ? "Search Params: saved %s" : "Search Params: unable to write %s", word[2]);
+        send_info(s);
+    }
+    else if (n >= 2 && !strcmp(word[1], "show")) {
+        for (p = search_param; p->name != NULL; p++) {
+            if (n >= 3 && strstr(p->name, word[2]) == NULL)
+                continue;
+            snprintf(s, sizeof(s), "%s %d (%d to %d, step %d)", p->name, *p->value, p->min, p->max, p->step);
+            send_info(s);
+        }
+    }
+    else
+        send_info("Search Params: searchparams [load <file> | save <file> | show [name]]");
+}
@@ -14,10 +14,13 @@
 #include "data.h"
 #include "procs.h"
 #include "bittwiddle.h"
+#include "profile.h"
 
 
 BOOL see(struct t_board *board, struct t_move_record *move, t_chess_value threshold) {
 
+    PROFILE(profile_see);
+
     t_chess_value see_value = see_piece_value[move->captured];
     t_chess_value trophy_value = see_piece_value[move->piece];
 
@@ -0,0 +1,143 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Search Statistics
+//
+// Only compiled with USE_SEARCH_STATS.  The counters belong
+// to the thread doing the search and are reported with the
+// rest of the search statistics ("Show Search Statistics").
+//===========================================================//
+
+#ifdef USE_SEARCH_STATS
+
+static const char *stage_name[MOVE_STAGES] = { "hash", "good captures", "killers", "quiet", "bad captures", "evasions" };
+static const char *node_type_name[NODE_TYPES] = { "cut", "super-cut", "pv", "lite-all", "super-all", "all" };
+
+void clear_search_stats()
+{
+    memset(&search_stats, 0, sizeof(struct t_search_stats));
+}
+
+//-- Called at the end of each iteration
+void search_stats_iteration()
+{
+    if (search_stats.iterations <= MAXPLY)
+        search_stats.iteration_nodes[search_stats.iterations++] = nodes + qnodes;
+}
+
+//-- Which part of the move ordering produced the move (call before the killers are updated)
+t_move_stage search_stats_move_stage(struct t_pv_data *pv, struct t_move_list *moves, BOOL in_check)
+{
+    struct t_move_record *move = moves->current_move;
+
+    if (move == moves->hash_move)
+        return stage_hash;
+    if (in_check)
+        return stage_evasion;
+    if (move->captured || move->promote_to)
+        return moves->current_move_see_positive ? stage_good_capture : stage_bad_capture;
+    if (move == pv->killer1 || move == pv->killer2 || move == pv->killer3 || move == pv->killer4)
+        return stage_killer;
+    return stage_quiet;
+}
+
+static double percent(t_nodes a, t_nodes b)
+{
+    return b ? (100.0 * a) / b : 0.0;
+}
+
+void report_search_stats()
+{
+    static char s[2048];
+    static char t[256];
+    t_nodes total, n, previous;
+    int i, j;
+
+    //-- Cutoffs by move number
+    total = 0;
+    for (i = 0; i < STATS_MOVE_INDEXES; i++)
+        total += search_stats.cutoffs_by_index[i];
+    strcpy(s, "info string Cutoffs by move:");
+    for (i = 0; i < STATS_MOVE_INDEXES; i++) {
+        if (search_stats.cutoffs_by_index[i] == 0)
+            continue;
+        sprintf(t, " %d%s=%.1f%%", i + 1, (i == STATS_MOVE_INDEXES - 1) ? "+" : "", percent(search_stats.cutoffs_by_index[i], total));
+        strcat(s, t);
+    }
+    send_command(s);
+
+    //-- Cutoffs by move ordering stage
+    strcpy(s, "info string Cutoffs by stage:");
+    for (i = 0; i < MOVE_STAGES; i++) {
+        sprintf(t, " %s=%.1f%%", stage_name[i], percent(search_stats.cutoffs_by_stage[i], total));
+        strcat(s, t);
+    }
+    send_command(s);
+
+    //-- Pruning
+    sprintf(s, "info string Null move " NODE_FORMAT "/" NODE_FORMAT " (%.1f%%), Razoring " NODE_FORMAT "/" NODE_FORMAT " (%.1f%%), Beta pruning " NODE_FORMAT "/" NODE_FORMAT " (%.1f%%), ETC " NODE_FORMAT "/" NODE_FORMAT " (%.1f%%)",
+        search_stats.null_move_cutoffs, search_stats.null_move_tries, percent(search_stats.null_move_cutoffs, search_stats.null_move_tries),
+        search_stats.razor_cutoffs, search_stats.razor_tries, percent(search_stats.razor_cutoffs, search_stats.razor_tries),
+        search_stats.beta_prune_cutoffs, search_stats.beta_prune_tries, percent(search_stats.beta_prune_cutoffs, search_stats.beta_prune_tries),
+        search_stats.etc_cutoffs, search_stats.etc_tries, percent(search_stats.etc_cutoffs, search_stats.etc_tries));
+    send_command(s);
+
+    //-- Late move reductions which had to be searched again
+    strcpy(s, "info string LMR re-searches:");
+    for (i = 0; i < NODE_TYPES; i++) {
+        sprintf(t, " %s=%.1f%%", node_type_name[i], percent(search_stats.lmr_researches[i], search_stats.lmr_reductions[i]));
+        strcat(s, t);
+    }
+    send_command(s);
+
+    //-- How often the node type turned out as predicted
+    strcpy(s, "info string Node types (cut/all/pv):");
+    for (i = 0; i < NODE_TYPES; i++) {
+        n = 0;
+        for (j = 0; j < NODE_OUTCOMES; j++)
+            n += search_stats.node_outcome[i][j];
+        sprintf(t, " %s=%.0f/%.0f/%.0f%%", node_type_name[i], percent(search_stats.node_outcome[i][outcome_cut], n),
+            percent(search_stats.node_outcome[i][outcome_all], n), percent(search_stats.node_outcome[i][outcome_pv], n));
+        strcat(s, t);
+    }
+    send_command(s);
+
+    //-- Effective branching factor
+    strcpy(s, "info string EBF:");
+    previous = 0;
+    for (i = 1; i < search_stats.iterations; i++) {
+        n = search_stats.iteration_nodes[i] - search_stats.iteration_nodes[i - 1];
+        previous = search_stats.iteration_nodes[i - 1] - ((i > 1) ? search_stats.iteration_nodes[i - 2] : 0);
+        if (previous == 0)
+            continue;
+        sprintf(t, " %d=%.2f", i + 1, (double)n / previous);
+        if (strlen(s) + strlen(t) < sizeof(s))
+            strcat(s, t);
+    }
+    send_command(s);
+
+    //-- Hash table by remaining depth
+    strcpy(s, "info string Hash hits/cutoffs by depth:");
+    for (i = 0; i < STATS_MAX_DEPTH; i++) {
+        if (search_stats.hash_probes[i] == 0)
+            continue;
+        sprintf(t, " %d%s=%.0f/%.0f%%", i, (i == STATS_MAX_DEPTH - 1) ? "+" : "", percent(search_stats.hash_hits[i], search_stats.hash_probes[i]),
+            percent(search_stats.hash_cutoffs[i], search_stats.hash_probes[i]));
+        strcat(s, t);
+    }
+    send_command(s);
+}
+
+#endif
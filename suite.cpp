@@ -0,0 +1,500 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// EPD Test Suites
+//
+//   suite <file.epd> [movetime ms | nodes n] [workers n]
+//         [hash mb] [min n]
+//
+// Runs a WAC / STS style suite.  Each worker is a separate
+// Maverick process (so it has its own board and its own slice
+// of the hash) driven over UCI through a pair of pipes, and
+// each position is searched from a new game.  A position is
+// solved if the move played is one of the "bm" moves, or not
+// one of the "am" moves.  The time and nodes to solution are
+// taken from the "info ... pv" line where the move played
+// first became the engine's choice and stayed so.  With "min"
+// the run fails unless at least that many are solved.
+//===========================================================//
+
+static struct t_suite_position *suite_position;
+static int suite_count;
+
+//-- Convert a list of SAN moves to coordinate notation
+static int suite_moves(struct t_board *board, struct t_move_list *moves, char *word[], int n, char list[SUITE_MAX_MOVES][8])
+{
+    struct t_move_record *move;
+    int i, count = 0;
+
+    for (i = 0; i < n && count < SUITE_MAX_MOVES; i++) {
+        if ((move = parse_san(board, moves, word[i])) != NULL)
+            strcpy(list[count++], move_as_str(move));
+    }
+    return count;
+}
+
+//-- "<board> <side> <castling> <ep> bm Qxf7+; id "WAC.001";"
+static BOOL read_suite_file(char *filename)
+{
+    static char line[1024];
+    static char s[256];
+    struct t_board *board;
+    struct t_move_list moves[1];
+    struct t_suite_position *p;
+    char *word[64];
+    char *fen, *operations, *operation, *next;
+    int line_number = 0;
+    int n, i;
+    FILE *f;
+
+    if ((f = fopen(filename, "r")) == NULL)
+        return FALSE;
+
+    board = (struct t_board *)malloc(sizeof(struct t_board));
+    init_board(board);
+
+    suite_count = 0;
+    while (suite_count < SUITE_MAX_POSITIONS && fgets(line, sizeof(line), f) != NULL) {
+        line_number++;
+
+        for (i = 0; line[i]; i++)
+            if (line[i] == '\r' || line[i] == '\n')
+                line[i] = ' ';
+        if (line[0] == '#')
+            continue;
+
+        //-- The four FEN fields and then the operations
+        fen = line;
+        while (*fen == ' ' || *fen == '\t')
+            fen++;
+        operations = fen;
+        for (n = 0; n < 4 && *operations; n++) {
+            while (*operations && *operations != ' ' && *operations != '\t')
+                operations++;
+            while (n < 3 && (*operations == ' ' || *operations == '\t'))
+                operations++;
+        }
+        if (n < 4 || *operations == '\0')
+            continue;
+        *operations++ = '\0';
+
+        //-- A position which doesn't fit would be searched wrongly, so it's left out
+        if (strlen(fen) >= sizeof(suite_position[0].fen)) {
+            snprintf(s, sizeof(s), "Suite: skipping line %d of the file, the position is too long", line_number);
+            send_info(s);
+            continue;
+        }
+
+        p = &suite_position[suite_count];
+        memset(p, 0, sizeof(struct t_suite_position));
+        strcpy(p->fen, fen);
+        sprintf(p->id, "%d", suite_count + 1);
+
+        set_fen(board, p->fen);
+        generate_legal_moves(board, moves);
+
+        //-- The operations
+        for (operation = operations; operation != NULL && *operation; operation = next) {
+            if ((next = strchr(operation, ';')) != NULL)
+                *next++ = '\0';
+            n = split_words(operation, word, 64);
+            if (n < 2)
+                continue;
+            if (!strcmp(word[0], "bm"))
+                p->best_count = suite_moves(board, moves, word + 1, n - 1, p->best_move);
+            else if (!strcmp(word[0], "am"))
+                p->avoid_count = suite_moves(board, moves, word + 1, n - 1, p->avoid_move);
+            else if (!strcmp(word[0], "id")) {
+                for (i = 1; i < n; i++) {
+                    if (i > 1)
+                        strncat(p->id, " ", sizeof(p->id) - strlen(p->id) - 1);
+                    else
+                        p->id[0] = '\0';
+                    strncat(p->id, word[i] + (word[i][0] == '"'), sizeof(p->id) - strlen(p->id) - 1);
+                }
+                if (p->id[0] && p->id[strlen(p->id) - 1] == '"')
+                    p->id[strlen(p->id) - 1] = '\0';
+            }
+        }
+
+        //-- Nothing to solve
+        if (p->best_count == 0 && p->avoid_count == 0) {
+            snprintf(line, sizeof(line), "Suite: skipping %s (no legal \"bm\" or \"am\" move)", p->id);
+            send_info(line);
+            continue;
+        }
+
+        suite_count++;
+    }
+
+    free(board);
+    fclose(f);
+    return suite_count > 0;
+}
+
+static BOOL suite_correct(struct t_suite_position *p, char *move)
+{
+    int i;
+
+    for (i = 0; i < p->avoid_count; i++)
+        if (!strcmp(move, p->avoid_move[i]))
+            return FALSE;
+    if (p->best_count == 0)
+        return TRUE;
+    for (i = 0; i < p->best_count; i++)
+        if (!strcmp(move, p->best_move[i]))
+            return TRUE;
+    return FALSE;
+}
+
+static int compare_numbers(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+//-- Mean, median, 90th percentile and maximum of the solved positions
+static void suite_distribution(const char *name, double *value, int n, const char *unit)
+{
+    static char s[1024];
+    double total = 0;
+    int i;
+
+    if (n == 0)
+        return;
+    qsort(value, n, sizeof(double), compare_numbers);
+    for (i = 0; i < n; i++)
+        total += value[i];
+
+    sprintf(s, "%s to solution: mean %.0f, median %.0f, 90%% %.0f, max %.0f %s", name, total / n, value[n / 2], value[(9 * n) / 10 < n ? (9 * n) / 10 : n - 1],
+        value[n - 1], unit);
+    send_command(s);
+}
+
+static void suite_report(int workers, t_chess_time movetime, t_nodes node_limit, t_chess_time elapsed)
+{
+    static const int fraction[] = { 5, 10, 25, 50, 100 };
+    static char s[1024];
+    static char t[128];
+    struct t_suite_position *p;
+    double *time_value, *node_value;
+    double limit;
+    int i, j, solved = 0, count;
+
+    time_value = (double *)malloc(suite_count * sizeof(double));
+    node_value = (double *)malloc(suite_count * sizeof(double));
+
+    for (i = 0; i < suite_count; i++) {
+        p = &suite_position[i];
+        snprintf(s, sizeof(s), "%4d %-16s %-6s %-6s bm %s%s am %s time %ld nodes " NODE_FORMAT, i + 1, p->id, p->solved ? "solved" : "failed",
+            p->move[0] ? p->move : "-", p->best_count ? p->best_move[0] : "-", (p->best_count > 1) ? ".." : "", p->avoid_count ? p->avoid_move[0] : "-",
+            p->solved ? p->solve_time : p->time, p->solved ? p->solve_nodes : p->nodes);
+        send_command(s);
+
+        if (p->solved) {
+            time_value[solved] = (double)p->solve_time;
+            node_value[solved] = (double)p->solve_nodes;
+            solved++;
+        }
+    }
+
+    sprintf(s, "Solved %d of %d (%.1f%%) with %d workers in %.1f seconds", solved, suite_count, 100.0 * solved / suite_count, workers, elapsed / 1000.0);
+    send_command(s);
+
+    //-- How many were solved within a fraction of the limit
+    if (solved > 0) {
+        limit = node_limit ? (double)node_limit : (double)movetime;
+        strcpy(s, "Solved within the limit:");
+        for (j = 0; j < (int)(sizeof(fraction) / sizeof(fraction[0])); j++) {
+            count = 0;
+            for (i = 0; i < solved; i++)
+                if ((node_limit ? node_value[i] : time_value[i]) <= limit * fraction[j] / 100)
+                    count++;
+            sprintf(t, " %d%%=%d", fraction[j], count);
+            strcat(s, t);
+        }
+        send_command(s);
+    }
+
+    suite_distribution("Time", time_value, solved, "ms");
+    suite_distribution("Nodes", node_value, solved, "nodes");
+
+    free(time_value);
+    free(node_value);
+}
+
+#if defined(_WIN32)
+
+static BOOL run_suite(int workers, int hash, t_chess_time movetime, t_nodes node_limit)
+{
+    send_info("Test suites are not supported on this platform");
+    return FALSE;
+}
+
+#else
+
+static struct t_suite_worker suite_worker[SUITE_MAX_WORKERS];
+static int suite_worker_count;
+
+static BOOL start_suite_worker(struct t_suite_worker *w, int hash)
+{
+    static char s[256];
+
+    w->position = -1;
+    if (!engine_start(&w->process, NULL, TRUE))
+        return FALSE;
+
+    sprintf(s, "uci\nsetoption name Hash value %d\nsetoption name OwnBook value false\nisready\n", hash);
+    return engine_send(&w->process, s);
+}
+
+static void suite_search(struct t_suite_worker *w, int index, t_chess_time movetime, t_nodes node_limit)
+{
+    static char s[1024];
+    struct t_suite_position *p = &suite_position[index];
+
+    p->solve_time = -1;
+    p->time = -1;
+    w->position = index;
+    w->start = time_now();
+    w->stopped = FALSE;
+
+    if (node_limit)
+        snprintf(s, sizeof(s), "ucinewgame\nposition fen %s\ngo nodes " NODE_FORMAT "\n", p->fen, node_limit);
+    else
+        snprintf(s, sizeof(s), "ucinewgame\nposition fen %s\ngo movetime %ld\n", p->fen, movetime);
+    engine_send(&w->process, s);
+}
+
+//-- "info ... time t ... nodes n ... pv m ..." and "bestmove m"
+static BOOL suite_line(struct t_suite_worker *w, char *line)
+{
+    struct t_suite_position *p = &suite_position[w->position];
+    char *word[64];
+    char *move = NULL;
+    t_chess_time time = -1;
+    int i, n;
+
+    n = split_words(line, word, 64);
+    if (n < 2)
+        return FALSE;
+
+    if (!strcmp(word[0], "bestmove")) {
+        strncpy(p->move, word[1], sizeof(p->move) - 1);
+        if (p->time < 0)
+            p->time = time_now() - w->start;
+        p->solved = suite_correct(p, p->move);
+        if (p->solved && p->solve_time < 0) {
+            p->solve_time = p->time;
+            p->solve_nodes = p->nodes;
+        }
+        return TRUE;
+    }
+
+    if (strcmp(word[0], "info"))
+        return FALSE;
+    for (i = 1; i < n - 1; i++) {
+        if (!strcmp(word[i], "time"))
+            p->time = time = atol(word[i + 1]);
+        else if (!strcmp(word[i], "nodes"))
+            p->nodes = (t_nodes)strtoull(word[i + 1], NULL, 10);
+        else if (!strcmp(word[i], "pv")) {
+            move = word[i + 1];
+            break;
+        }
+    }
+
+    //-- Has the engine just found (or just left) the solution?
+    if (move != NULL) {
+        if (!suite_correct(p, move))
+            p->solve_time = -1;
+        else if (p->solve_time < 0) {
+            p->solve_time = (time >= 0) ? time : time_now() - w->start;
+            p->solve_nodes = p->nodes;
+        }
+    }
+    return FALSE;
+}
+
+static BOOL run_suite(int workers, int hash, t_chess_time movetime, t_nodes node_limit)
+{
+    static char line[4 * UCI_BUFFER_SIZE];
+    struct pollfd poll_list[SUITE_MAX_WORKERS];
+    struct t_suite_worker *w;
+    int next = 0, done = 0, busy, i;
+
+    //-- A worker which dies shouldn't take us with it
+    signal(SIGPIPE, SIG_IGN);
+
+    suite_worker_count = 0;
+    for (i = 0; i < workers; i++) {
+        if (start_suite_worker(&suite_worker[suite_worker_count], hash))
+            suite_worker_count++;
+    }
+    if (suite_worker_count == 0) {
+        send_info("Suite: unable to start the workers");
+        return FALSE;
+    }
+
+    while (done < suite_count) {
+
+        //-- Hand out the positions
+        busy = 0;
+        for (i = 0; i < suite_worker_count; i++) {
+            w = &suite_worker[i];
+            if (w->position < 0 && next < suite_count)
+                suite_search(w, next++, movetime, node_limit);
+            if (w->position >= 0)
+                busy++;
+            poll_list[i].fd = w->process.output;
+            poll_list[i].events = POLLIN;
+            poll_list[i].revents = 0;
+        }
+        if (busy == 0)
+            break;
+
+        if (poll(poll_list, suite_worker_count, 100) < 0 && errno != EINTR)
+            break;
+
+        for (i = 0; i < suite_worker_count; i++) {
+            w = &suite_worker[i];
+
+            //-- Overdue (e.g. a node limit and a slow machine)
+            if (w->position >= 0 && !w->stopped && !node_limit && (t_chess_time)(time_now() - w->start) > movetime + SUITE_STOP_GRACE) {
+                engine_send(&w->process, "stop\n");
+                w->stopped = TRUE;
+            }
+
+            if (!(poll_list[i].revents & (POLLIN | POLLHUP)))
+                continue;
+
+            //-- The worker has gone, so the position counts as failed
+            if (!engine_read(&w->process)) {
+                if (w->position >= 0)
+                    done++;
+                engine_stop(&w->process, TRUE);
+                poll_list[i] = poll_list[suite_worker_count - 1];
+                suite_worker[i--] = suite_worker[--suite_worker_count];
+                if (suite_worker_count == 0) {
+                    send_info("Suite: all of the workers have stopped");
+                    return FALSE;
+                }
+                continue;
+            }
+
+            while (w->position >= 0 && engine_next_line(&w->process, line)) {
+                if (suite_line(w, line)) {
+                    w->position = -1;
+                    done++;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < suite_worker_count; i++)
+        engine_stop(&suite_worker[i].process, TRUE);
+
+    return TRUE;
+}
+
+#endif
+
+BOOL run_test_suite(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    char *word[64];
+    char *filename = NULL;
+    t_chess_time movetime = 0;
+    t_chess_time start;
+    t_nodes node_limit = 0;
+    int workers = numa.cpu_count;
+    int hash = SUITE_DEFAULT_HASH;
+    int minimum = 0;
+    int solved = 0;
+    int i, n;
+    BOOL ok;
+
+    //-- Options
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "movetime") && i < n - 1)
+            movetime = atol(word[++i]);
+        else if (!strcmp(word[i], "nodes") && i < n - 1)
+            node_limit = (t_nodes)strtoull(word[++i], NULL, 10);
+        else if (!strcmp(word[i], "workers") && i < n - 1)
+            workers = atoi(word[++i]);
+        else if (!strcmp(word[i], "hash") && i < n - 1)
+            hash = atoi(word[++i]);
+        else if (!strcmp(word[i], "min") && i < n - 1)
+            minimum = atoi(word[++i]);
+        else
+            filename = word[i];
+    }
+    if (filename == NULL) {
+        send_info("Usage: suite <file.epd> [movetime ms | nodes n] [workers n] [hash mb] [min n]");
+        return FALSE;
+    }
+    if (movetime <= 0 && node_limit == 0)
+        movetime = SUITE_DEFAULT_MOVETIME;
+    workers = max(1, min(workers, SUITE_MAX_WORKERS));
+    hash = max(2, hash / workers);
+
+    suite_position = (struct t_suite_position *)malloc(SUITE_MAX_POSITIONS * sizeof(struct t_suite_position));
+    if (suite_position == NULL)
+        return FALSE;
+    if (!read_suite_file(filename)) {
+        snprintf(s, sizeof(s), "Suite: no positions with \"bm\" or \"am\" in %s", filename);
+        send_info(s);
+        free(suite_position);
+        return FALSE;
+    }
+    workers = min(workers, suite_count);
+
+    uci_wait_for_search();
+
+    snprintf(s, sizeof(s), "Suite: %d positions from %s on %d workers (%d MB hash each)", suite_count, filename, workers, hash);
+    send_info(s);
+
+    start = time_now();
+    ok = run_suite(workers, hash, movetime, node_limit);
+    if (ok) {
+        suite_report(workers, movetime, node_limit, time_now() - start);
+        for (i = 0; i < suite_count; i++)
+            solved += suite_position[i].solved;
+        if (solved < minimum) {
+            sprintf(s, "Suite FAILED: %d solved, at least %d needed", solved, minimum);
+            send_command(s);
+            ok = FALSE;
+        }
+    }
+
+    free(suite_position);
+    return ok;
+}
@@ -33,6 +33,7 @@ void test_procedure()
     assert(test_make_unmake());
     assert(test_hash());
     assert(test_eval());
+    assert(test_kpk());
     assert(test_capture_gen());
     assert(test_check_gen());
     assert(test_alt_move_gen());
@@ -41,6 +42,7 @@ void test_procedure()
 	assert(test_hash_table());
 	assert(test_ep_capture());
 	assert(test_book());
+	assert(test_trace_moves());
     test_search();
 }
 
@@ -223,65 +225,66 @@ BOOL test_perft960() {
 		set_fen(position, "qr1kbb1r/1pp2ppp/3npn2/3pN3/1p3P2/4PN2/P1PP2PP/QR1KBB1R w HBhb -");
 		n = perft(position, 6);
 		ok &= (n == 3206947488);
+		ok &= (parallel_perft(position, 6, numa.cpu_count, FALSE) == 3206947488);
 	//	global_nodes += n;
 	//	flip_board(position);
 	//}
 
 	if (ok)
-		printf("Everything seems Fine - all PERFT 960 scores are correct\n");
+		send_command("Everything seems Fine - all PERFT 960 scores are correct");
 	else
-		printf("**ERROR** with PERFT 960 scores\n");
+		send_command("**ERROR** with PERFT 960 scores");
 
 	return ok;
 }
 
-BOOL test_perft() {
-
+//-- The first four perft positions (and their mirror images) from perft() or parallel_perft() on every cpu
+static BOOL test_perft_positions(BOOL parallel) {
+
+    static char fen[4][100] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"
+    };
+    static const int depth[4] = { 6, 5, 7, 6 };
+    static const t_nodes count[4] = { 119060324, 193690690, 178633661, 706045033 };
     BOOL ok = TRUE;
-    int i;
-    t_nodes n = 0;
-
-    if (!uci.engine_initialized)
-        init_engine(position);
+    int i, j;
+    t_nodes n;
+    char s[256];
 
     global_nodes = 0;
     perft_start_time = time_now();
 
-    //--Position 1
-    for (i = 0; i <= 1; i++) {
-        set_fen(position, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
-        n = perft(position, 6);
-        ok &= (n == 119060324);
-        global_nodes += n;
-        flip_board(position);
-    }
-    //--Position 2
-    for (i = 0; i <= 1; i++) {
-        set_fen(position, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
-        n = perft(position, 5);
-        ok &= (n == 193690690);
-        global_nodes += n;
-        flip_board(position);
-    }
-    //--Position 3
-    for (i = 0; i <= 1; i++) {
-        set_fen(position, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -");
-        n = perft(position, 7);
-        ok &= (n == 178633661);
-        global_nodes += n;
-        flip_board(position);
-    }
-    //--Position 4
-    for (i = 0; i <= 1; i++) {
-        set_fen(position, "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
-        n = perft(position, 6);
-        ok &= (n == 706045033);
-        global_nodes += n;
-        flip_board(position);
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j <= 1; j++) {
+            set_fen(position, fen[i]);
+            n = parallel ? parallel_perft(position, depth[i], numa.cpu_count, FALSE) : perft(position, depth[i]);
+            ok &= (n == count[i]);
+            global_nodes += n;
+            flip_board(position);
+        }
     }
 
     perft_end_time = time_now();
 
+    sprintf(s, INFO_STRING_PERFT_SPEED, global_nodes, perft_end_time - perft_start_time, 1000 * global_nodes / max(1, perft_end_time - perft_start_time));
+    send_command(s);
+    return ok;
+}
+
+BOOL test_perft() {
+
+    BOOL ok = TRUE;
+    int i;
+
+    if (!uci.engine_initialized)
+        init_engine(position);
+
+    //--Positions 1 to 4, timed
+    ok &= test_perft_positions(FALSE);
+
     //--Position 5
     for (i = 0; i <= 1; i++) {
         set_fen(position, "1k6/1b6/8/8/7R/8/8/4K2R b K - 0 1");
@@ -387,12 +390,19 @@ BOOL test_perft() {
         flip_board(position);
     }
 
+    //--Positions 1 to 4 again, shared out between the threads
+    ok &= test_perft_positions(TRUE);
+
+    //--And once more with the subtree counts kept in the perft cache
+    set_perft_cache(PERFT_TEST_CACHE);
+    ok &= test_perft_positions(TRUE);
+    set_perft_cache(0);
+
     if (ok)
-        printf("Everything seems Fine - all PERFT scores are correct\n");
+        send_command("Everything seems Fine - all PERFT scores are correct");
     else
-        printf("**ERROR** with PERFT scores\n");
+        send_command("**ERROR** with PERFT scores");
 
-	printf(INFO_STRING_PERFT_SPEED, global_nodes, perft_end_time - perft_start_time, 1000 * global_nodes / (perft_end_time - perft_start_time));
     return ok;
 }
 
@@ -682,6 +692,47 @@ BOOL test_eval() {
 
 }
 
+//-- K + P vs. k comes from the bitbase: zero for a draw, otherwise the winner's sign from the side to move's point of view
+BOOL test_kpk() {
+
+    struct t_chess_eval eval[1];
+    BOOL ok = kpk_available;
+
+    init_eval(eval);
+
+    //-- A rook's pawn with the defending king in front is a draw, whoever is to move
+    set_fen(position, "8/8/8/8/8/k7/P7/K7 w - -");
+    ok &= (evaluate(position, eval) == 0);
+    set_fen(position, "8/8/8/8/8/k7/P7/K7 b - -");
+    ok &= (evaluate(position, eval) == 0);
+    set_fen(position, "k7/p7/K7/8/8/8/8/8 w - -");
+    ok &= (evaluate(position, eval) == 0);
+    set_fen(position, "k7/p7/K7/8/8/8/8/8 b - -");
+    ok &= (evaluate(position, eval) == 0);
+
+    //-- The king on the sixth rank in front of its pawn wins, whoever is to move
+    set_fen(position, "4k3/8/4K3/4P3/8/8/8/8 w - -");
+    ok &= (evaluate(position, eval) > 0);
+    set_fen(position, "4k3/8/4K3/4P3/8/8/8/8 b - -");
+    ok &= (evaluate(position, eval) < 0);
+    set_fen(position, "4K3/8/8/8/4p3/4k3/8/8 b - -");
+    ok &= (evaluate(position, eval) > 0);
+    set_fen(position, "4K3/8/8/8/4p3/4k3/8/8 w - -");
+    ok &= (evaluate(position, eval) < 0);
+
+    //-- Facing kings in front of the pawn: a draw if the strong side is to move, otherwise a win
+    set_fen(position, "8/4k3/8/4K3/4P3/8/8/8 w - -");
+    ok &= (evaluate(position, eval) == 0);
+    set_fen(position, "8/4k3/8/4K3/4P3/8/8/8 b - -");
+    ok &= (evaluate(position, eval) < 0);
+    set_fen(position, "8/8/8/4p3/4k3/8/4K3/8 b - -");
+    ok &= (evaluate(position, eval) == 0);
+    set_fen(position, "8/8/8/4p3/4k3/8/4K3/8 w - -");
+    ok &= (evaluate(position, eval) < 0);
+
+    return ok;
+}
+
 BOOL test_see() {
 
     t_move_record *move;
@@ -752,6 +803,15 @@ BOOL test_position()
 {
 	uci_position(position, "position startpos moves d2d4 g7g6 g1f3 g8f6 c2c4 f8g7 b1c3 d7d5 d1b3 d5c4 b3c4 e8g8 e2e4 a7a6 e4e5 b7b5 c4b3 f6d7 e5e6 f7e6 f3g5 d7b6 g5e6 c8e6 b3e6 g8h8 c1e3 d8d6 e6d6 e7d6");
 
+	//-- Extending the last position only plays the new moves, which must give the same result as starting again
+	uci_position(position, "position startpos moves d2d4 g7g6 g1f3 g8f6 c2c4 f8g7 b1c3 d7d5 d1b3 d5c4 b3c4 e8g8 e2e4 a7a6 e4e5 b7b5 c4b3 f6d7 e5e6 f7e6 f3g5 d7b6 g5e6 c8e6 b3e6 g8h8 c1e3 d8d6 e6d6 e7d6 e3b6 c7b6");
+	t_hash hash = position->hash;
+	int count = position->draw_stack_count;
+
+	uci_position(position, "position fen rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - moves d2d4 g7g6 g1f3 g8f6 c2c4 f8g7 b1c3 d7d5 d1b3 d5c4 b3c4 e8g8 e2e4 a7a6 e4e5 b7b5 c4b3 f6d7 e5e6 f7e6 f3g5 d7b6 g5e6 c8e6 b3e6 g8h8 c1e3 d8d6 e6d6 e7d6 e3b6 c7b6");
+	if (position->hash != hash || position->draw_stack_count != count)
+		return FALSE;
+
     return TRUE;
 }
 
@@ -791,8 +851,7 @@ BOOL test_search()
 	uci_position(position, "position fen rbbqnknr/pppppppp/8/8/8/8/PPPPPPPP/RBBQNKNR w HAha - moves c2c4 c7c5 g1f3 e7e5 b1e4 e8d6 d2d3 d6e4 d3e4 g8e7 c1e3 b7b6 d1d3 c8b7 a1d1 b7c6 g2g4 f7f6 h1g1 h7h5 e3d2 h5g4 g1g4 d8c8 g4g2 c8a6 a2a3 b6b5 c4b5 c6b5 d3e3 d7d6 d1c1 b8c7 h2h4 a6b7 b2b4 c7b6 a3a4 b5a4 b4c5 b6c5 e3d3 a4b5 d3c2 a7a5 d2c3 a8c8 c2b2 b5c6");
 	uci_go("go depth 6");
 
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
+	uci_wait_for_search();
 
 	uci_new_game(position);
 
@@ -801,83 +860,17 @@ BOOL test_search()
 	uci_position(position, "position fen qrknrnbb/pppppppp/8/8/8/8/PPPPPPPP/QRKNRNBB w EBeb -");
 	uci_go("go depth 6");
 
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
+	uci_wait_for_search();
 
 	uci_new_game(position);
 	uci_position(position, "position fen 7k/8/8/7P/4B3/5K2/7P/8 w - - moves");
 	uci_go("go depth 12");
 
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
+	uci_wait_for_search();
 	
 	return TRUE;
 }
 
-void test_bench()
-{
-
-	uci_set_mode();
-	uci_isready();
-
-	set_hash(512);
-	set_own_book(FALSE);
-
-	uci_new_game(position);
-
-	global_nodes = 0;
-
-	t_chess_time start_time = time_now();
-
-	uci_position(position, "position fen 8/8/8/4k2K/1R3p2/8/6r1/8 w - -");
-	uci_go("go depth 20");
-
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
-	global_nodes += nodes + qnodes;
-
-	uci_position(position, "position fen 1rq5/p3kp2/2Bp1p2/1P2p1r1/QP3n2/2P5/5PPP/R4RK1 b - -");
-	uci_go("go depth 12");
-
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
-	global_nodes += nodes + qnodes;
-
-	uci_position(position, "position fen 1NQ5/k1p1p3/7p/pP2P1P1/2P5/2pq4/1n6/6K1 w - -");
-	uci_go("go depth 12");
-
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
-	global_nodes += nodes + qnodes;
-
-	uci_position(position, "position fen 2kr3r/pp1q1ppp/5n2/1Nb5/2Pp1B2/7Q/P4PPP/1R3RK1 w - -");
-	uci_go("go depth 16");
-
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
-	global_nodes += nodes + qnodes;
-
-	uci_position(position, "position fen 8/5p2/pk2p3/4P2p/2b1pP1P/P3P2B/8/7K w - -");
-	uci_go("go depth 24");
-
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
-	global_nodes += nodes + qnodes;
-
-	uci_position(position, "position fen 5rk1/2p4p/2p4r/3P4/4p1b1/1Q2NqPp/PP3P1K/R4R2 b - -");
-	uci_go("go depth 16");
-
-	while (uci.engine_state != UCI_ENGINE_WAITING)
-		Sleep(1);
-	global_nodes += nodes + qnodes;
-
-	t_chess_time end_time = time_now();
-
-	if (end_time > start_time)
-		printf(INFO_STRING_PERFT_SPEED, global_nodes, end_time - start_time, 1000 * global_nodes / (end_time - start_time));
-	
-}
-
 BOOL test_book()
 {
     struct t_move_record *move;
@@ -924,3 +917,25 @@ BOOL test_hash_table()
 
 	return ok;
 }
+
+BOOL test_trace_moves()
+{
+	t_move_list moves[1];
+	char *s;
+	int promotions = 0;
+	BOOL ok = TRUE;
+
+	//-- "trace ... moves" paths must give the same codes as the recorder, promotions included
+	set_fen(position, "1n2k3/P7/8/8/8/8/8/4K3 w - -");
+	generate_legal_moves(position, moves);
+
+	for (int i = 0; i < moves->count; i++) {
+		s = move_as_str(moves->move[i]);
+		ok &= (trace_string_code(s) == trace_move_code(moves->move[i]));
+		ok &= !strcmp(trace_code_string(trace_move_code(moves->move[i])), s);
+		promotions += (moves->move[i]->promote_to != 0);
+	}
+	ok &= (promotions == 8);
+
+	return ok;
+}
@@ -0,0 +1,152 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Thin wrappers around the Windows and POSIX threading
+// primitives, so the rest of the engine doesn't have to care
+//===========================================================//
+
+#if defined(_WIN32)
+
+void mutex_init(t_mutex *mutex)
+{
+	InitializeCriticalSection(mutex);
+}
+
+void mutex_lock(t_mutex *mutex)
+{
+	EnterCriticalSection(mutex);
+}
+
+void mutex_unlock(t_mutex *mutex)
+{
+	LeaveCriticalSection(mutex);
+}
+
+void condition_init(t_condition *condition)
+{
+	InitializeConditionVariable(condition);
+}
+
+void condition_wait(t_condition *condition, t_mutex *mutex)
+{
+	SleepConditionVariableCS(condition, mutex, INFINITE);
+}
+
+void condition_timed_wait(t_condition *condition, t_mutex *mutex, long milliseconds)
+{
+	SleepConditionVariableCS(condition, mutex, milliseconds > 0 ? milliseconds : 0);
+}
+
+void condition_broadcast(t_condition *condition)
+{
+	WakeAllConditionVariable(condition);
+}
+
+void thread_create(t_thread *thread, unsigned (__stdcall *function)(void *), void *argument)
+{
+	*thread = (HANDLE)_beginthreadex(NULL, 0, function, argument, 0, NULL);
+}
+
+void thread_join(t_thread thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+#else
+
+void mutex_init(t_mutex *mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+void mutex_lock(t_mutex *mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+void mutex_unlock(t_mutex *mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+void condition_init(t_condition *condition)
+{
+#if defined(__linux__)
+	//-- Timed waits are measured on the monotonic clock
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(condition, &attributes);
+	pthread_condattr_destroy(&attributes);
+#else
+	pthread_cond_init(condition, NULL);
+#endif
+}
+
+void condition_wait(t_condition *condition, t_mutex *mutex)
+{
+	pthread_cond_wait(condition, mutex);
+}
+
+void condition_timed_wait(t_condition *condition, t_mutex *mutex, long milliseconds)
+{
+	struct timespec ts;
+
+	if (milliseconds < 0)
+		milliseconds = 0;
+
+#if defined(__linux__)
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += milliseconds / 1000;
+	ts.tv_nsec += (milliseconds % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(condition, mutex, &ts);
+#else
+	//-- OSX has no monotonic condition variables, but it does have relative waits
+	ts.tv_sec = milliseconds / 1000;
+	ts.tv_nsec = (milliseconds % 1000) * 1000000;
+	pthread_cond_timedwait_relative_np(condition, mutex, &ts);
+#endif
+}
+
+void condition_broadcast(t_condition *condition)
+{
+	pthread_cond_broadcast(condition);
+}
+
+void thread_create(t_thread *thread, unsigned (__stdcall *function)(void *), void *argument)
+{
+	pthread_create(thread, NULL, (void *(*)(void *))function, argument);
+}
+
+void thread_join(t_thread thread)
+{
+	pthread_join(thread, NULL);
+}
+
+#endif
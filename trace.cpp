@@ -0,0 +1,556 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Search Trace
+//
+//   trace <file> [nodes n] [moves m1 m2 ...]
+//   analyzetrace <file>
+//
+// "trace" arms the recorder for the next search.  Every node
+// entered and left, and every pruning decision, is written
+// as a fixed size binary record into a per-thread buffer,
+// which goes to the file when the search ends.  Recording
+// stops after the node budget and can be limited to the
+// subtree under a sequence of moves from the root.
+//
+// "analyzetrace" reads a trace back and reports re-search
+// hotspots, pruning decisions contradicted by a later search
+// of the same position, and the work done before a cutoff.
+//===========================================================//
+
+static const char trace_magic[8] = { 'M', 'A', 'V', 'T', 'R', 'A', 'C', 'E' };
+static const char *prune_name[PRUNE_REASONS] = { "hash", "beta pruning", "razoring", "null move", "ETC", "futility" };
+static const char *trace_node_type_name[NODE_TYPES] = { "cut", "super-cut", "pv", "lite-all", "super-all", "all" };
+
+//-- Settings from the "trace" command (picked up by the next search)
+static char trace_filename[FILENAME_MAX];
+static unsigned int trace_budget;
+static unsigned short trace_path[TRACE_MAX_PATH];
+static int trace_path_length;
+#ifdef USE_SEARCH_TRACE
+static BOOL trace_armed = FALSE;
+#endif
+
+//-- Promotion piece letters indexed by piece type (KNIGHT = 1 to QUEEN = 4)
+static const char trace_promotion[] = " nbrq";
+
+//-- Move code as recorded: from, to and the promotion piece type
+unsigned short trace_move_code(struct t_move_record *move)
+{
+    if (move == NULL)
+        return 0;
+    return (unsigned short)(move->from_square | (move->to_square << 6) | ((move->promote_to ? PIECETYPE(move->promote_to) : 0) << 12));
+}
+
+//-- Move code from a string such as "e7e8q"
+unsigned short trace_string_code(const char *s)
+{
+    unsigned short code;
+    const char *p;
+
+    if (strlen(s) < 4)
+        return 0;
+    code = (unsigned short)((s[0] - 'a') + 8 * (s[1] - '1'));
+    code |= (unsigned short)(((s[2] - 'a') + 8 * (s[3] - '1')) << 6);
+    if (s[4] && (p = strchr(trace_promotion + 1, s[4])) != NULL)
+        code |= (unsigned short)((p - trace_promotion) << 12);
+    return code;
+}
+
+char *trace_code_string(unsigned short code)
+{
+    static char s[8];
+    int promote = code >> 12;
+
+    if (code == 0)
+        return (char *)"null";
+    s[0] = 'a' + (code & 7);
+    s[1] = '1' + ((code >> 3) & 7);
+    s[2] = 'a' + ((code >> 6) & 7);
+    s[3] = '1' + ((code >> 9) & 7);
+    s[4] = (promote >= KNIGHT && promote <= QUEEN) ? trace_promotion[promote] : '\0';
+    s[5] = '\0';
+    return s;
+}
+
+void uci_trace(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    char *word[64];
+    int i, n;
+
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    if (n < 2) {
+        send_info("Usage: trace <file> [nodes n] [moves m1 m2 ...]");
+        return;
+    }
+
+    strncpy(trace_filename, word[1], FILENAME_MAX - 1);
+    trace_budget = TRACE_DEFAULT_NODES;
+    trace_path_length = 0;
+    for (i = 2; i < n; i++) {
+        if (!strcmp(word[i], "nodes") && i < n - 1)
+            trace_budget = (unsigned int)atoi(word[++i]);
+        else if (!strcmp(word[i], "moves")) {
+            while (i < n - 1 && trace_path_length < TRACE_MAX_PATH)
+                trace_path[trace_path_length++] = trace_string_code(word[++i]);
+        }
+    }
+
+#ifdef USE_SEARCH_TRACE
+    trace_armed = TRUE;
+    snprintf(s, sizeof(s), "Tracing the next search to %.900s (%u nodes, %d move path)", trace_filename, trace_budget, trace_path_length);
+#else
+    sprintf(s, "Tracing needs a build with USE_SEARCH_TRACE");
+#endif
+    send_info(s);
+}
+
+#ifdef USE_SEARCH_TRACE
+
+//===========================================================//
+// Recorder (runs on the search thread)
+//===========================================================//
+
+static THREAD_LOCAL BOOL trace_active;
+static THREAD_LOCAL struct t_trace_record *trace_buffer;
+static THREAD_LOCAL size_t trace_count;
+static THREAD_LOCAL size_t trace_capacity;
+static THREAD_LOCAL unsigned int trace_nodes;
+static THREAD_LOCAL unsigned int trace_open;				// Nodes entered but not left (their exits are reserved)
+static THREAD_LOCAL unsigned int trace_current;
+static THREAD_LOCAL BOOL trace_in_subtree;
+
+void trace_search_start()
+{
+    trace_active = FALSE;
+    if (!trace_armed)
+        return;
+    trace_armed = FALSE;
+
+    trace_capacity = 3 * (size_t)trace_budget + 2 * (MAXPLY + 1);
+    trace_buffer = (struct t_trace_record *)malloc(trace_capacity * sizeof(struct t_trace_record));
+    if (trace_buffer == NULL) {
+        send_info("Trace: not enough memory for the trace buffer");
+        return;
+    }
+
+    trace_count = 0;
+    trace_nodes = 0;
+    trace_open = 0;
+    trace_current = 0;
+    trace_in_subtree = TRUE;
+    trace_active = TRUE;
+}
+
+void trace_search_end()
+{
+    static char s[1024];
+    struct t_trace_header header;
+    FILE *f;
+
+    if (!trace_active)
+        return;
+    trace_active = FALSE;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, trace_magic, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(struct t_trace_record);
+    header.count = trace_count;
+
+    if ((f = fopen(trace_filename, "wb")) != NULL) {
+        fwrite(&header, sizeof(header), 1, f);
+        fwrite(trace_buffer, sizeof(struct t_trace_record), trace_count, f);
+        fclose(f);
+        snprintf(s, sizeof(s), "Trace: %u nodes (%llu records) written to %.900s", trace_nodes, (unsigned long long)trace_count, trace_filename);
+    }
+    else
+        snprintf(s, sizeof(s), "Trace: unable to write %.900s", trace_filename);
+    send_info(s);
+
+    free(trace_buffer);
+    trace_buffer = NULL;
+}
+
+static inline struct t_trace_record *trace_record(t_trace_event event, struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta)
+{
+    struct t_trace_record *r = &trace_buffer[trace_count++];
+
+    r->hash = board->hash;
+    r->event = (uchar)event;
+    r->ply = (uchar)ply;
+    r->depth = (signed char)max(-128, min(127, depth));
+    r->alpha = alpha;
+    r->beta = beta;
+    r->score = 0;
+    r->move = 0;
+    r->node_type = 0;
+    r->reduction = 0;
+    r->reason = 0;
+    return r;
+}
+
+void trace_enter(struct t_trace_frame *frame, struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta)
+{
+    struct t_move_record *move;
+    struct t_trace_record *r;
+
+    frame->node = 0;
+    frame->parent = trace_current;
+    frame->in_subtree = trace_in_subtree;
+
+    if (!trace_active || !trace_in_subtree)
+        return;
+
+    //-- Only follow the chosen path from the root
+    move = (ply > 0) ? board->pv_data[ply - 1].current_move : NULL;
+    if (ply > 0 && ply <= trace_path_length && trace_move_code(move) != trace_path[ply - 1]) {
+        trace_in_subtree = FALSE;
+        return;
+    }
+
+    //-- Out of budget (leaving room for the exits of the open nodes)
+    if (trace_nodes >= trace_budget || trace_count + trace_open + 2 >= trace_capacity)
+        return;
+
+    frame->node = ++trace_nodes;
+    trace_current = frame->node;
+    trace_open++;
+
+    r = trace_record(trace_event_enter, board, ply, depth, alpha, beta);
+    r->node = frame->node;
+    r->parent = frame->parent;
+    r->move = trace_move_code(move);
+    r->reduction = (move != NULL) ? (uchar)board->pv_data[ply - 1].reduction : 0;
+}
+
+void trace_exit(struct t_trace_frame *frame, struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, t_chess_value score)
+{
+    struct t_trace_record *r;
+
+    trace_current = frame->parent;
+    trace_in_subtree = frame->in_subtree;
+
+    if (frame->node == 0)
+        return;
+
+    trace_open--;
+    r = trace_record(trace_event_exit, board, ply, depth, alpha, beta);
+    r->node = frame->node;
+    r->parent = frame->parent;
+    r->score = score;
+    r->node_type = (uchar)board->pv_data[ply].node_type;
+}
+
+void trace_prune(struct t_board *board, int ply, int depth, t_chess_value alpha, t_chess_value beta, t_chess_value score, t_prune_reason reason, struct t_move_record *move)
+{
+    struct t_trace_record *r;
+
+    if (!trace_active || trace_current == 0 || trace_count + trace_open + 1 >= trace_capacity)
+        return;
+
+    r = trace_record(trace_event_prune, board, ply, depth, alpha, beta);
+    r->node = trace_current;
+    r->score = score;
+    r->reason = (uchar)reason;
+    r->move = trace_move_code(move);
+    r->node_type = (uchar)board->pv_data[ply].node_type;
+}
+
+#endif
+
+//===========================================================//
+// Analyzer
+//===========================================================//
+
+struct t_trace_frame_stats
+{
+    unsigned int							node;
+    int										ply;
+    int										depth;
+    unsigned short							move;
+    unsigned long long						first_enter;		// Number of nodes entered before this one
+    unsigned long long						children;			// Nodes in all of the subtrees below
+    unsigned long long						last_child;			// Nodes in the last child's subtree
+    unsigned short							last_move;
+    int										last_child_ply;
+    unsigned long long						research_nodes;		// Nodes in searches which were repeated
+    int										researches;
+};
+
+struct t_trace_pending_prune
+{
+    t_hash									hash;
+    unsigned int							node;
+    int										depth;
+    t_chess_value							alpha;
+    t_chess_value							beta;
+    t_chess_value							score;
+    int										reason;
+};
+
+struct t_trace_hotspot
+{
+    unsigned int							node;
+    int										ply;
+    int										depth;
+    int										node_type;
+    unsigned short							move;
+    unsigned long long						nodes;
+    int										count;
+};
+
+static void add_hotspot(struct t_trace_hotspot *list, struct t_trace_hotspot *h)
+{
+    int i, j;
+
+    for (i = 0; i < TRACE_HOTSPOTS; i++) {
+        if (h->nodes > list[i].nodes) {
+            for (j = TRACE_HOTSPOTS - 1; j > i; j--)
+                list[j] = list[j - 1];
+            list[i] = *h;
+            return;
+        }
+    }
+}
+
+static void report_hotspots(const char *title, struct t_trace_hotspot *list, const char *what)
+{
+    static char s[1024];
+    int i;
+
+    send_info(title);
+    for (i = 0; i < TRACE_HOTSPOTS && list[i].nodes > 0; i++) {
+        sprintf(s, "  node %u ply %d depth %d %s after %s: %llu nodes %s (%d)", list[i].node, list[i].ply, list[i].depth,
+            trace_node_type_name[list[i].node_type % NODE_TYPES], trace_code_string(list[i].move), list[i].nodes, what, list[i].count);
+        send_info(s);
+    }
+}
+
+BOOL analyze_trace(char *command)
+{
+    static char s[1024];
+    static struct t_trace_frame_stats stack[2 * MAXPLY + 2];
+    static struct t_trace_hotspot research_hotspot[TRACE_HOTSPOTS];
+    static struct t_trace_hotspot wasted_hotspot[TRACE_HOTSPOTS];
+    struct t_trace_header header;
+    struct t_trace_record *record, *r;
+    struct t_trace_pending_prune *pending;
+    struct t_trace_frame_stats *frame, *parent;
+    struct t_trace_hotspot hotspot;
+    unsigned long long prunes[PRUNE_REASONS] = { 0 }, checked[PRUNE_REASONS] = { 0 }, failed[PRUNE_REASONS] = { 0 };
+    unsigned long long research_nodes[NODE_TYPES] = { 0 }, researches[NODE_TYPES] = { 0 };
+    unsigned long long wasted_nodes[NODE_TYPES] = { 0 }, cutoffs[NODE_TYPES] = { 0 };
+    unsigned long long enters = 0, exits = 0, size, total_research = 0, total_wasted = 0;
+    size_t pending_mask, i, j;
+    int top = 0, max_ply = 0, k;
+    char *word[4];
+    FILE *f;
+
+    strncpy(s, command, sizeof(s) - 1);
+    if (split_words(s, word, 4) < 2) {
+        send_info("Usage: analyzetrace <file>");
+        return FALSE;
+    }
+    if ((f = fopen(word[1], "rb")) == NULL) {
+        send_info("Trace: unable to open the file");
+        return FALSE;
+    }
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, trace_magic, sizeof(trace_magic)) || header.version != TRACE_VERSION
+        || header.record_size != sizeof(struct t_trace_record)) {
+        send_info("Trace: not a trace file from this version of Maverick");
+        fclose(f);
+        return FALSE;
+    }
+
+    record = (struct t_trace_record *)malloc((size_t)header.count * sizeof(struct t_trace_record) + 1);
+    if (record == NULL || fread(record, sizeof(struct t_trace_record), (size_t)header.count, f) != header.count) {
+        send_info("Trace: unable to read the records");
+        free(record);
+        fclose(f);
+        return FALSE;
+    }
+    fclose(f);
+
+    //-- Pruning decisions waiting to be checked, by hash
+    for (pending_mask = 1024; pending_mask < 2 * header.count; pending_mask <<= 1);
+    pending = (struct t_trace_pending_prune *)calloc(pending_mask, sizeof(struct t_trace_pending_prune));
+    if (pending == NULL) {
+        send_info("Trace: not enough memory to analyze the trace");
+        free(record);
+        return FALSE;
+    }
+    pending_mask--;
+    memset(research_hotspot, 0, sizeof(research_hotspot));
+    memset(wasted_hotspot, 0, sizeof(wasted_hotspot));
+
+    for (i = 0; i < header.count; i++) {
+        r = &record[i];
+
+        switch (r->event) {
+
+        case trace_event_enter:
+            if (top >= (int)(sizeof(stack) / sizeof(stack[0])))
+                break;
+            frame = &stack[top++];
+            memset(frame, 0, sizeof(struct t_trace_frame_stats));
+            frame->node = r->node;
+            frame->ply = r->ply;
+            frame->depth = r->depth;
+            frame->move = r->move;
+            frame->first_enter = enters++;
+            frame->last_child_ply = -1;
+            max_ply = max(max_ply, (int)r->ply);
+
+            //-- The same move searched again from the same node is a re-search
+            if (top > 1) {
+                parent = &stack[top - 2];
+                if (parent->last_child_ply == r->ply && parent->last_move == r->move && r->ply == parent->ply + 1) {
+                    parent->research_nodes += parent->last_child;
+                    parent->researches++;
+                }
+            }
+            break;
+
+        case trace_event_exit:
+            if (top == 0 || stack[top - 1].node != r->node)
+                break;
+            frame = &stack[--top];
+            exits++;
+            size = enters - frame->first_enter;
+
+            //-- Work done before the move which caused a cutoff
+            if (r->score >= r->beta && frame->children > frame->last_child) {
+                k = r->node_type % NODE_TYPES;
+                wasted_nodes[k] += frame->children - frame->last_child;
+                cutoffs[k]++;
+                total_wasted += frame->children - frame->last_child;
+
+                hotspot.node = r->node;
+                hotspot.ply = r->ply;
+                hotspot.depth = r->depth;
+                hotspot.node_type = k;
+                hotspot.move = frame->move;
+                hotspot.nodes = frame->children - frame->last_child;
+                hotspot.count = 1;
+                add_hotspot(wasted_hotspot, &hotspot);
+            }
+
+            //-- Re-searches made from this node
+            if (frame->researches) {
+                k = r->node_type % NODE_TYPES;
+                research_nodes[k] += frame->research_nodes;
+                researches[k] += frame->researches;
+                total_research += frame->research_nodes;
+
+                hotspot.node = r->node;
+                hotspot.ply = r->ply;
+                hotspot.depth = r->depth;
+                hotspot.node_type = k;
+                hotspot.move = frame->move;
+                hotspot.nodes = frame->research_nodes;
+                hotspot.count = frame->researches;
+                add_hotspot(research_hotspot, &hotspot);
+            }
+
+            //-- Check any earlier pruning decision on the same position
+            j = r->hash & pending_mask;
+            while (pending[j].hash != 0 && pending[j].hash != r->hash)
+                j = (j + 1) & pending_mask;
+            if (pending[j].hash == r->hash && pending[j].node != r->node && r->depth >= pending[j].depth) {
+                k = pending[j].reason;
+                checked[k]++;
+                if (pending[j].score >= pending[j].beta && r->score < pending[j].beta && r->score < r->beta)
+                    failed[k]++;
+                else if (pending[j].score <= pending[j].alpha && r->score > pending[j].alpha && r->score > r->alpha)
+                    failed[k]++;
+                pending[j].node = r->node;
+                pending[j].reason = -1;
+                pending[j].depth = 256;
+            }
+
+            //-- Pass the size up to the parent
+            if (top > 0) {
+                parent = &stack[top - 1];
+                parent->children += size;
+                parent->last_child = size;
+                parent->last_move = frame->move;
+                parent->last_child_ply = r->ply;
+            }
+            break;
+
+        case trace_event_prune:
+            if (r->reason >= PRUNE_REASONS)
+                break;
+            prunes[r->reason]++;
+
+            //-- Futility is per move, and a score inside the window isn't a bound, so neither can be checked
+            if (r->reason == prune_futility || (r->score < r->beta && r->score > r->alpha))
+                break;
+            j = r->hash & pending_mask;
+            while (pending[j].hash != 0 && pending[j].hash != r->hash)
+                j = (j + 1) & pending_mask;
+            pending[j].hash = r->hash;
+            pending[j].node = r->node;
+            pending[j].depth = r->depth;
+            pending[j].alpha = r->alpha;
+            pending[j].beta = r->beta;
+            pending[j].score = r->score;
+            pending[j].reason = r->reason;
+            break;
+        }
+    }
+
+    //-- Report
+    sprintf(s, "Trace: %llu nodes, %llu finished, deepest ply %d, %llu records", enters, exits, max_ply, (unsigned long long)header.count);
+    send_info(s);
+
+    strcpy(s, "Pruning (pruned/checked later/contradicted):");
+    for (k = 0; k < PRUNE_REASONS; k++) {
+        char t[128];
+        sprintf(t, " %s %llu/%llu/%llu", prune_name[k], prunes[k], checked[k], failed[k]);
+        strcat(s, t);
+    }
+    send_info(s);
+
+    sprintf(s, "Re-searches: %llu nodes (%.1f%% of the tree) in searches which were repeated; by node type:", total_research,
+        enters ? 100.0 * total_research / enters : 0.0);
+    for (k = 0; k < NODE_TYPES; k++) {
+        char t[128];
+        sprintf(t, " %s %llu/%llu", trace_node_type_name[k], researches[k], research_nodes[k]);
+        strcat(s, t);
+    }
+    send_info(s);
+
+    sprintf(s, "Before cutoffs: %llu nodes (%.1f%% of the tree) searched ahead of the refuting move; by node type:", total_wasted,
+        enters ? 100.0 * total_wasted / enters : 0.0);
+    for (k = 0; k < NODE_TYPES; k++) {
+        char t[128];
+        sprintf(t, " %s %llu/%llu", trace_node_type_name[k], cutoffs[k], wasted_nodes[k]);
+        strcat(s, t);
+    }
+    send_info(s);
+
+    report_hotspots("Re-search hotspots:", research_hotspot, "re-searched");
+    report_hotspots("Largest subtrees wasted before a cutoff:", wasted_hotspot, "before the cutoff");
+
+    free(pending);
+    free(record);
+    return TRUE;
+}
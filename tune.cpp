@@ -0,0 +1,458 @@
+//===========================================================//
+//
+// Maverick Chess Engine
+// Copyright 2013-2015 Steve Maughan
+//
+//===========================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "defs.h"
+#include "data.h"
+#include "procs.h"
+
+//===========================================================//
+// Texel Tuning
+//
+//   tune <file> [threads n] [passes n] [k x] [step n]
+//        [limit n] [output file] [params name ...]
+//
+// Tunes the evaluation parameters (all of them, or those with
+// one of the names in them) to predict the results of a file
+// of positions: a datagen file or EPD lines with a result
+// ("1-0", "0-1", "1/2-1/2", "[1.0]", "[0.5]" or "[0.0]").
+// Each position is replaced by the end of its quiescent
+// search's PV once (fixed_qsearch(), which leaves the hash
+// table alone), so every step after that is just the static
+// evaluation of every position, shared between the threads.  The error is the mean squared difference between
+// the result and 1 / (1 + 10^(-k * score / 400)), with k
+// fitted first unless it's given.  Each pass tries every
+// value +/- step and keeps whatever lowers the error.
+//===========================================================//
+
+static struct t_tune_position *tune_position;
+static int tune_positions;
+static double tune_k;
+
+//-- The thread pool
+static t_mutex tune_mutex;
+static t_condition tune_condition;
+static t_tune_job tune_job;
+static int tune_generation;
+static int tune_done;
+static int tune_threads;
+static double tune_partial[TUNE_MAX_THREADS];
+
+static const char *tune_keyword[] = { "threads", "passes", "k", "step", "limit", "output", "params", NULL };
+
+static BOOL is_tune_keyword(char *s)
+{
+    int i;
+
+    for (i = 0; tune_keyword[i] != NULL; i++)
+        if (!strcmp(s, tune_keyword[i]))
+            return TRUE;
+    return FALSE;
+}
+
+//-- Replaces the positions with the quiet positions at the end of their quiescent search's PV (results below zero are dropped)
+static double tune_resolve(struct t_board *board, int first, int last)
+{
+    struct t_tune_position *p;
+    struct t_move_list moves[1];
+    struct t_move_record *move;
+    struct t_undo undo[1];
+    t_chess_value score;
+    double dropped = 0;
+    int i, j;
+
+    for (p = tune_position + first; p < tune_position + last; p++) {
+        unpack_position(board, &p->position);
+
+        clear_killers(board);
+        board->pv_data[1].best_line_length = 1;
+
+        evaluate(board, board->pv_data[1].eval);
+        score = fixed_qsearch(board, 1, 0, -CHECKMATE, CHECKMATE, TRUE);
+
+        //-- Follow the PV for as long as it's legal
+        for (i = 1; i < board->pv_data[1].best_line_length && i < MAXPLY; i++) {
+            move = board->pv_data[1].best_line[i];
+            generate_legal_moves(board, moves);
+            for (j = 0; j < moves->count && moves->move[j] != move; j++)
+                ;
+            if (j == moves->count)
+                break;
+            make_move(board, moves->pinned_pieces, move, undo);
+        }
+
+        //-- Mates and checks aren't quiet
+        if (score >= MAX_CHECKMATE || score <= -MAX_CHECKMATE || board->in_check) {
+            p->result = -1;
+            dropped++;
+        }
+        else
+            pack_position(board, &p->position);
+    }
+
+    return dropped;
+}
+
+static double tune_error_sum(struct t_board *board, int first, int last)
+{
+    struct t_tune_position *p;
+    t_chess_value score;
+    double sigmoid, sum = 0;
+
+    for (p = tune_position + first; p < tune_position + last; p++) {
+        unpack_position(board, &p->position);
+        score = evaluate(board, board->pv_data[1].eval);
+        if (board->to_move == BLACK)
+            score = -score;
+        sigmoid = 1.0 / (1.0 + pow(10.0, -tune_k * score / 400.0));
+        sum += (p->result - sigmoid) * (p->result - sigmoid);
+    }
+
+    return sum;
+}
+
+static unsigned __stdcall tune_worker(void* pArguments)
+{
+    int index = (int)(size_t)pArguments;
+    struct t_board *board = (struct t_board *)malloc(sizeof(struct t_board));
+    int generation = 0;
+    int first, last;
+    t_tune_job job;
+    double sum;
+
+    numa_init_thread(index);
+    init_board(board);
+
+    mutex_lock(&tune_mutex);
+    for (;;) {
+        while (tune_generation == generation)
+            condition_wait(&tune_condition, &tune_mutex);
+        generation = tune_generation;
+        job = tune_job;
+        if (job == TUNE_QUIT)
+            break;
+        mutex_unlock(&tune_mutex);
+
+        first = (int)((long long)tune_positions * index / tune_threads);
+        last = (int)((long long)tune_positions * (index + 1) / tune_threads);
+
+        //-- Pawn structure scores from before the last change are no good
+        if (pawn_hash_version != eval_params_version)
+            clear_pawn_hash();
+
+        sum = (job == TUNE_RESOLVE) ? tune_resolve(board, first, last) : tune_error_sum(board, first, last);
+
+        mutex_lock(&tune_mutex);
+        tune_partial[index] = sum;
+        tune_done++;
+        condition_broadcast(&tune_condition);
+    }
+    mutex_unlock(&tune_mutex);
+
+    numa_exit_thread();
+    free(board);
+    return 0;
+}
+
+//-- Runs a job on every thread and adds up what they return
+static double tune_run(t_tune_job job)
+{
+    double sum = 0;
+    int i;
+
+    mutex_lock(&tune_mutex);
+    tune_job = job;
+    tune_done = 0;
+    tune_generation++;
+    condition_broadcast(&tune_condition);
+    if (job != TUNE_QUIT)
+        while (tune_done < tune_threads)
+            condition_wait(&tune_condition, &tune_mutex);
+    mutex_unlock(&tune_mutex);
+
+    for (i = 0; job != TUNE_QUIT && i < tune_threads; i++)
+        sum += tune_partial[i];
+    return sum;
+}
+
+static double tune_error()
+{
+    return tune_run(TUNE_ERROR) / tune_positions;
+}
+
+//-- Finds the k which fits the scores to the results best (golden section search)
+static void tune_fit_k()
+{
+    const double phi = 0.6180339887;
+    double a = 0.1, b = 3.0, c, d, ec, ed;
+    int i;
+
+    c = b - phi * (b - a);
+    d = a + phi * (b - a);
+    tune_k = c;
+    ec = tune_error();
+    tune_k = d;
+    ed = tune_error();
+    for (i = 0; i < 24; i++) {
+        if (ec < ed) {
+            b = d;
+            d = c;
+            ed = ec;
+            c = b - phi * (b - a);
+            tune_k = c;
+            ec = tune_error();
+        }
+        else {
+            a = c;
+            c = d;
+            ec = ed;
+            d = a + phi * (b - a);
+            tune_k = d;
+            ed = tune_error();
+        }
+    }
+    tune_k = (a + b) / 2;
+}
+
+//-- The result at the end of an EPD line (-1 if there isn't one)
+static float tune_epd_result(char *s)
+{
+    if (strstr(s, "1/2-1/2") != NULL || strstr(s, "[0.5]") != NULL)
+        return 0.5f;
+    if (strstr(s, "1-0") != NULL || strstr(s, "[1.0]") != NULL)
+        return 1.0f;
+    if (strstr(s, "0-1") != NULL || strstr(s, "[0.0]") != NULL)
+        return 0.0f;
+    return -1.0f;
+}
+
+static BOOL tune_add_position(struct t_datagen_record *record, float result, int *size)
+{
+    if (tune_positions == *size) {
+        if (*size >= TUNE_MAX_POSITIONS)
+            return FALSE;
+        *size = min(2 * *size + 65536, TUNE_MAX_POSITIONS);
+        tune_position = (struct t_tune_position *)realloc(tune_position, *size * sizeof(struct t_tune_position));
+    }
+    tune_position[tune_positions].position = *record;
+    tune_position[tune_positions].result = result;
+    tune_positions++;
+    return TRUE;
+}
+
+static BOOL tune_load(char *filename, int limit, struct t_board *board)
+{
+    static char line[1024];
+    static char fen[1024];
+    struct t_datagen_reader reader[1];
+    struct t_datagen_record record[1];
+    char copy[1024];
+    char *word[4];
+    float result;
+    int n, size = 0;
+    FILE *f;
+
+    //-- A datagen file
+    if (open_datagen_reader(reader, filename)) {
+        while ((limit == 0 || tune_positions < limit) && read_datagen_record(reader, record))
+            if (!tune_add_position(record, (record->result + 1) / 2.0f, &size))
+                break;
+        close_datagen_reader(reader);
+        return TRUE;
+    }
+
+    //-- EPD
+    if ((f = fopen(filename, "r")) == NULL)
+        return FALSE;
+    while ((limit == 0 || tune_positions < limit) && fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        strcpy(copy, line);
+        n = split_words(copy, word, 4);
+        if (!is_valid_fen(word, n))
+            continue;
+        if ((result = tune_epd_result(line + (word[3] - copy) + strlen(word[3]))) < 0)
+            continue;
+        snprintf(fen, sizeof(fen), "%s %s %s %s", word[0], word[1], word[2], word[3]);
+        set_fen(board, fen);
+        if (is_in_check(board, OPPONENT(board->to_move)))
+            continue;
+        pack_position(board, record);
+        if (!tune_add_position(record, result, &size))
+            break;
+    }
+    fclose(f);
+    return TRUE;
+}
+
+BOOL tune_eval(char *command)
+{
+    static char options[1024];
+    static char s[1024];
+    static t_thread thread[TUNE_MAX_THREADS];
+    static struct t_board board[1];
+    static struct t_eval_param *selected[256];
+    struct t_eval_param *p;
+    char *word[64];
+    char *filename = NULL;
+    char *output = NULL;
+    char *params[64];
+    int param_count = 0;
+    int selected_count = 0;
+    int passes = TUNE_DEFAULT_PASSES;
+    int step = 1;
+    int limit = 0;
+    int i, j, n, pass, v, changed, total_changed = 0;
+    double error, e, k = 0;
+    unsigned long long start;
+    BOOL improved;
+
+    //-- Options
+    tune_threads = numa.cpu_count;
+    strncpy(options, command, sizeof(options) - 1);
+    n = split_words(options, word, 64);
+    for (i = 1; i < n; i++) {
+        if (!strcmp(word[i], "threads") && i < n - 1)
+            tune_threads = atoi(word[++i]);
+        else if (!strcmp(word[i], "passes") && i < n - 1)
+            passes = atoi(word[++i]);
+        else if (!strcmp(word[i], "k") && i < n - 1)
+            k = atof(word[++i]);
+        else if (!strcmp(word[i], "step") && i < n - 1)
+            step = atoi(word[++i]);
+        else if (!strcmp(word[i], "limit") && i < n - 1)
+            limit = atoi(word[++i]);
+        else if (!strcmp(word[i], "output") && i < n - 1)
+            output = word[++i];
+        else if (!strcmp(word[i], "params")) {
+            while (i < n - 1 && !is_tune_keyword(word[i + 1]))
+                params[param_count++] = word[++i];
+        }
+        else if (filename == NULL)
+            filename = word[i];
+    }
+    tune_threads = max(1, min(tune_threads, TUNE_MAX_THREADS));
+    step = max(1, step);
+
+    if (filename == NULL) {
+        send_info("Tune: tune <file> [threads n] [passes n] [k x] [step n] [limit n] [output file] [params name ...]");
+        return FALSE;
+    }
+
+    //-- The parameters to tune
+    for (p = eval_param; p->name != NULL; p++) {
+        for (i = 0; i < param_count && strstr(p->name, params[i]) == NULL; i++)
+            ;
+        if (param_count == 0 || i < param_count)
+            selected[selected_count++] = p;
+    }
+    if (selected_count == 0) {
+        send_info("Tune: no parameters match");
+        return FALSE;
+    }
+
+    uci_wait_for_search();
+
+    //-- Standard castling tables and a search which isn't stopped
+    init_board(board);
+    new_game(board);
+    uci.stop = FALSE;
+
+    tune_position = NULL;
+    tune_positions = 0;
+    if (!tune_load(filename, limit, board) || tune_positions == 0) {
+        snprintf(s, sizeof(s), "Tune: no positions with results in %s", filename);
+        send_info(s);
+        free(tune_position);
+        return FALSE;
+    }
+
+    tune_generation = 0;
+    mutex_init(&tune_mutex);
+    condition_init(&tune_condition);
+    for (i = 0; i < tune_threads; i++)
+        thread_create(&thread[i], tune_worker, (void *)(size_t)i);
+
+    //-- Quiet positions (once)
+    start = time_now_ns();
+    tune_run(TUNE_RESOLVE);
+    for (i = j = 0; i < tune_positions; i++)
+        if (tune_position[i].result >= 0)
+            tune_position[j++] = tune_position[i];
+    snprintf(s, sizeof(s), "Tune: %d quiet positions (%d dropped) in %.2f seconds", j, tune_positions - j, (time_now_ns() - start) / 1e9);
+    send_info(s);
+    tune_positions = j;
+
+    if (tune_positions > 0) {
+        if (k > 0)
+            tune_k = k;
+        else
+            tune_fit_k();
+        error = tune_error();
+        snprintf(s, sizeof(s), "Tune: k = %.4f, error = %.8f, %d parameters", tune_k, error, selected_count);
+        send_info(s);
+
+        //-- Local search
+        for (pass = 1, improved = TRUE; improved && pass <= passes; pass++) {
+            start = time_now_ns();
+            improved = FALSE;
+            changed = 0;
+            for (i = 0; i < selected_count; i++) {
+                p = selected[i];
+                for (j = 0; j < p->count; j++) {
+                    v = p->value[j];
+
+                    p->value[j] = v + step;
+                    apply_eval_params();
+                    if ((e = tune_error()) < error) {
+                        error = e;
+                        improved = TRUE;
+                        changed++;
+                        continue;
+                    }
+
+                    p->value[j] = v - step;
+                    apply_eval_params();
+                    if ((e = tune_error()) < error) {
+                        error = e;
+                        improved = TRUE;
+                        changed++;
+                        continue;
+                    }
+
+                    p->value[j] = v;
+                }
+            }
+            apply_eval_params();
+            total_changed += changed;
+
+            if (output != NULL)
+                save_eval_params(output);
+            snprintf(s, sizeof(s), "Tune: pass %d, error = %.8f, %d values changed in %.1f seconds", pass, error, changed, (time_now_ns() - start) / 1e9);
+            send_info(s);
+        }
+    }
+
+    tune_run(TUNE_QUIT);
+    for (i = 0; i < tune_threads; i++)
+        thread_join(thread[i]);
+    free(tune_position);
+    tune_position = NULL;
+
+    //-- The hash table's scores are from the old evaluation
+    if (total_changed > 0)
+        clear_hash();
+
+    if (output != NULL) {
+        snprintf(s, sizeof(s), save_eval_params(output) ? "Tune: saved %s" : "Tune: unable to write %s", output);
+        send_info(s);
+    }
+    return TRUE;
+}
@@ -38,26 +38,150 @@ unsigned threadID;
 
 char input_string[UCI_BUFFER_SIZE];
 
+//-- Guards the hand-off between the UCI thread and the search thread
+t_mutex engine_mutex;
+t_condition engine_condition;
+t_thread timer_thread;
+
 unsigned __stdcall engine_loop(void* pArguments)
 {
-    uci.engine_state = UCI_ENGINE_WAITING;
-    uci.stop = FALSE;
+    //-- Pin the thread (if required) and set up its own tables
+    numa_init_thread(0);
+
+    mutex_lock(&engine_mutex);
     while (!uci.quit) {
-        if (uci.engine_state == UCI_ENGINE_START_THINKING) {
-            root_search(position);
-            uci.stop = FALSE;
-            uci.engine_state = UCI_ENGINE_WAITING;
+
+        //-- Sleep until there's something to think about
+        if (uci.engine_state != UCI_ENGINE_START_THINKING) {
+            condition_wait(&engine_condition, &engine_mutex);
+            continue;
         }
-        else {
-            Sleep(1);
+        mutex_unlock(&engine_mutex);
+
+        if (numa.rebind) {
+            numa.rebind = FALSE;
+            numa_init_thread(0);
         }
+        //-- The evaluation parameters have changed since the pawn hash was filled
+        if (pawn_hash_version != eval_params_version)
+            clear_pawn_hash();
+        root_search(position);
+
+        mutex_lock(&engine_mutex);
+        uci.stop = FALSE;
+        uci.engine_state = UCI_ENGINE_WAITING;
+        condition_broadcast(&engine_condition);
     }
+    mutex_unlock(&engine_mutex);
+
+    numa_exit_thread();
+
 #if defined(_WIN32)
     _endthreadex(0);
 #endif
     return(0);
 }
 
+//-- Is the search limited by the clock (rather than depth, nodes, mate or the user)?
+static BOOL is_time_limited()
+{
+    return !uci.level.ponder && !uci.level.infinite && !uci.level.depth && !uci.level.mate && !uci.level.nodes;
+}
+
+//-- Enforces the time limit and sends the periodic search info, so the search never has to look at the clock
+unsigned __stdcall timer_loop(void* pArguments)
+{
+    static char s[1024];
+    unsigned long t;
+    long wait;
+
+    mutex_lock(&engine_mutex);
+    while (!uci.quit) {
+
+        //-- Nothing to time
+        if (uci.engine_state != UCI_ENGINE_THINKING || uci.stop) {
+            condition_wait(&engine_condition, &engine_mutex);
+            continue;
+        }
+
+        t = time_now();
+
+        //-- Out of time
+        if (is_time_limited() && (long)(t - search_start_time) >= abort_move_time) {
+            uci.stop = TRUE;
+            condition_broadcast(&engine_condition);
+            mutex_unlock(&engine_mutex);
+
+            sprintf(s, INFO_STRING_ABORT, abort_move_time, (long) t - search_start_time, nodes + qnodes + cluster.nodes);
+            send_info(s);
+
+            mutex_lock(&engine_mutex);
+            continue;
+        }
+
+        //-- Keep the GUI up to date
+        if ((long)(t - last_display_update) >= 1000) {
+            last_display_update = t;
+            mutex_unlock(&engine_mutex);
+
+            do_uci_hash_full();
+            do_uci_send_nodes();
+
+            mutex_lock(&engine_mutex);
+            continue;
+        }
+
+        //-- Sleep until the next update or the time limit, whichever is sooner (or something changes)
+        wait = last_display_update + 1000 - t;
+        if (is_time_limited() && search_start_time + abort_move_time - (long)t < wait)
+            wait = search_start_time + abort_move_time - t;
+        condition_timed_wait(&engine_condition, &engine_mutex, wait);
+    }
+    mutex_unlock(&engine_mutex);
+
+    return(0);
+}
+
+void uci_set_engine_state(t_uci_engine_state state)
+{
+    mutex_lock(&engine_mutex);
+    uci.engine_state = state;
+    condition_broadcast(&engine_condition);
+    mutex_unlock(&engine_mutex);
+}
+
+//-- Wait until the search thread is idle
+void uci_wait_for_search()
+{
+    mutex_lock(&engine_mutex);
+    while (uci.engine_state != UCI_ENGINE_WAITING)
+        condition_wait(&engine_condition, &engine_mutex);
+    mutex_unlock(&engine_mutex);
+}
+
+//-- Wait (in the search thread) until a ponder or infinite search is stopped or the ponder move is played
+void uci_wait_for_stop()
+{
+    mutex_lock(&engine_mutex);
+    while ((uci.level.infinite || uci.level.ponder) && !uci.stop)
+        condition_wait(&engine_condition, &engine_mutex);
+    mutex_unlock(&engine_mutex);
+}
+
+void uci_quit()
+{
+    //-- Only stop a search if there is one (uci_stop() complains otherwise)
+    if (uci.engine_state != UCI_ENGINE_WAITING)
+        uci_stop();
+
+    mutex_lock(&engine_mutex);
+    uci.quit = TRUE;
+    condition_broadcast(&engine_condition);
+    mutex_unlock(&engine_mutex);
+
+    thread_join(timer_thread);
+}
+
 void create_uci_engine_thread()
 {
 #if defined(_WIN32)
@@ -68,6 +192,9 @@ void create_uci_engine_thread()
     // pthread_create(&SearchThread, NULL, engine_loop, &threadID);
     pthread_create((pthread_t *)&SearchThread, NULL, (void *(*)(void *))engine_loop, (void *)&threadID);
 #endif
+
+    //-- The timer thread keeps an eye on the clock while the engine is thinking
+    thread_create(&timer_thread, timer_loop, NULL);
 }
 
 void listen_for_uci_input()
@@ -77,7 +204,7 @@ void listen_for_uci_input()
 
     //-- Create a log file if in debug mode
     if (uci.debug)
-        write_log("Maverick's Log File", "maverick-log.txt", TRUE, TRUE);
+        write_log("Maverick's Log File", TRUE);
 
     // Ensure that listening thread has been started
     while (!uci.quit) {
@@ -89,20 +216,22 @@ void listen_for_uci_input()
 
         //-- Create a log file if in debug mode
         if (uci.debug)
-            write_log(input_string, "maverick-log.txt", TRUE, FALSE);
+            write_log(input_string, FALSE);
 
         /*===============================================================*/
         /* QUIT Command
         /*===============================================================*/
-        if (!strcmp(input_string, "quit") || !strcmp(input_string, "QUIT")) {
-            uci_stop();
-            uci.quit = TRUE;
-        }
+        if (!strcmp(input_string, "quit") || !strcmp(input_string, "QUIT"))
+            uci_quit();
         /*===============================================================*/
         /* UCI Command
         /*===============================================================*/
-        if (!strcmp(input_string, "uci") || !strcmp(input_string, "UCI"))
+        if (!strcmp(input_string, "uci") || !strcmp(input_string, "UCI")) {
             uci_set_mode();
+
+            //-- The machine's layout, once the GUI is listening
+            numa_report();
+        }
         /*===============================================================*/
         /* ISREADY Command
         /*===============================================================*/
@@ -150,7 +279,94 @@ void listen_for_uci_input()
 		/* Run a set of benchmark speed tests
 		/*===============================================================*/
 		if ((index_of("bench", input_string) == 0) || (index_of("BENCH", input_string) == 0)) {
-			test_bench();
+			bench(input_string);
+		}
+
+		/*===============================================================*/
+		/* Time the move generator, eval, SEE, hash etc. on their own
+		/*===============================================================*/
+		if ((index_of("microbench", input_string) == 0) || (index_of("MICROBENCH", input_string) == 0)) {
+			micro_bench(input_string);
+		}
+
+		/*===============================================================*/
+		/* Score a file of positions on all threads - "batch qsearch file in.epd output out.epd"
+		/*===============================================================*/
+		if ((index_of("batch", input_string) == 0) || (index_of("BATCH", input_string) == 0)) {
+			batch_evaluate(input_string, FALSE);
+		}
+
+		/*===============================================================*/
+		/* Run an EPD test suite on worker processes - "suite wac.epd movetime 1000 workers 8"
+		/*===============================================================*/
+		if ((index_of("suite", input_string) == 0) || (index_of("SUITE", input_string) == 0)) {
+			run_test_suite(input_string);
+		}
+
+		/*===============================================================*/
+		/* Play self-play games for training data - "datagen games.bin games 10000 nodes 5000"
+		/*===============================================================*/
+		if ((index_of("datagen", input_string) == 0) || (index_of("DATAGEN", input_string) == 0)) {
+			datagen(input_string);
+		}
+
+		/*===============================================================*/
+		/* Print a datagen file as EPD - "datadump games.bin count 100"
+		/*===============================================================*/
+		if ((index_of("datadump", input_string) == 0) || (index_of("DATADUMP", input_string) == 0)) {
+			datagen_dump(input_string);
+		}
+
+		/*===============================================================*/
+		/* Load, save or show the evaluation parameters - "evalparams load tuned.txt"
+		/*===============================================================*/
+		if ((index_of("evalparams", input_string) == 0) || (index_of("EVALPARAMS", input_string) == 0)) {
+			uci_eval_params(input_string);
+		}
+
+		/*===============================================================*/
+		/* Tune the evaluation parameters on a file of positions - "tune games.bin output tuned.txt"
+		/*===============================================================*/
+		if ((index_of("tune", input_string) == 0) || (index_of("TUNE", input_string) == 0)) {
+			tune_eval(input_string);
+		}
+
+		/*===============================================================*/
+		/* Load, save or show the search parameters - "searchparams show Null"
+		/*===============================================================*/
+		if ((index_of("searchparams", input_string) == 0) || (index_of("SEARCHPARAMS", input_string) == 0)) {
+			uci_search_params(input_string);
+		}
+
+		/*===============================================================*/
+		/* Annotate a PGN file with engine scores - "annotate games.pgn nodes 500000 threads 8"
+		/*===============================================================*/
+		if ((index_of("annotate", input_string) == 0) || (index_of("ANNOTATE", input_string) == 0)) {
+			annotate_pgn(input_string);
+		}
+
+		/*===============================================================*/
+		/* Time the network against the evaluation and check it - "nnue positions.epd verify"
+		/*===============================================================*/
+		if ((index_of("nnue", input_string) == 0) || (index_of("NNUE", input_string) == 0)) {
+			nnue_test(input_string);
+		}
+
+		/*===============================================================*/
+		/* Record the next search's tree - "trace tree.bin nodes 100000 moves e2e4"
+		/*===============================================================*/
+		if ((index_of("trace", input_string) == 0) || (index_of("TRACE", input_string) == 0)) {
+			uci_trace(input_string);
+		}
+		if ((index_of("analyzetrace", input_string) == 0) || (index_of("ANALYZETRACE", input_string) == 0)) {
+			analyze_trace(input_string);
+		}
+
+		/*===============================================================*/
+		/* Perft (divide) on the current position - "perft 6 threads 8 hash 256"
+		/*===============================================================*/
+		if ((index_of("perft", input_string) == 0) || (index_of("PERFT", input_string) == 0)) {
+			uci_perft(input_string);
 		}
 
 		/*===============================================================*/
@@ -158,10 +374,16 @@ void listen_for_uci_input()
         /*===============================================================*/
         if (!strcmp(input_string, "test") || !strcmp(input_string, "TEST"))
             test_procedure();
-        if (!strcmp(input_string, "testperft") || !strcmp(input_string, "TESTPERFT"))
+        if ((index_of("testperft", input_string) == 0) || (index_of("TESTPERFT", input_string) == 0)) {
+            uci_set_perft_cache(input_string);
             test_perft();
-        if (!strcmp(input_string, "testperft960") || !strcmp(input_string, "TESTPERFT960"))
+            set_perft_cache(0);
+        }
+        if ((index_of("testperft960", input_string) == 0) || (index_of("TESTPERFT960", input_string) == 0)) {
+            uci_set_perft_cache(input_string);
             test_perft960();
+            set_perft_cache(0);
+        }
         if (!strcmp(input_string, "testbook") || !strcmp(input_string, "TESTBOOK"))
             test_book();
 
@@ -172,21 +394,6 @@ void listen_for_uci_input()
 #endif
 }
 
-void send_command(char *t)
-{
-    size_t i = strlen(t);
-    if (i > 0)
-    {
-        if (t[i-1] == '\n')
-            t[i-1] = '\0';
-        puts(t);
-        fflush(stdout);
-        if (uci.debug)
-            write_log(t, "maverick-log.txt", TRUE, TRUE);
-
-    }
-}
-
 void uci_set_author()
 {
     sprintf(engine_name, "Maverick %s", ENGINE_VERSION);
@@ -220,13 +427,14 @@ void uci_set_mode()
     if (book_count() > 0) {
         strcpy(s, "option name OwnBook type check default true");
         send_command(s);
+        uci.opening_book.use_own_book = TRUE;
         strcpy(s, book_string());
         send_command(s);
     }
     else {
         uci.opening_book.use_own_book = FALSE;
         strcpy(uci.opening_book.filename, "");
-        uci.opening_book.f = NULL;
+        close_book();
     }
 
 	strcpy(s, "option name Book Selectivity type combo default Normal var Random var Varied var Normal var Discerning var Tournament");
@@ -252,6 +460,32 @@ void uci_set_mode()
 	uci.options.futility_pruning = FALSE;
 	send_command(s);
 
+	sprintf(s, "option name Cluster Workers type spin default 0 min 0 max %d", CLUSTER_MAX_WORKERS);
+	send_command(s);
+
+	strcpy(s, "option name Cluster Port type spin default 0 min 0 max 65535");
+	send_command(s);
+
+	sprintf(s, "option name Cluster Address type string default %s", CLUSTER_DEFAULT_ADDRESS);
+	send_command(s);
+
+	strcpy(s, "option name NUMA Bind Threads type check default false");
+	send_command(s);
+
+	strcpy(s, "option name NUMA Hash type combo default Default var Default var Interleave var Local");
+	send_command(s);
+
+	strcpy(s, "option name Eval Params type string default <empty>");
+	send_command(s);
+
+	strcpy(s, "option name Use NNUE type check default false");
+	send_command(s);
+
+	strcpy(s, "option name EvalFile type string default " NNUE_DEFAULT_FILE);
+	send_command(s);
+
+	uci_search_param_options();
+
     strcpy(s, "uciok");
     send_command(s);
 }
@@ -273,54 +507,110 @@ void uci_stop()
         send_info("ERROR - I can't stop because I'm not thinking!");
         uci_send_state("After Stop");
     }
+
+    mutex_lock(&engine_mutex);
     uci.stop = TRUE;
+    condition_broadcast(&engine_condition);
     while (uci.engine_state != UCI_ENGINE_WAITING)
-        Sleep(1);
+        condition_wait(&engine_condition, &engine_mutex);
+    mutex_unlock(&engine_mutex);
 }
 
 void uci_go(char *s)
 {
+    mutex_lock(&engine_mutex);
     while (uci.engine_state != UCI_ENGINE_WAITING)
-        Sleep(1);
+        condition_wait(&engine_condition, &engine_mutex);
 
     search_start_time = time_now();
     last_display_update = search_start_time;
     set_uci_level(s, position->to_move);
+
+    //-- A "stop" sent while the engine was idle mustn't kill this search
+    uci.stop = FALSE;
+
     uci.engine_state = UCI_ENGINE_START_THINKING;
+    condition_broadcast(&engine_condition);
     while (uci.engine_state == UCI_ENGINE_START_THINKING)
-        Sleep(1);
+        condition_wait(&engine_condition, &engine_mutex);
+    mutex_unlock(&engine_mutex);
 }
 
+//-- The last position sent by the GUI, so the next one can just play the new moves
+static char position_base[UCI_BUFFER_SIZE];
+static char position_moves[MAX_MOVES][8];
+static int position_move_count = -1;
+static t_hash position_hash;
+static BOOL position_chess960;
+
 void uci_position(struct t_board *board, char *s)
 {
-    while (uci.engine_state != UCI_ENGINE_WAITING)
-        Sleep(1);
+    uci_wait_for_search();
 
     static char str[UCI_BUFFER_SIZE];
-    int i, n, c;
+    static char *word[MAX_MOVES + 8];
+    int i, n, c, moves;
+
+    //-- Split the command once
+    strncpy(str, s, UCI_BUFFER_SIZE - 1);
+    str[UCI_BUFFER_SIZE - 1] = '\0';
+    c = split_words(str, word, MAX_MOVES + 8);
 
-    if (!strcmp(word_index(1, s), "startpos") || !strcmp(word_index(1, s), "STARTPOS")) {
-        new_game(board);
+    for (moves = 1; moves < c; moves++) {
+        if (!strcmp(word[moves], "moves") || !strcmp(word[moves], "MOVES"))
+            break;
     }
-    else {
-        strcpy(str,word_index(2,s));
-        strcat(str," ");
-        strcat(str,word_index(3,s));
-        strcat(str," ");
-        strcat(str,word_index(4,s));
-        strcat(str," ");
-        strcat(str,word_index(5,s));
-        set_fen(board, str);
-    }
-    n = index_of("moves", s);
-    if (n <= -1)
-        n = index_of("MOVES", s);
-    if (n > 0) {
-        c = word_count(s);
-        for (i = n + 1; i < c; i++) {
-            make_game_move(board, word_index(i, s));
+
+    //-- Everything before "moves"
+    static char base[UCI_BUFFER_SIZE];
+    base[0] = '\0';
+    for (i = 1; i < moves; i++) {
+        strcat(base, word[i]);
+        strcat(base, " ");
+    }
+
+    //-- Does this continue the last position (which is still on the board)?
+    n = 0;
+    if (position_move_count >= 0 && !strcmp(base, position_base) && board->hash == position_hash && board->chess960 == position_chess960
+        && c - moves - 1 >= position_move_count) {
+        while (n < position_move_count && !strcmp(word[moves + 1 + n], position_moves[n]))
+            n++;
+        if (n < position_move_count)
+            n = -1;
+    }
+    else
+        n = -1;
+
+    //-- If not, start again
+    if (n < 0) {
+        if (c > 1 && (!strcmp(word[1], "startpos") || !strcmp(word[1], "STARTPOS"))) {
+            new_game(board);
         }
+        else {
+            static char fen[UCI_BUFFER_SIZE];
+            fen[0] = '\0';
+            for (i = 2; i < 6 && i < moves; i++) {
+                strcat(fen, word[i]);
+                strcat(fen, " ");
+            }
+            set_fen(board, fen);
+        }
+        strcpy(position_base, base);
+        n = 0;
     }
+
+    //-- Play the new moves
+    position_move_count = n;
+    for (i = moves + 1 + n; i < c && position_move_count < MAX_MOVES; i++) {
+        make_game_move(board, word[i]);
+        strncpy(position_moves[position_move_count], word[i], 7);
+        position_moves[position_move_count++][7] = '\0';
+    }
+    position_hash = board->hash;
+    position_chess960 = board->chess960;
+
+    //-- Remember the position for the cluster workers
+    cluster_set_position(s);
 }
 
 void uci_ponderhit()
@@ -329,40 +619,11 @@ void uci_ponderhit()
         send_info("ERROR - I'm not pondering!");
         uci_send_state("After False PonderHit");
     }
-    uci.level.ponder = FALSE;
-}
-
-void uci_check_status(struct t_board *board, int ply)
-{
-    unsigned long t1;
-    t1 = time_now();
-    if ((!uci.level.ponder) && (!uci.level.infinite) && (!uci.level.depth) && (!uci.level.mate) && (!uci.level.nodes) && (t1 - search_start_time >= abort_move_time)) {
-        static char s[1024];
-
-        sprintf(s, INFO_STRING_ABORT, abort_move_time, (long) t1 - search_start_time, nodes + qnodes);
 
-        send_info(s);
-        uci.stop = TRUE;
-    }
-    else {
-        message_update_count++;
-        if (t1 - last_display_update > 1000) {
-            //Sleep(0);
-            do_uci_hash_full();
-            do_uci_send_nodes();
-            if (uci.options.current_line)
-                uci_current_line(board, ply);
-            last_display_update = t1;
-            if (message_update_count > 200) {
-                message_update_mask = (message_update_mask << 1) + 1;
-            }
-            else {
-                if (message_update_count < 100)
-                    message_update_mask = (message_update_mask >> 1);
-            }
-            message_update_count = 0;
-        }
-    }
+    mutex_lock(&engine_mutex);
+    uci.level.ponder = FALSE;
+    condition_broadcast(&engine_condition);
+    mutex_unlock(&engine_mutex);
 }
 
 /*=======================================================*/
@@ -373,6 +634,7 @@ void uci_setoption(char *s)
 
     if ((index_of("Hash", s) == 2) || (index_of("hash", s) == 2) || (index_of("HASH", s) == 2)) {
         set_hash(number_index(4, s));
+        cluster_broadcast(s);
         return;
     }
 
@@ -429,6 +691,77 @@ void uci_setoption(char *s)
 		return;
 	}
 
+	if (((index_of("Cluster", s) == 2) || (index_of("cluster", s) == 2) || (index_of("CLUSTER", s) == 2)) && ((index_of("Workers", s) == 3) || (index_of("workers", s) == 3) || (index_of("WORKERS", s) == 3))) {
+		cluster_set_workers(number_index(5, s));
+		return;
+	}
+
+	if (((index_of("Cluster", s) == 2) || (index_of("cluster", s) == 2) || (index_of("CLUSTER", s) == 2)) && ((index_of("Port", s) == 3) || (index_of("port", s) == 3) || (index_of("PORT", s) == 3))) {
+		cluster_set_port(number_index(5, s));
+		return;
+	}
+
+	if (((index_of("Cluster", s) == 2) || (index_of("cluster", s) == 2) || (index_of("CLUSTER", s) == 2)) && ((index_of("Address", s) == 3) || (index_of("address", s) == 3) || (index_of("ADDRESS", s) == 3))) {
+		char *address = strtok(leftstr(s, 5), "\n");
+		if (address != NULL)
+			cluster_set_address(address);
+		return;
+	}
+
+	if (((index_of("NUMA", s) == 2) || (index_of("numa", s) == 2) || (index_of("Numa", s) == 2)) && ((index_of("Bind", s) == 3) || (index_of("bind", s) == 3) || (index_of("BIND", s) == 3))) {
+		BOOL bind = (!strcmp(word_index(6, s), "true") || !strcmp(word_index(6, s), "TRUE"));
+		if (bind != numa.bind_threads) {
+			numa.bind_threads = bind;
+			numa.rebind = TRUE;
+			numa_report();
+		}
+		return;
+	}
+
+	if (((index_of("NUMA", s) == 2) || (index_of("numa", s) == 2) || (index_of("Numa", s) == 2)) && ((index_of("Hash", s) == 3) || (index_of("hash", s) == 3) || (index_of("HASH", s) == 3))) {
+		if ((index_of("Interleave", s) == 5) || (index_of("interleave", s) == 5) || (index_of("INTERLEAVE", s) == 5))
+			numa_set_hash_policy(NUMA_HASH_INTERLEAVE);
+		else if ((index_of("Local", s) == 5) || (index_of("local", s) == 5) || (index_of("LOCAL", s) == 5))
+			numa_set_hash_policy(NUMA_HASH_LOCAL);
+		else
+			numa_set_hash_policy(NUMA_HASH_DEFAULT);
+		numa_report();
+		return;
+	}
+
+	//-- Load the evaluation parameters from a file
+	if (((index_of("Eval", s) == 2) || (index_of("eval", s) == 2) || (index_of("EVAL", s) == 2)) && ((index_of("Params", s) == 3) || (index_of("params", s) == 3) || (index_of("PARAMS", s) == 3))) {
+		char *filename = strtok(leftstr(s, 5), "\n");
+		if (filename != NULL && strcmp(filename, "<empty>") && load_eval_params(filename))
+			clear_hash();
+		return;
+	}
+
+	//-- Switch between the network and the hand-crafted evaluation
+	if (((index_of("Use", s) == 2) || (index_of("use", s) == 2) || (index_of("USE", s) == 2)) && ((index_of("NNUE", s) == 3) || (index_of("nnue", s) == 3) || (index_of("Nnue", s) == 3))) {
+		BOOL active = nnue.active;
+		set_nnue(!strcmp(word_index(5, s), "true") || !strcmp(word_index(5, s), "TRUE"));
+		if (nnue.active != active)
+			clear_hash();
+		cluster_broadcast(s);
+		return;
+	}
+
+	//-- Load a network
+	if ((index_of("EvalFile", s) == 2) || (index_of("evalfile", s) == 2) || (index_of("EVALFILE", s) == 2)) {
+		char *filename = strtok(leftstr(s, 4), "\n");
+		if (filename != NULL && (!nnue.loaded || strcmp(filename, nnue.filename)) && load_nnue(filename) && nnue.active)
+			clear_hash();
+		cluster_broadcast(s);
+		return;
+	}
+
+	//-- The search parameters (pruning margins, null move and LMR)
+	if (uci_set_search_param(s)) {
+		cluster_broadcast(s);
+		return;
+	}
+
 	if ((index_of("Futility", s) == 2) || (index_of("futility", s) == 2) || (index_of("FUTILITY", s) == 2)) {
 		if (!strcmp(word_index(5, s), "true") || !strcmp(word_index(5, s), "TRUE"))
 			uci.options.show_search_statistics = TRUE;
@@ -458,14 +791,14 @@ void do_uci_new_pv(struct t_board *board, int score, int depth)
 
     if (score >= MAX_CHECKMATE) {
         v = ((CHECKMATE - score + 1) >> 1);
-		sprintf(s, INFO_STRING_CHECKMATE, v, (int) t, depth, deepest, nodes + qnodes);
+		sprintf(s, INFO_STRING_CHECKMATE, v, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     else if (score <= -MAX_CHECKMATE) {
         v = ((-score - CHECKMATE) >> 1);
-		sprintf(s, INFO_STRING_CHECKMATE, v, (int) t, depth, deepest, nodes + qnodes);
+		sprintf(s, INFO_STRING_CHECKMATE, v, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     else {
-		sprintf(s, INFO_STRING_SCORE, score, (int) t, depth, deepest, nodes + qnodes);
+		sprintf(s, INFO_STRING_SCORE, score, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
 
     pv[0] = 0;
@@ -498,14 +831,14 @@ void do_uci_fail_high(struct t_board *board, int score, int depth)
 
     if (score >= MAX_CHECKMATE) {
         v = ((CHECKMATE - score + 1) >> 1);
-		sprintf(s, INFO_STRING_FAIL_HIGH_MATE, v, (int) t, depth, deepest, nodes + qnodes);
+		sprintf(s, INFO_STRING_FAIL_HIGH_MATE, v, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     else if (score <= -MAX_CHECKMATE) {
         v = ((-score - CHECKMATE) >> 1);
-		sprintf(s, INFO_STRING_FAIL_HIGH_MATE, v, (int) t, depth, deepest, nodes + qnodes);
+		sprintf(s, INFO_STRING_FAIL_HIGH_MATE, v, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     else {
-		sprintf(s, INFO_STRING_FAIL_HIGH_SCORE, score, (int) t, depth, deepest, nodes + qnodes);
+		sprintf(s, INFO_STRING_FAIL_HIGH_SCORE, score, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     strcpy(pv,move_as_str(board->pv_data[0].current_move));
     strcat(s,pv);
@@ -527,14 +860,14 @@ void do_uci_fail_low(struct t_board *board, int score, int depth)
 
     if (score >= MAX_CHECKMATE) {
         v = ((CHECKMATE - score + 1) >> 1);
-		sprintf(s, INFO_STRING_FAIL_LOW_MATE, v, (int) t, depth, deepest, nodes + qnodes);
+		sprintf(s, INFO_STRING_FAIL_LOW_MATE, v, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     else if (score <= -MAX_CHECKMATE) {
         v = ((-score - CHECKMATE) >> 1);
-        sprintf(s, INFO_STRING_FAIL_LOW_MATE, v, (int) t, depth, deepest, nodes + qnodes);
+        sprintf(s, INFO_STRING_FAIL_LOW_MATE, v, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     else {
-        sprintf(s, INFO_STRING_FAIL_LOW_SCORE, score, (int) t, depth, deepest, nodes + qnodes);
+        sprintf(s, INFO_STRING_FAIL_LOW_SCORE, score, (int) t, depth, deepest, nodes + qnodes + cluster.nodes);
     }
     strcpy(pv,move_as_str(board->pv_data[0].current_move));
     strcat(s,pv);
@@ -548,7 +881,7 @@ void do_uci_send_nodes()
     t_nodes n;
     unsigned long t;
 
-    n = nodes + qnodes;
+    n = nodes + qnodes + cluster.nodes;
     t = time_now();
     if (t > search_start_time)
         sprintf(s, INFO_STRING_SEND_NODES, n, 1000 * n / (t - search_start_time));
@@ -638,7 +971,7 @@ BOOL is_search_complete(struct t_board *board, int score, int ply, struct t_move
         return (uci.level.depth <= ply);
 
     if (uci.level.nodes > 0)
-        return (uci.level.nodes < nodes + qnodes);
+        return (uci.level.nodes < nodes + qnodes + cluster.nodes);
 
     if (uci.level.mate > 0) {
         if (score >= MAX_CHECKMATE && ((CHECKMATE - score + 1) >> 1) <= uci.level.mate)
@@ -884,10 +1217,13 @@ void do_uci_show_stats()
         }
         sprintf(s, "info string QNodes = %3.1f%%, Hash Hits = %3.1f%%, Move Order = %3.1f%%\n", n, h, f);
         send_command(s);
+
+        //-- The detailed counters (only in a USE_SEARCH_STATS build)
+        SEARCH_STAT(report_search_stats());
     }
 }
 
-void send_info(char *s)
+void send_info(const char *s)
 {
     static char t[2048];
     strcpy(t, "info string ");
@@ -904,6 +1240,7 @@ void uci_new_game(struct t_board *board)
     clear_history();
     configure_castling();
     init_directory_castling_delta();
+    cluster_broadcast("ucinewgame");
 
     uci.options.chess960 = FALSE;
     board->chess960 = FALSE;
@@ -917,6 +1254,32 @@ void uci_set_debug(char *s)
         uci.debug = FALSE;
 }
 
+//-- An optional "hash <MB>" sizes the perft cache
+void uci_set_perft_cache(char *s)
+{
+    int i;
+
+    if ((i = index_of("hash", s)) > 0 || (i = index_of("HASH", s)) > 0)
+        set_perft_cache(number_index(i + 1, s));
+    else
+        set_perft_cache(0);
+}
+
+void uci_perft(char *s)
+{
+    int depth = number_index(1, s);
+    int threads = numa.cpu_count;
+    int i;
+
+    if ((i = index_of("threads", s)) > 0 || (i = index_of("THREADS", s)) > 0)
+        threads = number_index(i + 1, s);
+
+    uci_wait_for_search();
+    uci_set_perft_cache(s);
+    parallel_perft(position, max(1, depth), threads, TRUE);
+    set_perft_cache(0);
+}
+
 //void uci_set_predicted_hash(struct t_board *board)
 //{
 //	int i, n, q;
@@ -962,9 +1325,10 @@ void init_engine(struct t_board *board)
     if (!uci.engine_initialized) {
         hash_age = 1;
 
-        srand(time(NULL));
+        mutex_init(&engine_mutex);
+        condition_init(&engine_condition);
 
-        message_update_mask = 32767;
+        srand(time(NULL));
 
 #if _DEBUG
         uci.debug = TRUE;
@@ -975,6 +1339,7 @@ void init_engine(struct t_board *board)
         //initialize stuff
         init_eval_function();
         init_board(board);
+        init_numa();
         init_hash();
         init_pawn_hash();
         init_bitboards();
@@ -982,6 +1347,7 @@ void init_engine(struct t_board *board)
         init_magic();
         init_can_move();
         init_material_hash();
+        init_nnue();
         uci.engine_initialized = TRUE;
     }
 };
@@ -19,29 +19,48 @@
 #include "procs.h"
 #include "bittwiddle.h"
 
-#if defined(__linux__) || defined(__APPLE__)
-#include <sys/time.h>
+#if !defined(_WIN32)
+#include <time.h>
+#endif
 
-unsigned GetTickCount() {
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL) != 0) {
-        return 0;
-    }
+//-- Milliseconds on a monotonic clock (so it never jumps when the system time is changed)
+unsigned long time_now()
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
 
-    return tv.tv_sec * 1000 + tv.tv_usec / 1000;
-}
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (unsigned long)(counter.QuadPart / (frequency.QuadPart / 1000));
+
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 #endif
+}
 
-unsigned long time_now()
+//-- Nanoseconds on the same clock, for timing things which only take a few cycles
+unsigned long long time_now_ns()
 {
-#if defined(__arm__) || defined(__linux__) || defined(__MINGW32__) || defined(__APPLE__)
-    return GetTickCount();
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
 
-#elif defined _WIN32 && !_WIN64
-    return GetTickCount();
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL
+        + (unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
 
 #else
-	return GetTickCount64();
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 #endif
 }
 
@@ -63,6 +82,19 @@ int index_of(char *substr, char *s)
     return -1;
 }
 
+//-- A whole word of digits, with an optional sign
+BOOL is_number(char *s)
+{
+    if (*s == '-' || *s == '+')
+        s++;
+    if (*s == '\0')
+        return FALSE;
+    for (; *s; s++)
+        if (*s < '0' || *s > '9')
+            return FALSE;
+    return TRUE;
+}
+
 int number_index(int index, char *s)
 {
     char *str;
@@ -118,6 +150,26 @@ char *word_index(int index, char *s)
     return str;
 }
 
+//-- Split a string into words in one pass (the string is modified)
+int split_words(char *s, char *word[], int max_words)
+{
+    int n = 0;
+
+    while (*s && n < max_words) {
+        while (*s == ' ' || *s == '\t')
+            *s++ = '\0';
+        if (*s == '\0')
+            break;
+        word[n++] = s;
+        while (*s && *s != ' ' && *s != '\t')
+            s++;
+    }
+    if (*s)
+        *s = '\0';
+
+    return n;
+}
+
 int word_count(char *s)
 {
     int n;
@@ -165,25 +165,3 @@ void write_tree(struct t_board *board, struct t_move_record *move, BOOL append,
 
     fclose(tfile);
 }
-
-void write_log(char *s, char *filename, BOOL append, BOOL send)
-{
-    FILE *tfile = NULL;
-
-    char t[UCI_BUFFER_SIZE];
-
-    if (append) {
-        tfile = fopen(filename, "a");
-    }
-    else {
-        tfile = fopen(filename, "w");
-    }
-
-    if (send)
-        sprintf(t, "Sent     >> %s", s);
-    else
-        sprintf(t, "Received >> %s", s);
-    fprintf(tfile, t);
-    fprintf(tfile, "\n");
-    fclose(tfile);
-}